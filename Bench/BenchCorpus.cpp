@@ -0,0 +1,463 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "BenchCorpus.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string_view>
+
+namespace
+{
+
+// Raw engine output is used instead of distributions, whose results are implementation-defined
+class Random
+{
+public:
+    explicit Random(std::uint32_t seed) :
+        m_engine(seed)
+    {
+        //
+    }
+
+    std::uint32_t Get(std::uint32_t limit)
+    {
+        return m_engine() % limit;
+    }
+
+    std::string GetBytes(std::size_t size)
+    {
+        std::string result(size, '\0');
+        std::generate(result.begin(), result.end(), [this]() { return static_cast<char>(m_engine()); });
+        return result;
+    }
+
+    std::string GetHex(std::size_t size)
+    {
+        std::string result(size, '\0');
+        std::generate(result.begin(), result.end(), [this]() { return "0123456789abcdef"[m_engine() % 16]; });
+        return result;
+    }
+
+private:
+    std::mt19937 m_engine;
+};
+
+class BencodeWriter
+{
+public:
+    BencodeWriter& Begin(char type)
+    {
+        m_data += type;
+        return *this;
+    }
+
+    BencodeWriter& End()
+    {
+        m_data += 'e';
+        return *this;
+    }
+
+    BencodeWriter& String(std::string_view value)
+    {
+        m_data += fmt::format("{}:", value.size());
+        m_data += value;
+        return *this;
+    }
+
+    BencodeWriter& Integer(long long value)
+    {
+        m_data += fmt::format("i{}e", value);
+        return *this;
+    }
+
+    std::string& GetData()
+    {
+        return m_data;
+    }
+
+private:
+    std::string m_data;
+};
+
+class PickleWriter
+{
+public:
+    PickleWriter() :
+        m_data("\x80\x02"),
+        m_memoSize(0),
+        m_stringMemo()
+    {
+        //
+    }
+
+    void Opcode(char opcode)
+    {
+        m_data += opcode;
+    }
+
+    void Global(std::string_view module, std::string_view name)
+    {
+        std::string const key = fmt::format("{}\n{}\n", module, name);
+        if (!Get(key))
+        {
+            m_data += 'c';
+            m_data += key;
+            Put(key);
+        }
+    }
+
+    void String(std::string_view value)
+    {
+        if (!Get(value))
+        {
+            m_data += 'X';
+            AppendNumber<std::uint32_t>(static_cast<std::uint32_t>(value.size()));
+            m_data += value;
+            Put(value);
+        }
+    }
+
+    void Integer(std::int32_t value)
+    {
+        if (value >= 0 && value < 256)
+        {
+            m_data += 'K';
+            AppendNumber<std::uint8_t>(static_cast<std::uint8_t>(value));
+        }
+        else
+        {
+            m_data += 'J';
+            AppendNumber<std::int32_t>(value);
+        }
+    }
+
+    void Float(double value)
+    {
+        m_data += 'G';
+        auto bits = std::bit_cast<std::uint64_t>(value);
+        for (int i = 7; i >= 0; --i)
+        {
+            m_data += static_cast<char>((bits >> (i * 8)) & 0xff);
+        }
+    }
+
+    void Bool(bool value)
+    {
+        m_data += value ? '\x88' : '\x89';
+    }
+
+    // Containers are memoized on creation, as pickle does for every mutable object
+    void EmptyContainer(char opcode)
+    {
+        m_data += opcode;
+        Put({});
+    }
+
+    std::string& GetData()
+    {
+        return m_data;
+    }
+
+private:
+    template<typename T>
+    void AppendNumber(T value)
+    {
+        char buffer[sizeof(T)];
+        std::memcpy(buffer, &value, sizeof(T));
+        if constexpr (std::endian::native == std::endian::big)
+        {
+            std::reverse(buffer, buffer + sizeof(T));
+        }
+        m_data.append(buffer, sizeof(T));
+    }
+
+    bool Get(std::string_view key)
+    {
+        auto const it = m_stringMemo.find(std::string(key));
+        if (it == m_stringMemo.end())
+        {
+            return false;
+        }
+
+        if (it->second < 256)
+        {
+            m_data += 'h';
+            AppendNumber<std::uint8_t>(static_cast<std::uint8_t>(it->second));
+        }
+        else
+        {
+            m_data += 'j';
+            AppendNumber<std::uint32_t>(it->second);
+        }
+
+        return true;
+    }
+
+    void Put(std::string_view key)
+    {
+        std::uint32_t const index = m_memoSize++;
+
+        if (index < 256)
+        {
+            m_data += 'q';
+            AppendNumber<std::uint8_t>(static_cast<std::uint8_t>(index));
+        }
+        else
+        {
+            m_data += 'r';
+            AppendNumber<std::uint32_t>(index);
+        }
+
+        if (!key.empty())
+        {
+            m_stringMemo.emplace(key, index);
+        }
+    }
+
+private:
+    std::string m_data;
+    std::uint32_t m_memoSize;
+    std::map<std::string, std::uint32_t> m_stringMemo;
+};
+
+std::size_t const PieceSize = 256 * 1024;
+
+} // namespace
+
+namespace BenchCorpus
+{
+
+std::string GenerateTorrent(std::size_t fileCount)
+{
+    Random random(static_cast<std::uint32_t>(fileCount));
+    BencodeWriter writer;
+
+    std::uint64_t totalSize = 0;
+
+    writer.Begin('d');
+    writer.String("announce").String("http://tracker.example.com/announce");
+    writer.String("announce-list").Begin('l');
+    writer.Begin('l').String("http://tracker.example.com/announce").End();
+    writer.Begin('l').String("udp://tracker.example.org:6969/announce").End();
+    writer.End();
+    writer.String("creation date").Integer(1600000000);
+    writer.String("info").Begin('d');
+
+    if (fileCount == 1)
+    {
+        totalSize = 1024 * 1024 * 1024 + random.Get(PieceSize);
+        writer.String("length").Integer(static_cast<long long>(totalSize));
+    }
+    else
+    {
+        writer.String("files").Begin('l');
+        for (std::size_t i = 0; i < fileCount; ++i)
+        {
+            std::uint64_t const fileSize = random.Get(256 * 1024);
+            totalSize += fileSize;
+
+            writer.Begin('d');
+            writer.String("length").Integer(static_cast<long long>(fileSize));
+            writer.String("path").Begin('l');
+            writer.String(fmt::format("Directory {:04}", i / 1000));
+            writer.String(fmt::format("File {:06}.bin", i));
+            writer.End();
+            writer.End();
+        }
+        writer.End();
+    }
+
+    writer.String("name").String("Generated torrent");
+    writer.String("piece length").Integer(PieceSize);
+    writer.String("pieces").String(random.GetBytes((totalSize + PieceSize - 1) / PieceSize * 20));
+    writer.End();
+    writer.End();
+
+    return std::move(writer.GetData());
+}
+
+std::string GenerateUTorrentResume(std::size_t minSize)
+{
+    Random random(42);
+    BencodeWriter writer;
+
+    writer.Begin('d');
+    writer.String(".fileguard").String(random.GetHex(40));
+
+    for (std::size_t i = 0; writer.GetData().size() < minSize; ++i)
+    {
+        std::size_t const fileCount = 1 + random.Get(32);
+
+        writer.String(fmt::format("{:08}.torrent", i)).Begin('d');
+        writer.String("added_on").Integer(1600000000 + i);
+        writer.String("caption").String(fmt::format("Torrent #{}", i));
+        writer.String("completed_on").Integer(1600000000 + 2 * i);
+        writer.String("corrupt").Integer(0);
+        writer.String("downloaded").Integer(random.Get(1u << 31));
+        writer.String("downspeed").Integer(0);
+        writer.String("have").String(random.GetBytes(16 + random.Get(2048)));
+        writer.String("override_seedsettings").Integer(0);
+        writer.String("path").String(fmt::format("C:\\Downloads\\Torrent #{}", i));
+        writer.String("prio").String(std::string(fileCount, '\x08'));
+        writer.String("started").Integer(2);
+        writer.String("targets").Begin('l');
+        if (fileCount > 1 && random.Get(4) == 0)
+        {
+            writer.Begin('l').Integer(0).String(fmt::format("C:\\Moved\\Torrent #{}", i)).End();
+        }
+        writer.End();
+        writer.String("trackers").Begin('l');
+        writer.String(fmt::format("http://tracker{}.example.com/announce", i % 100));
+        writer.String("udp://tracker.example.org:6969/announce");
+        writer.End();
+        writer.String("uploaded").Integer(random.Get(1u << 31));
+        writer.String("upspeed").Integer(0);
+        writer.String("wanted_ratio").Integer(2000);
+        writer.End();
+    }
+
+    writer.End();
+
+    return std::move(writer.GetData());
+}
+
+std::string GenerateDelugeState(std::size_t torrentCount)
+{
+    Random random(static_cast<std::uint32_t>(torrentCount));
+    PickleWriter writer;
+
+    writer.Global("deluge.core.torrentmanager", "TorrentManagerState");
+    writer.EmptyContainer(')');
+    writer.Opcode('\x81');
+    writer.EmptyContainer('}');
+    writer.String("torrents");
+    writer.EmptyContainer(']');
+    writer.Opcode('(');
+
+    for (std::size_t i = 0; i < torrentCount; ++i)
+    {
+        std::size_t const fileCount = 1 + random.Get(32);
+
+        writer.Global("deluge.core.torrentmanager", "TorrentState");
+        writer.EmptyContainer(')');
+        writer.Opcode('\x81');
+        writer.EmptyContainer('}');
+        writer.Opcode('(');
+
+        writer.String("file_priorities");
+        writer.EmptyContainer(']');
+        writer.Opcode('(');
+        for (std::size_t j = 0; j < fileCount; ++j)
+        {
+            writer.Integer(random.Get(4) == 0 ? 0 : 4);
+        }
+        writer.Opcode('e');
+
+        writer.String("max_download_speed");
+        writer.Float(-1);
+        writer.String("max_upload_speed");
+        writer.Float(random.Get(2) == 0 ? -1 : 100);
+        writer.String("paused");
+        writer.Bool(random.Get(2) == 0);
+        writer.String("save_path");
+        writer.String(fmt::format("/home/user/Downloads/{}", i % 10));
+        writer.String("stop_at_ratio");
+        writer.Bool(false);
+        writer.String("stop_ratio");
+        writer.Float(2);
+        writer.String("torrent_id");
+        writer.String(random.GetHex(40));
+
+        writer.String("trackers");
+        writer.EmptyContainer(']');
+        writer.Opcode('(');
+        for (std::int32_t tier = 0; tier < 2; ++tier)
+        {
+            writer.EmptyContainer('}');
+            writer.Opcode('(');
+            writer.String("tier");
+            writer.Integer(tier);
+            writer.String("url");
+            writer.String(fmt::format("http://tracker{}.example.com/announce", (i + tier) % 100));
+            writer.Opcode('u');
+        }
+        writer.Opcode('e');
+
+        writer.Opcode('u');
+        writer.Opcode('b');
+    }
+
+    writer.Opcode('e');
+    writer.Opcode('s');
+    writer.Opcode('b');
+    writer.Opcode('.');
+
+    return std::move(writer.GetData());
+}
+
+std::vector<std::string> GenerateFastResumeBlobs(std::size_t count)
+{
+    Random random(static_cast<std::uint32_t>(count));
+
+    std::vector<std::string> result;
+    result.reserve(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::size_t const pieceCount = 1 + random.Get(8192);
+
+        BencodeWriter writer;
+        writer.Begin('d');
+        writer.String("active_time").Integer(random.Get(1000000));
+        writer.String("added_time").Integer(1600000000 + i);
+        writer.String("completed_time").Integer(1600000000 + 2 * i);
+        writer.String("file-format").String("libtorrent resume file");
+        writer.String("file-version").Integer(1);
+        writer.String("info-hash").String(random.GetBytes(20));
+        writer.String("libtorrent-version").String("1.2.15.0");
+        writer.String("num_downloaders").Integer(16777215);
+        writer.String("num_seeds").Integer(16777215);
+        writer.String("paused").Integer(0);
+        writer.String("peers").String(random.GetBytes(6 * random.Get(50)));
+        std::string pieces(pieceCount, '\x01');
+        for (std::size_t j = pieceCount / 2; j < pieceCount; ++j)
+        {
+            pieces[j] = static_cast<char>(random.Get(2));
+        }
+        writer.String("pieces").String(pieces);
+        writer.String("save_path").String(fmt::format("/home/user/Downloads/{}", i % 10));
+        writer.String("seed_mode").Integer(0);
+        writer.String("total_downloaded").Integer(random.Get(1u << 31));
+        writer.String("total_uploaded").Integer(random.Get(1u << 31));
+        writer.String("trackers").Begin('l');
+        writer.Begin('l').String(fmt::format("http://tracker{}.example.com/announce", i % 100)).End();
+        writer.End();
+        writer.End();
+
+        result.push_back(std::move(writer.GetData()));
+    }
+
+    return result;
+}
+
+} // namespace BenchCorpus
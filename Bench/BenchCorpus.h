@@ -0,0 +1,40 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Generators of benchmark inputs shaped like real client data; output only depends on arguments, so runs on different
+// machines and builds measure the same bytes
+namespace BenchCorpus
+{
+
+// Bencoded .torrent with given number of files (single-file torrent if 1) and a piece hash per 256 KiB
+std::string GenerateTorrent(std::size_t fileCount);
+
+// Bencoded uTorrent resume.dat of at least given size
+std::string GenerateUTorrentResume(std::size_t minSize);
+
+// Pickled (protocol 2) Deluge torrents.state with given number of torrents, memoizing values the way Python does
+std::string GenerateDelugeState(std::size_t torrentCount);
+
+// Bencoded libtorrent fastresume blobs, as stored in Deluge torrents.fastresume
+std::vector<std::string> GenerateFastResumeBlobs(std::size_t count);
+
+} // namespace BenchCorpus
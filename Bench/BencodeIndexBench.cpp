@@ -0,0 +1,97 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "BenchCorpus.h"
+
+#include "Codec/BencodeCodec.h"
+#include "Codec/BencodeDocument.h"
+#include "Codec/BencodeStructuralIndex.h"
+#include "Common/Exception.h"
+
+#include <fmt/format.h>
+#include <jsoncons/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+std::size_t const DefaultDataSize = 50 * 1024 * 1024;
+int const RunCount = 5;
+
+void Measure(std::string_view name, std::size_t dataSize, std::function<std::size_t()> const& run)
+{
+    using Clock = std::chrono::steady_clock;
+
+    double bestSeconds = 0;
+    std::size_t result = 0;
+
+    for (int i = 0; i < RunCount; ++i)
+    {
+        Clock::time_point const start = Clock::now();
+        result = run();
+        double const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        bestSeconds = i == 0 ? seconds : std::min(bestSeconds, seconds);
+    }
+
+    fmt::print("{:<24} {:>10.2f} ms {:>10.1f} MB/s  ({} entries)\n", name, bestSeconds * 1000,
+        static_cast<double>(dataSize) / (1024 * 1024) / bestSeconds, result);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        std::size_t const dataSize = argc > 1 ? std::strtoull(argv[1], nullptr, 10) * 1024 * 1024 : DefaultDataSize;
+
+        std::string const data = BenchCorpus::GenerateUTorrentResume(dataSize);
+        fmt::print("Generated resume.dat of {} bytes\n", data.size());
+
+        Measure("BencodeCodec (ojson)", data.size(), [&data]()
+        {
+            ojson root;
+            BencodeCodec().Decode(data, root);
+            return root.size();
+        });
+
+        Measure("BencodeDocument", data.size(), [&data]()
+        {
+            BencodeDocument const document{std::span<char const>(data)};
+            return document.GetRoot().GetSize();
+        });
+
+        Measure("BencodeStructuralIndex", data.size(), [&data]()
+        {
+            return BencodeStructuralIndex(data).GetEntries().size();
+        });
+    }
+    catch (std::exception const& e)
+    {
+        fmt::print(stderr, "Error: {}\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,367 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "BenchCorpus.h"
+
+#include "Codec/BencodeCodec.h"
+#include "Codec/BencodeDocument.h"
+#include "Codec/JsonCodec.h"
+#include "Codec/PickleCodec.h"
+#include "Common/Exception.h"
+
+#include <fmt/format.h>
+#include <jsoncons/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Counted by replaced global allocation functions below
+std::atomic<std::size_t> AllocationCount(0);
+std::atomic<std::size_t> AllocationSize(0);
+
+void* Allocate(std::size_t size)
+{
+    AllocationCount.fetch_add(1, std::memory_order_relaxed);
+    AllocationSize.fetch_add(size, std::memory_order_relaxed);
+
+    void* const result = std::malloc(size != 0 ? size : 1);
+    if (result == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return result;
+}
+
+// Over-aligned blocks keep pointer to the underlying allocation right before the aligned address
+void* AllocateAligned(std::size_t size, std::size_t alignment)
+{
+    auto const base = reinterpret_cast<std::uintptr_t>(Allocate(size + alignment + sizeof(void*)));
+    auto const result = (base + sizeof(void*) + alignment - 1) / alignment * alignment;
+    reinterpret_cast<void**>(result)[-1] = reinterpret_cast<void*>(base);
+    return reinterpret_cast<void*>(result);
+}
+
+void FreeAligned(void* pointer)
+{
+    if (pointer != nullptr)
+    {
+        std::free(static_cast<void**>(pointer)[-1]);
+    }
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    return Allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return AllocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t /*size*/) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t /*alignment*/) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    FreeAligned(pointer);
+}
+
+namespace
+{
+
+double const MinRunSeconds = 1;
+int const MinRunCount = 3;
+int const MaxRunCount = 1000;
+
+// Lets stream-based codecs read documents without copying them
+class MemoryStreamBuffer : public std::streambuf
+{
+public:
+    explicit MemoryStreamBuffer(std::string const& data)
+    {
+        char* const begin = const_cast<char*>(data.data());
+        setg(begin, begin, begin + data.size());
+    }
+};
+
+struct Corpus
+{
+    std::string Name;
+    std::vector<std::string> Documents;
+
+    std::size_t GetSize() const
+    {
+        std::size_t result = 0;
+        for (std::string const& document : Documents)
+        {
+            result += document.size();
+        }
+        return result;
+    }
+};
+
+struct Measurement
+{
+    int RunCount = 0;
+    double BestSeconds = 0;
+    double TotalSeconds = 0;
+    std::size_t AllocationCount = 0;
+    std::size_t AllocationSize = 0;
+};
+
+Measurement Measure(std::function<void()> const& run)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Measurement result;
+
+    while (result.RunCount < MaxRunCount && (result.RunCount < MinRunCount || result.TotalSeconds < MinRunSeconds))
+    {
+        std::size_t const allocationCount = AllocationCount.load();
+        std::size_t const allocationSize = AllocationSize.load();
+
+        Clock::time_point const start = Clock::now();
+        run();
+        double const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        result.AllocationCount = AllocationCount.load() - allocationCount;
+        result.AllocationSize = AllocationSize.load() - allocationSize;
+        result.BestSeconds = result.RunCount == 0 ? seconds : std::min(result.BestSeconds, seconds);
+        result.TotalSeconds += seconds;
+        ++result.RunCount;
+    }
+
+    return result;
+}
+
+class CodecBench
+{
+public:
+    CodecBench() :
+        m_results(ojson::array())
+    {
+        //
+    }
+
+    void Run(std::string const& codec, std::string const& operation, Corpus const& corpus,
+        std::function<void()> const& run)
+    {
+        std::cerr << fmt::format("{} {} {}...", codec, operation, corpus.Name) << std::flush;
+
+        ojson result = ojson::object();
+        result.insert_or_assign("codec", codec);
+        result.insert_or_assign("operation", operation);
+        result.insert_or_assign("corpus", corpus.Name);
+
+        try
+        {
+            Measurement const measurement = Measure(run);
+
+            double const megabytes = static_cast<double>(corpus.GetSize()) / (1024 * 1024);
+            double const documentCount = static_cast<double>(corpus.Documents.size());
+
+            result.insert_or_assign("runs", measurement.RunCount);
+            result.insert_or_assign("best_seconds", measurement.BestSeconds);
+            result.insert_or_assign("mean_seconds", measurement.TotalSeconds / measurement.RunCount);
+            result.insert_or_assign("mb_per_second", megabytes / measurement.BestSeconds);
+            result.insert_or_assign("allocations_per_document", measurement.AllocationCount / documentCount);
+            result.insert_or_assign("allocated_bytes_per_document", measurement.AllocationSize / documentCount);
+
+            std::cerr << fmt::format(" {:.1f} MB/s", megabytes / measurement.BestSeconds) << std::endl;
+        }
+        catch (std::exception const& e)
+        {
+            result.insert_or_assign("error", std::string(e.what()));
+
+            std::cerr << " " << e.what() << std::endl;
+        }
+
+        m_results.push_back(std::move(result));
+    }
+
+    ojson const& GetResults() const
+    {
+        return m_results;
+    }
+
+private:
+    ojson m_results;
+};
+
+void BenchBencode(CodecBench& bench, Corpus const& corpus)
+{
+    BencodeCodec const codec;
+
+    std::vector<ojson> decoded(corpus.Documents.size());
+
+    bench.Run("bencode", "decode", corpus, [&]()
+    {
+        for (std::size_t i = 0; i < corpus.Documents.size(); ++i)
+        {
+            decoded[i] = ojson();
+            codec.Decode(corpus.Documents[i], decoded[i]);
+        }
+    });
+
+    bench.Run("bencode", "encode", corpus, [&]()
+    {
+        for (ojson const& document : decoded)
+        {
+            std::string data;
+            codec.Encode(data, document);
+        }
+    });
+
+    bench.Run("bencode-document", "decode", corpus, [&]()
+    {
+        for (std::string const& document : corpus.Documents)
+        {
+            BencodeDocument const decodedDocument(std::span<char const>(document), BencodeDocument::Mode::Eager);
+        }
+    });
+
+    bench.Run("bencode-document-lazy", "decode", corpus, [&]()
+    {
+        for (std::string const& document : corpus.Documents)
+        {
+            BencodeDocument const decodedDocument(std::span<char const>(document), BencodeDocument::Mode::Lazy);
+        }
+    });
+}
+
+void BenchStreamCodec(CodecBench& bench, std::string const& name, IStructuredDataCodec const& codec,
+    Corpus const& corpus)
+{
+    std::vector<ojson> decoded(corpus.Documents.size());
+
+    bench.Run(name, "decode", corpus, [&]()
+    {
+        for (std::size_t i = 0; i < corpus.Documents.size(); ++i)
+        {
+            MemoryStreamBuffer buffer(corpus.Documents[i]);
+            std::istream stream(&buffer);
+            decoded[i] = ojson();
+            codec.Decode(stream, decoded[i]);
+        }
+    });
+
+    bench.Run(name, "encode", corpus, [&]()
+    {
+        for (ojson const& document : decoded)
+        {
+            std::ostringstream stream;
+            codec.Encode(stream, document);
+        }
+    });
+}
+
+} // namespace
+
+int main()
+{
+    try
+    {
+        std::cerr << "Generating corpora..." << std::endl;
+
+        Corpus const singleFileTorrent{"torrent-single-file", {BenchCorpus::GenerateTorrent(1)}};
+        Corpus const multiFileTorrent{"torrent-100k-files", {BenchCorpus::GenerateTorrent(100000)}};
+        Corpus const uTorrentResume{"utorrent-resume-50mb", {BenchCorpus::GenerateUTorrentResume(50 * 1024 * 1024)}};
+        Corpus const fastResume{"libtorrent-fastresume-2k", BenchCorpus::GenerateFastResumeBlobs(2000)};
+        Corpus const delugeState{"deluge-state-20k", {BenchCorpus::GenerateDelugeState(20000)}};
+
+        CodecBench bench;
+
+        for (Corpus const* corpus : {&singleFileTorrent, &multiFileTorrent, &uTorrentResume, &fastResume})
+        {
+            BenchBencode(bench, *corpus);
+        }
+
+        BenchStreamCodec(bench, "pickle", PickleCodec(), delugeState);
+
+        // Same data as Deluge state, so that JSON numbers are comparable to pickle ones
+        Corpus delugeStateJson{"deluge-state-20k-json", {}};
+        {
+            MemoryStreamBuffer buffer(delugeState.Documents.front());
+            std::istream stream(&buffer);
+            ojson state;
+            PickleCodec().Decode(stream, state);
+
+            std::ostringstream jsonStream;
+            JsonCodec().Encode(jsonStream, state);
+            delugeStateJson.Documents.push_back(jsonStream.str());
+        }
+
+        BenchStreamCodec(bench, "json", JsonCodec(), delugeStateJson);
+
+        ojson corpora = ojson::array();
+        for (Corpus const* corpus : std::initializer_list<Corpus const*>{&singleFileTorrent, &multiFileTorrent,
+            &uTorrentResume, &fastResume, &delugeState, &delugeStateJson})
+        {
+            ojson item = ojson::object();
+            item.insert_or_assign("name", corpus->Name);
+            item.insert_or_assign("documents", corpus->Documents.size());
+            item.insert_or_assign("bytes", corpus->GetSize());
+            corpora.push_back(std::move(item));
+        }
+
+        ojson report = ojson::object();
+        report.insert_or_assign("version", BTMIGRATE_VERSION);
+        report.insert_or_assign("corpora", std::move(corpora));
+        report.insert_or_assign("results", bench.GetResults());
+
+        JsonCodec().Encode(std::cout, report);
+        std::cout << std::endl;
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -16,139 +16,354 @@
 
 #include "BencodeCodec.h"
 
+#include "BencodeDataCursor.h"
+#include "IBencodeVisitor.h"
+
 #include "Common/Exception.h"
 #include "Common/Util.h"
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
+#include <charconv>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace
 {
 
-ojson DecodeOneValue(std::istream& stream)
+struct RawValueCapture
+{
+    std::string_view Key;
+    std::span<char const> Value;
+};
+
+void DecodeOneValue(BencodeDataCursor& cursor, ojson& root, std::size_t maxDepth, RawValueCapture* capture = nullptr)
 {
-    ojson result;
+    // Containers being filled, from outermost to innermost; each one is the last item of the previous one, so pointers
+    // stay valid until the container is complete
+    std::vector<ojson*> containers;
+    char const* captureBegin = nullptr;
 
-    std::string buffer;
-    int c = stream.get();
-    switch (c)
+    ojson* value = &root;
+    while (true)
     {
-    case 'i':
-        buffer.clear();
-        while ((c = stream.get()) != 'e')
+        bool isValueComplete = true;
+
+        int const c = cursor.Peek();
+        switch (c)
         {
-            buffer += static_cast<char>(c);
+        case 'i':
+            cursor.Get();
+            *value = cursor.GetInteger('e');
+            break;
+
+        case 'l':
+            cursor.Get();
+            *value = ojson::array();
+            containers.push_back(value);
+            isValueComplete = false;
+            break;
+
+        case 'd':
+            cursor.Get();
+            *value = ojson::object();
+            containers.push_back(value);
+            isValueComplete = false;
+            break;
+
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            *value = ojson(cursor.GetString());
+            break;
+
+        default:
+            throw Exception(fmt::format("Unable to decode value: {}", c));
         }
-        result = Util::StringToInt(buffer);
-        break;
 
-    case 'l':
-        result = ojson::array();
-        while (stream.get() != 'e')
+        BencodeDataCursor::CheckDepth(containers.size(), maxDepth);
+
+        // Close finished containers and find out where the next value goes
+        value = nullptr;
+        while (value == nullptr)
         {
-            stream.unget();
-            result.push_back(DecodeOneValue(stream));
+            if (isValueComplete && captureBegin != nullptr && containers.size() == 1)
+            {
+                capture->Value = {captureBegin, cursor.GetPosition()};
+                captureBegin = nullptr;
+            }
+
+            if (containers.empty())
+            {
+                return;
+            }
+
+            ojson& container = *containers.back();
+
+            if (cursor.Peek() == 'e')
+            {
+                cursor.Get();
+                containers.pop_back();
+                isValueComplete = true;
+            }
+            else if (container.is_array())
+            {
+                value = &container.emplace_back();
+            }
+            else
+            {
+                std::string_view const key = cursor.GetString();
+                value = &container.insert_or_assign(key, ojson()).first->value();
+
+                if (capture != nullptr && containers.size() == 1 && key == capture->Key)
+                {
+                    captureBegin = cursor.GetPosition();
+                }
+            }
         }
-        break;
+    }
+}
+
+void VisitOneValue(BencodeDataCursor& cursor, IBencodeVisitor& visitor, std::size_t maxDepth)
+{
+    // Kinds of containers being visited ('l' or 'd'), from outermost to innermost
+    std::string containers;
 
-    case 'd':
-        result = ojson::object();
-        while (stream.get() != 'e')
+    while (true)
+    {
+        int const c = cursor.Peek();
+        switch (c)
         {
-            stream.unget();
-            ojson key = DecodeOneValue(stream);
-            ojson value = DecodeOneValue(stream);
-            result.insert_or_assign(key.as<std::string>(), value);
+        case 'i':
+            cursor.Get();
+            visitor.Integer(cursor.GetInteger('e'));
+            break;
+
+        case 'l':
+            cursor.Get();
+            containers.push_back('l');
+            visitor.BeginList();
+            break;
+
+        case 'd':
+            cursor.Get();
+            containers.push_back('d');
+            visitor.BeginDictionary();
+            break;
+
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            visitor.String(cursor.GetString());
+            break;
+
+        default:
+            throw Exception(fmt::format("Unable to decode value: {}", c));
         }
-        break;
-
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9':
-        buffer.clear();
-        while (c != ':')
+
+        BencodeDataCursor::CheckDepth(containers.size(), maxDepth);
+
+        // Close finished containers and skip values visitor is not interested in
+        bool hasNextValue = false;
+        while (!hasNextValue)
         {
-            buffer += static_cast<char>(c);
-            c = stream.get();
-        }
-        buffer.resize(Util::StringToInt(buffer));
-        stream.read(&buffer[0], buffer.size());
-        result = buffer;
-        break;
+            if (containers.empty())
+            {
+                return;
+            }
 
-    default:
-        throw Exception(fmt::format("Unable to decode value: {}", c));
+            if (cursor.Peek() == 'e')
+            {
+                cursor.Get();
+                containers.pop_back();
+                visitor.End();
+            }
+            else if (containers.back() == 'l' || visitor.Key(cursor.GetString()))
+            {
+                hasNextValue = true;
+            }
+            else
+            {
+                cursor.SkipValue(maxDepth - containers.size());
+            }
+        }
     }
+}
 
-    return result;
+template<typename T>
+std::size_t GetDecimalSize(T value)
+{
+    char buffer[32];
+    return std::to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer;
+}
+
+std::size_t GetEncodedStringSize(std::string_view value)
+{
+    return GetDecimalSize(value.size()) + 1 + value.size();
 }
 
-void EncodeOneValue(std::ostream& stream, ojson const& value)
+std::size_t GetEncodedSize(ojson const& value)
 {
+    std::size_t result = 0;
+
     if (value.is_object())
     {
-        stream << 'd';
+        result += 2;
         for (auto const& item : value.object_range())
         {
-            EncodeOneValue(stream, item.key());
-            EncodeOneValue(stream, item.value());
+            result += GetEncodedStringSize(item.key());
+            result += GetEncodedSize(item.value());
         }
-        stream << 'e';
     }
     else if (value.is_array())
     {
-        stream << 'l';
+        result += 2;
         for (auto const& item : value.array_range())
         {
-            EncodeOneValue(stream, item);
+            result += GetEncodedSize(item);
         }
-        stream << 'e';
     }
     else if (value.is<std::string>())
     {
-        stream << value.as<std::string>().size();
-        stream << ':';
-        stream << value.as<std::string>();
+        result += GetEncodedStringSize(value.as_string_view());
     }
     else if (value.is<std::intmax_t>())
     {
-        stream << 'i';
-        stream << value.as<std::intmax_t>();
-        stream << 'e';
+        result += 2 + GetDecimalSize(value.as<std::intmax_t>());
     }
     else if (value.is<std::uintmax_t>())
     {
-        stream << 'i';
-        stream << value.as<std::uintmax_t>();
-        stream << 'e';
+        result += 2 + GetDecimalSize(value.as<std::uintmax_t>());
     }
     else
     {
         throw Exception(fmt::format("Unable to encode value: {}", fmt::streamed(value)));
     }
+
+    return result;
+}
+
+template<typename T>
+char* EncodeDecimal(char* buffer, T value)
+{
+    // Buffer is sized up front, so there is always enough space
+    return std::to_chars(buffer, buffer + 32, value).ptr;
+}
+
+char* EncodeString(char* buffer, std::string_view value)
+{
+    buffer = EncodeDecimal(buffer, value.size());
+    *buffer++ = ':';
+    std::memcpy(buffer, value.data(), value.size());
+    return buffer + value.size();
+}
+
+// Value types have already been checked while calculating the size
+char* EncodeOneValue(char* buffer, ojson const& value)
+{
+    if (value.is_object())
+    {
+        *buffer++ = 'd';
+        for (auto const& item : value.object_range())
+        {
+            buffer = EncodeString(buffer, item.key());
+            buffer = EncodeOneValue(buffer, item.value());
+        }
+        *buffer++ = 'e';
+    }
+    else if (value.is_array())
+    {
+        *buffer++ = 'l';
+        for (auto const& item : value.array_range())
+        {
+            buffer = EncodeOneValue(buffer, item);
+        }
+        *buffer++ = 'e';
+    }
+    else if (value.is<std::string>())
+    {
+        buffer = EncodeString(buffer, value.as_string_view());
+    }
+    else if (value.is<std::intmax_t>())
+    {
+        *buffer++ = 'i';
+        buffer = EncodeDecimal(buffer, value.as<std::intmax_t>());
+        *buffer++ = 'e';
+    }
+    else
+    {
+        *buffer++ = 'i';
+        buffer = EncodeDecimal(buffer, value.as<std::uintmax_t>());
+        *buffer++ = 'e';
+    }
+
+    return buffer;
 }
 
 } // namespace
 
-BencodeCodec::BencodeCodec() = default;
+BencodeCodec::BencodeCodec(std::size_t maxDepth) :
+    m_maxDepth(maxDepth)
+{
+    //
+}
+
 BencodeCodec::~BencodeCodec() = default;
 
+void BencodeCodec::Decode(std::span<char const> data, ojson& root) const
+{
+    BencodeDataCursor cursor(data);
+    DecodeOneValue(cursor, root, m_maxDepth);
+}
+
+void BencodeCodec::Decode(std::span<char const> data, ojson& root, std::string_view rawKey,
+    std::span<char const>& rawValue) const
+{
+    BencodeDataCursor cursor(data);
+    RawValueCapture capture{rawKey, {}};
+    DecodeOneValue(cursor, root, m_maxDepth, &capture);
+    rawValue = capture.Value;
+}
+
+void BencodeCodec::Decode(std::span<char const> data, IBencodeVisitor& visitor) const
+{
+    BencodeDataCursor cursor(data);
+    VisitOneValue(cursor, visitor, m_maxDepth);
+}
+
 void BencodeCodec::Decode(std::istream& stream, ojson& root) const
 {
-    root = DecodeOneValue(stream);
+    std::string const data = Util::ReadStream(stream);
+    Decode(data, root);
+}
+
+void BencodeCodec::Encode(std::string& data, ojson const& root) const
+{
+    data.resize(GetEncodedSize(root));
+    EncodeOneValue(data.data(), root);
 }
 
 void BencodeCodec::Encode(std::ostream& stream, ojson const& root) const
 {
-    EncodeOneValue(stream, root);
+    std::string data;
+    Encode(data, root);
+    stream.write(data.data(), data.size());
 }
@@ -18,14 +18,38 @@
 
 #include "IStructuredDataCodec.h"
 
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+class IBencodeVisitor;
+
 class BencodeCodec : public IStructuredDataCodec
 {
 public:
-    BencodeCodec();
+    // Limits nesting of decoded data so that crafted or corrupted input can't exhaust memory
+    static std::size_t const DefaultMaxDepth = 512;
+
+public:
+    explicit BencodeCodec(std::size_t maxDepth = DefaultMaxDepth);
     ~BencodeCodec() override;
 
+    // Decodes directly from memory, without going through the stream machinery
+    void Decode(std::span<char const> data, ojson& root) const;
+    // Same as above, additionally reporting exact bytes of top-level dictionary value stored under `rawKey` (empty if
+    // there is no such value)
+    void Decode(std::span<char const> data, ojson& root, std::string_view rawKey, std::span<char const>& rawValue) const;
+    // Reports decoded values to visitor as they are encountered instead of building a tree
+    void Decode(std::span<char const> data, IBencodeVisitor& visitor) const;
+    // Encodes into memory, calculating exact size of the result up front so that it's allocated only once
+    void Encode(std::string& data, ojson const& root) const;
+
 public:
     // IStructuredDataCodec
     void Decode(std::istream& stream, ojson& root) const override;
     void Encode(std::ostream& stream, ojson const& root) const override;
+
+private:
+    std::size_t const m_maxDepth;
 };
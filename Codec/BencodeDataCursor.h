@@ -0,0 +1,160 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "Common/Exception.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+// Bounds-checked reading of bencode tokens from memory, shared by decoders
+class BencodeDataCursor
+{
+public:
+    explicit BencodeDataCursor(std::span<char const> data) :
+        m_position(data.data()),
+        m_end(data.data() + data.size())
+    {
+        //
+    }
+
+    char Peek() const
+    {
+        if (m_position == m_end)
+        {
+            throw Exception("Unexpected end of bencoded data");
+        }
+
+        return *m_position;
+    }
+
+    char Get()
+    {
+        char const result = Peek();
+        ++m_position;
+        return result;
+    }
+
+    void Skip(std::size_t size)
+    {
+        if (size > static_cast<std::size_t>(m_end - m_position))
+        {
+            throw Exception("Unexpected end of bencoded data");
+        }
+
+        m_position += size;
+    }
+
+    void SkipInteger()
+    {
+        auto const* const end = static_cast<char const*>(std::memchr(m_position, 'e', m_end - m_position));
+        if (end == nullptr)
+        {
+            throw Exception("Unexpected end of bencoded data");
+        }
+
+        m_position = end + 1;
+    }
+
+    long long GetInteger(char terminator)
+    {
+        long long result = 0;
+        auto const [end, error] = std::from_chars(m_position, m_end, result);
+        if (error != std::errc() || end == m_end || *end != terminator)
+        {
+            throw Exception(fmt::format("Unable to decode integer at \"{}\"",
+                std::string_view(m_position, std::min<std::size_t>(m_end - m_position, 32))));
+        }
+
+        m_position = end + 1;
+        return result;
+    }
+
+    char const* GetPosition() const
+    {
+        return m_position;
+    }
+
+    std::string_view GetString()
+    {
+        long long const length = GetInteger(':');
+        if (length < 0 || length > m_end - m_position)
+        {
+            throw Exception(fmt::format("Invalid string length: {}", length));
+        }
+
+        std::string_view const result(m_position, static_cast<std::size_t>(length));
+        m_position += length;
+        return result;
+    }
+
+    // Only nesting level needs to be tracked, values themselves are of no interest
+    void SkipValue(std::size_t maxDepth)
+    {
+        std::size_t depth = 0;
+
+        do
+        {
+            switch (Peek())
+            {
+            case 'i':
+                Get();
+                SkipInteger();
+                break;
+
+            case 'l':
+            case 'd':
+                Get();
+                CheckDepth(++depth, maxDepth);
+                break;
+
+            case 'e':
+                if (depth == 0)
+                {
+                    throw Exception("Unexpected end of bencoded container");
+                }
+
+                Get();
+                --depth;
+                break;
+
+            default:
+                GetString();
+                break;
+            }
+        }
+        while (depth != 0);
+    }
+
+    static void CheckDepth(std::size_t depth, std::size_t maxDepth)
+    {
+        if (depth > maxDepth)
+        {
+            throw Exception(fmt::format("Bencoded data is nested deeper than {} levels", maxDepth));
+        }
+    }
+
+private:
+    char const* m_position;
+    char const* const m_end;
+};
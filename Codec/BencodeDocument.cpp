@@ -0,0 +1,675 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "BencodeDocument.h"
+
+#include "BencodeDataCursor.h"
+
+#include "Common/Exception.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct BencodeValue::Node
+{
+    Type ValueType;
+    // Set for containers of lazily decoded documents until their children are decoded; nodes are never const objects,
+    // so the flag is accessed atomically through std::atomic_ref
+    bool IsPending;
+    char const* RawBegin;
+    std::size_t RawSize;
+    union
+    {
+        long long Integer;
+        char const* String;
+        Node const* Items;
+        Entry const* Entries;
+        // Index into document container extents while pending
+        std::size_t Extent;
+    };
+    // String length, number of list items or dictionary entries
+    std::size_t Size;
+};
+
+struct BencodeValue::Entry
+{
+    std::string_view Key;
+    Node Value;
+};
+
+// Recorded for every list and dictionary of lazily decoded document in order of appearance
+struct BencodeDocument::ContainerExtent
+{
+    std::size_t RawSize;
+    // Index of the first container following this one's children
+    std::size_t NextExtent;
+};
+
+namespace
+{
+
+using Node = BencodeValue::Node;
+using Entry = BencodeValue::Entry;
+using ContainerExtent = BencodeDocument::ContainerExtent;
+
+std::string_view TypeToString(BencodeValue::Type type)
+{
+    switch (type)
+    {
+    case BencodeValue::Type::Null:
+        return "null";
+    case BencodeValue::Type::Integer:
+        return "integer";
+    case BencodeValue::Type::String:
+        return "string";
+    case BencodeValue::Type::List:
+        return "list";
+    case BencodeValue::Type::Dictionary:
+        return "dictionary";
+    }
+
+    return "unknown";
+}
+
+template<typename T>
+T const* AllocateCopy(std::pmr::memory_resource& arena, T const* first, std::size_t count)
+{
+    if (count == 0)
+    {
+        return nullptr;
+    }
+
+    auto* const result = static_cast<T*>(arena.allocate(count * sizeof(T), alignof(T)));
+    std::uninitialized_copy_n(first, count, result);
+    return result;
+}
+
+void SortEntries(std::vector<Entry>& entries, std::size_t firstEntry)
+{
+    auto const begin = entries.begin() + firstEntry;
+    auto const end = entries.end();
+
+    // Keys are supposed to be sorted already, so this is usually the only check needed
+    if (std::adjacent_find(begin, end, [](auto const& lhs, auto const& rhs) { return lhs.Key >= rhs.Key; }) == end)
+    {
+        return;
+    }
+
+    std::stable_sort(begin, end, [](auto const& lhs, auto const& rhs) { return lhs.Key < rhs.Key; });
+
+    // Last of duplicate keys wins, same as when decoding into ojson
+    auto last = begin;
+    for (auto it = begin; it != end; ++it)
+    {
+        if (std::next(it) != end && std::next(it)->Key == it->Key)
+        {
+            continue;
+        }
+
+        *last++ = *it;
+    }
+
+    entries.erase(last, end);
+}
+
+bool IsPending(Node const& node)
+{
+    return std::atomic_ref<bool>(const_cast<bool&>(node.IsPending)).load(std::memory_order_acquire);
+}
+
+// Decodes scalar value, or only skips over container marking it as pending; container extent is looked up instead of
+// scanning through the children again
+Node DecodeShallowValue(BencodeDataCursor& cursor, std::vector<ContainerExtent> const& containerExtents,
+    std::size_t& nextExtent)
+{
+    Node node{};
+    node.RawBegin = cursor.GetPosition();
+
+    int const c = cursor.Peek();
+    switch (c)
+    {
+    case 'i':
+        cursor.Get();
+        node.ValueType = BencodeValue::Type::Integer;
+        node.Integer = cursor.GetInteger('e');
+        break;
+
+    case 'l':
+    case 'd':
+        node.ValueType = c == 'l' ? BencodeValue::Type::List : BencodeValue::Type::Dictionary;
+        node.IsPending = true;
+        node.Extent = nextExtent;
+        cursor.Skip(containerExtents.at(nextExtent).RawSize);
+        nextExtent = containerExtents[nextExtent].NextExtent;
+        break;
+
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    {
+        std::string_view const value = cursor.GetString();
+        node.ValueType = BencodeValue::Type::String;
+        node.String = value.data();
+        node.Size = value.size();
+        break;
+    }
+
+    default:
+        throw Exception(fmt::format("Unable to decode value: {}", c));
+    }
+
+    node.RawSize = cursor.GetPosition() - node.RawBegin;
+    return node;
+}
+
+} // namespace
+
+BencodeValue::BencodeValue() :
+    m_document(nullptr),
+    m_node(nullptr)
+{
+    //
+}
+
+BencodeValue::BencodeValue(BencodeDocument const* document, Node const* node) :
+    m_document(document),
+    m_node(node)
+{
+    //
+}
+
+BencodeValue::Type BencodeValue::GetType() const
+{
+    return m_node != nullptr ? m_node->ValueType : Type::Null;
+}
+
+bool BencodeValue::IsNull() const
+{
+    return GetType() == Type::Null;
+}
+
+bool BencodeValue::IsInteger() const
+{
+    return GetType() == Type::Integer;
+}
+
+bool BencodeValue::IsString() const
+{
+    return GetType() == Type::String;
+}
+
+bool BencodeValue::IsList() const
+{
+    return GetType() == Type::List;
+}
+
+bool BencodeValue::IsDictionary() const
+{
+    return GetType() == Type::Dictionary;
+}
+
+long long BencodeValue::AsInteger() const
+{
+    return GetNode(Type::Integer).Integer;
+}
+
+std::string_view BencodeValue::AsString() const
+{
+    Node const& node = GetNode(Type::String);
+    return {node.String, node.Size};
+}
+
+std::size_t BencodeValue::GetSize() const
+{
+    switch (GetType())
+    {
+    case Type::List:
+    case Type::Dictionary:
+        return GetNode(GetType()).Size;
+    default:
+        throw Exception(fmt::format("Bencoded {} has no size", TypeToString(GetType())));
+    }
+}
+
+BencodeValue BencodeValue::operator [] (std::size_t index) const
+{
+    Node const& node = GetNode(Type::List);
+    if (index >= node.Size)
+    {
+        throw Exception(fmt::format("Bencoded list index {} is out of range", index));
+    }
+
+    return BencodeValue(m_document, &node.Items[index]);
+}
+
+std::string_view BencodeValue::GetKey(std::size_t index) const
+{
+    Node const& node = GetNode(Type::Dictionary);
+    if (index >= node.Size)
+    {
+        throw Exception(fmt::format("Bencoded dictionary index {} is out of range", index));
+    }
+
+    return node.Entries[index].Key;
+}
+
+BencodeValue BencodeValue::GetValue(std::size_t index) const
+{
+    Node const& node = GetNode(Type::Dictionary);
+    if (index >= node.Size)
+    {
+        throw Exception(fmt::format("Bencoded dictionary index {} is out of range", index));
+    }
+
+    return BencodeValue(m_document, &node.Entries[index].Value);
+}
+
+BencodeValue BencodeValue::Find(std::string_view key) const
+{
+    Node const& node = GetNode(Type::Dictionary);
+
+    Entry const* const end = node.Entries + node.Size;
+    Entry const* const it = std::lower_bound(node.Entries, end, key,
+        [](Entry const& entry, std::string_view key) { return entry.Key < key; });
+
+    return it != end && it->Key == key ? BencodeValue(m_document, &it->Value) : BencodeValue();
+}
+
+BencodeValue BencodeValue::operator [] (std::string_view key) const
+{
+    BencodeValue const result = Find(key);
+    if (result.IsNull())
+    {
+        throw Exception(fmt::format("Bencoded dictionary key \"{}\" does not exist", key));
+    }
+
+    return result;
+}
+
+bool BencodeValue::Contains(std::string_view key) const
+{
+    return !Find(key).IsNull();
+}
+
+std::span<char const> BencodeValue::GetRawData() const
+{
+    return m_node != nullptr ? std::span<char const>(m_node->RawBegin, m_node->RawSize) : std::span<char const>();
+}
+
+ojson BencodeValue::ToJson() const
+{
+    ojson result;
+
+    switch (GetType())
+    {
+    case Type::Null:
+        break;
+
+    case Type::Integer:
+        result = AsInteger();
+        break;
+
+    case Type::String:
+        result = ojson(AsString());
+        break;
+
+    case Type::List:
+    {
+        Node const& node = GetNode(Type::List);
+        result = ojson::array();
+        result.reserve(node.Size);
+        for (std::size_t i = 0; i < node.Size; ++i)
+        {
+            result.push_back(BencodeValue(m_document, &node.Items[i]).ToJson());
+        }
+        break;
+    }
+
+    case Type::Dictionary:
+    {
+        Node const& node = GetNode(Type::Dictionary);
+        result = ojson::object();
+        result.reserve(node.Size);
+        for (std::size_t i = 0; i < node.Size; ++i)
+        {
+            Entry const& entry = node.Entries[i];
+            result.insert_or_assign(entry.Key, BencodeValue(m_document, &entry.Value).ToJson());
+        }
+        break;
+    }
+    }
+
+    return result;
+}
+
+BencodeValue::Node const& BencodeValue::GetNode(Type type) const
+{
+    if (GetType() != type)
+    {
+        throw Exception(fmt::format("Bencoded value is {}, not {}", TypeToString(GetType()), TypeToString(type)));
+    }
+
+    if (IsPending(*m_node))
+    {
+        m_document->DecodeContainer(*m_node);
+    }
+
+    return *m_node;
+}
+
+BencodeDocument::BencodeDocument(std::span<char const> data, Mode mode, std::size_t maxDepth) :
+    m_ownData(),
+    m_data(data),
+    m_arena(),
+    m_arenaMutex(),
+    m_containerExtents(),
+    m_root(nullptr)
+{
+    Parse(mode, maxDepth);
+}
+
+BencodeDocument::BencodeDocument(std::string&& data, Mode mode, std::size_t maxDepth) :
+    m_ownData(std::move(data)),
+    m_data(m_ownData),
+    m_arena(),
+    m_arenaMutex(),
+    m_containerExtents(),
+    m_root(nullptr)
+{
+    Parse(mode, maxDepth);
+}
+
+BencodeDocument::~BencodeDocument() = default;
+
+BencodeValue BencodeDocument::GetRoot() const
+{
+    return BencodeValue(this, m_root);
+}
+
+std::span<char const> BencodeDocument::GetData() const
+{
+    return m_data;
+}
+
+void BencodeDocument::Parse(Mode mode, std::size_t maxDepth)
+{
+    switch (mode)
+    {
+    case Mode::Eager:
+        ParseEager(maxDepth);
+        break;
+
+    case Mode::Lazy:
+        ParseLazy(maxDepth);
+        break;
+    }
+}
+
+void BencodeDocument::ParseEager(std::size_t maxDepth)
+{
+    struct Container
+    {
+        BencodeValue::Type ValueType;
+        char const* RawBegin;
+        std::size_t FirstChild;
+        std::string_view NextKey;
+    };
+
+    // Children of all open containers are collected here and moved to the arena in one piece once container is
+    // complete, so that each container ends up as a single allocation
+    std::vector<Container> containers;
+    std::vector<Node> items;
+    std::vector<Entry> entries;
+
+    BencodeDataCursor cursor(m_data);
+
+    while (true)
+    {
+        Node node{};
+        node.RawBegin = cursor.GetPosition();
+
+        bool isNodeComplete = true;
+
+        int const c = cursor.Peek();
+        switch (c)
+        {
+        case 'i':
+            cursor.Get();
+            node.ValueType = BencodeValue::Type::Integer;
+            node.Integer = cursor.GetInteger('e');
+            break;
+
+        case 'l':
+            cursor.Get();
+            containers.push_back({BencodeValue::Type::List, node.RawBegin, items.size(), {}});
+            isNodeComplete = false;
+            break;
+
+        case 'd':
+            cursor.Get();
+            containers.push_back({BencodeValue::Type::Dictionary, node.RawBegin, entries.size(), {}});
+            isNodeComplete = false;
+            break;
+
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+        {
+            std::string_view const value = cursor.GetString();
+            node.ValueType = BencodeValue::Type::String;
+            node.String = value.data();
+            node.Size = value.size();
+            break;
+        }
+
+        default:
+            throw Exception(fmt::format("Unable to decode value: {}", c));
+        }
+
+        BencodeDataCursor::CheckDepth(containers.size(), maxDepth);
+
+        // Store complete values in their containers, close finished containers and find out where the next value goes
+        while (true)
+        {
+            if (isNodeComplete)
+            {
+                node.RawSize = cursor.GetPosition() - node.RawBegin;
+
+                if (containers.empty())
+                {
+                    m_root = AllocateCopy(m_arena, &node, 1);
+                    return;
+                }
+
+                Container const& container = containers.back();
+                if (container.ValueType == BencodeValue::Type::List)
+                {
+                    items.push_back(node);
+                }
+                else
+                {
+                    entries.push_back({container.NextKey, node});
+                }
+
+                isNodeComplete = false;
+            }
+
+            Container& container = containers.back();
+
+            if (cursor.Peek() != 'e')
+            {
+                if (container.ValueType == BencodeValue::Type::Dictionary)
+                {
+                    container.NextKey = cursor.GetString();
+                }
+
+                break;
+            }
+
+            cursor.Get();
+
+            node = Node{};
+            node.ValueType = container.ValueType;
+            node.RawBegin = container.RawBegin;
+
+            if (container.ValueType == BencodeValue::Type::List)
+            {
+                node.Size = items.size() - container.FirstChild;
+                node.Items = AllocateCopy(m_arena, items.data() + container.FirstChild, node.Size);
+                items.resize(container.FirstChild);
+            }
+            else
+            {
+                SortEntries(entries, container.FirstChild);
+                node.Size = entries.size() - container.FirstChild;
+                node.Entries = AllocateCopy(m_arena, entries.data() + container.FirstChild, node.Size);
+                entries.resize(container.FirstChild);
+            }
+
+            containers.pop_back();
+            isNodeComplete = true;
+        }
+    }
+}
+
+void BencodeDocument::ParseLazy(std::size_t maxDepth)
+{
+    struct OpenContainer
+    {
+        std::size_t Extent;
+        char const* RawBegin;
+    };
+
+    // Whole document is skipped over once here, so that nesting limit and framing are enforced up front; extents of
+    // all containers are recorded on the way, so that no part of the document has to be skipped over again later
+    std::vector<OpenContainer> containers;
+
+    BencodeDataCursor cursor(m_data);
+
+    do
+    {
+        switch (cursor.Peek())
+        {
+        case 'i':
+            cursor.Get();
+            cursor.SkipInteger();
+            break;
+
+        case 'l':
+        case 'd':
+            containers.push_back({m_containerExtents.size(), cursor.GetPosition()});
+            m_containerExtents.push_back({});
+            cursor.Get();
+            BencodeDataCursor::CheckDepth(containers.size(), maxDepth);
+            break;
+
+        case 'e':
+        {
+            if (containers.empty())
+            {
+                throw Exception("Unexpected end of bencoded container");
+            }
+
+            cursor.Get();
+
+            OpenContainer const& container = containers.back();
+            ContainerExtent& extent = m_containerExtents[container.Extent];
+            extent.RawSize = cursor.GetPosition() - container.RawBegin;
+            extent.NextExtent = m_containerExtents.size();
+
+            containers.pop_back();
+            break;
+        }
+
+        default:
+            cursor.GetString();
+            break;
+        }
+    }
+    while (!containers.empty());
+
+    m_containerExtents.shrink_to_fit();
+
+    BencodeDataCursor rootCursor(m_data);
+    std::size_t nextExtent = 0;
+    Node const root = DecodeShallowValue(rootCursor, m_containerExtents, nextExtent);
+    m_root = AllocateCopy(m_arena, &root, 1);
+}
+
+void BencodeDocument::DecodeContainer(BencodeValue::Node const& container) const
+{
+    std::lock_guard<std::mutex> lock(m_arenaMutex);
+
+    if (!IsPending(container))
+    {
+        return;
+    }
+
+    BencodeDataCursor cursor({container.RawBegin, container.RawSize});
+    cursor.Get();
+
+    // Child containers directly follow their parent in the extents list, each one after descendants of the previous
+    std::size_t nextExtent = container.Extent + 1;
+
+    // Nodes come from the arena and are never const objects
+    Node& target = const_cast<Node&>(container);
+
+    if (container.ValueType == BencodeValue::Type::List)
+    {
+        std::vector<Node> items;
+        while (cursor.Peek() != 'e')
+        {
+            items.push_back(DecodeShallowValue(cursor, m_containerExtents, nextExtent));
+        }
+
+        target.Size = items.size();
+        target.Items = AllocateCopy(m_arena, items.data(), items.size());
+    }
+    else
+    {
+        std::vector<Entry> entries;
+        while (cursor.Peek() != 'e')
+        {
+            std::string_view const key = cursor.GetString();
+            entries.push_back({key, DecodeShallowValue(cursor, m_containerExtents, nextExtent)});
+        }
+
+        SortEntries(entries, 0);
+
+        target.Size = entries.size();
+        target.Entries = AllocateCopy(m_arena, entries.data(), entries.size());
+    }
+
+    std::atomic_ref<bool>(target.IsPending).store(false, std::memory_order_release);
+}
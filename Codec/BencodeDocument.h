@@ -0,0 +1,145 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "BencodeCodec.h"
+
+#include <jsoncons/json.hpp>
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using jsoncons::ojson;
+
+class BencodeDocument;
+
+// Lightweight handle to a value owned by BencodeDocument, valid for as long as the document is
+class BencodeValue
+{
+    friend class BencodeDocument;
+
+public:
+    enum struct Type
+    {
+        Null,
+        Integer,
+        String,
+        List,
+        Dictionary
+    };
+
+    struct Node;
+    struct Entry;
+
+public:
+    BencodeValue();
+
+    Type GetType() const;
+    bool IsNull() const;
+    bool IsInteger() const;
+    bool IsString() const;
+    bool IsList() const;
+    bool IsDictionary() const;
+
+    long long AsInteger() const;
+    // Points into the data document has been parsed from
+    std::string_view AsString() const;
+
+    // Number of list items or dictionary entries
+    std::size_t GetSize() const;
+
+    // List items
+    BencodeValue operator [] (std::size_t index) const;
+
+    // Dictionary entries, ordered by key
+    std::string_view GetKey(std::size_t index) const;
+    BencodeValue GetValue(std::size_t index) const;
+
+    // Binary search by key; Find returns null value and operator [] throws if there's no such key
+    BencodeValue Find(std::string_view key) const;
+    BencodeValue operator [] (std::string_view key) const;
+    bool Contains(std::string_view key) const;
+
+    // Exact bytes value has been decoded from
+    std::span<char const> GetRawData() const;
+
+    ojson ToJson() const;
+
+private:
+    BencodeValue(BencodeDocument const* document, Node const* node);
+
+    Node const& GetNode(Type type) const;
+
+private:
+    BencodeDocument const* m_document;
+    Node const* m_node;
+};
+
+// Bencoded document with all values allocated from a single arena which is released together with the document; strings
+// are not copied but refer to the source data
+class BencodeDocument
+{
+    friend class BencodeValue;
+
+public:
+    enum struct Mode
+    {
+        // Whole document is decoded up front
+        Eager,
+        // Structure is only validated up front, and each list or dictionary is decoded on first access, so that memory
+        // use is proportional to the part of the document actually looked at (plus a small extent record per container)
+        Lazy
+    };
+
+    struct ContainerExtent;
+
+public:
+    // Source data must outlive the document
+    explicit BencodeDocument(std::span<char const> data, Mode mode = Mode::Eager,
+        std::size_t maxDepth = BencodeCodec::DefaultMaxDepth);
+    // Source data is owned by the document
+    explicit BencodeDocument(std::string&& data, Mode mode = Mode::Eager,
+        std::size_t maxDepth = BencodeCodec::DefaultMaxDepth);
+    ~BencodeDocument();
+
+    BencodeDocument(BencodeDocument const&) = delete;
+    BencodeDocument& operator = (BencodeDocument const&) = delete;
+
+    BencodeValue GetRoot() const;
+    std::span<char const> GetData() const;
+
+private:
+    void Parse(Mode mode, std::size_t maxDepth);
+    void ParseEager(std::size_t maxDepth);
+    void ParseLazy(std::size_t maxDepth);
+
+    // Decodes children of pending container, safe to be called concurrently
+    void DecodeContainer(BencodeValue::Node const& container) const;
+
+private:
+    std::string const m_ownData;
+    std::span<char const> const m_data;
+    mutable std::pmr::monotonic_buffer_resource m_arena;
+    mutable std::mutex m_arenaMutex;
+    std::vector<ContainerExtent> m_containerExtents;
+    BencodeValue::Node const* m_root;
+};
@@ -0,0 +1,302 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "BencodeStructuralIndex.h"
+
+#include "BencodeDataCursor.h"
+
+#include "Common/Exception.h"
+
+#include <fmt/format.h>
+
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BTMIGRATE_BENCODE_X86_64
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__AVX2__)
+// AVX2 kernel is compiled in regardless of target flags and picked at runtime if supported by CPU
+#define BTMIGRATE_BENCODE_AVX2_RUNTIME
+#define BTMIGRATE_BENCODE_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define BTMIGRATE_BENCODE_AVX2_TARGET
+#endif
+#endif
+
+namespace
+{
+
+std::size_t const BlockSize = 64;
+
+// Bit per byte of block, set for ':' and 'e'
+std::uint64_t MarkBlockScalar(char const* block, std::size_t size)
+{
+    std::uint64_t result = 0;
+
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        if (block[i] == ':' || block[i] == 'e')
+        {
+            result |= std::uint64_t{1} << i;
+        }
+    }
+
+    return result;
+}
+
+#ifndef BTMIGRATE_BENCODE_X86_64
+
+std::uint64_t MarkBlockGeneric(char const* block)
+{
+    return MarkBlockScalar(block, BlockSize);
+}
+
+#else
+
+std::uint64_t MarkBlockSse2(char const* block)
+{
+    __m128i const colon = _mm_set1_epi8(':');
+    __m128i const end = _mm_set1_epi8('e');
+
+    std::uint64_t result = 0;
+
+    for (std::size_t i = 0; i < BlockSize / 16; ++i)
+    {
+        __m128i const chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block + i * 16));
+        __m128i const matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, end));
+        result |= std::uint64_t{static_cast<std::uint16_t>(_mm_movemask_epi8(matches))} << (i * 16);
+    }
+
+    return result;
+}
+
+BTMIGRATE_BENCODE_AVX2_TARGET
+std::uint64_t MarkBlockAvx2(char const* block)
+{
+    __m256i const colon = _mm256_set1_epi8(':');
+    __m256i const end = _mm256_set1_epi8('e');
+
+    __m256i const low = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block));
+    __m256i const high = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block + 32));
+    __m256i const lowMatches = _mm256_or_si256(_mm256_cmpeq_epi8(low, colon), _mm256_cmpeq_epi8(low, end));
+    __m256i const highMatches = _mm256_or_si256(_mm256_cmpeq_epi8(high, colon), _mm256_cmpeq_epi8(high, end));
+
+    return
+        std::uint64_t{static_cast<std::uint32_t>(_mm256_movemask_epi8(lowMatches))} |
+        std::uint64_t{static_cast<std::uint32_t>(_mm256_movemask_epi8(highMatches))} << 32;
+}
+
+#endif
+
+using MarkBlockFunction = std::uint64_t (*)(char const* block);
+
+MarkBlockFunction GetMarkBlockFunction()
+{
+#if defined(BTMIGRATE_BENCODE_AVX2_RUNTIME)
+    return __builtin_cpu_supports("avx2") ? &MarkBlockAvx2 : &MarkBlockSse2;
+#elif defined(BTMIGRATE_BENCODE_X86_64) && defined(__AVX2__)
+    return &MarkBlockAvx2;
+#elif defined(BTMIGRATE_BENCODE_X86_64)
+    return &MarkBlockSse2;
+#else
+    return &MarkBlockGeneric;
+#endif
+}
+
+// Blocks are only marked once walker needs a delimiter in them; since string contents are jumped over, blocks falling
+// entirely inside long strings (piece bitfields and such) are never looked at
+class StructuralWalker
+{
+public:
+    explicit StructuralWalker(std::span<char const> data) :
+        m_data(data),
+        m_markBlock(GetMarkBlock()),
+        m_position(0),
+        m_blockIndex(std::numeric_limits<std::size_t>::max()),
+        m_blockMask(0)
+    {
+        //
+    }
+
+    std::size_t GetPosition() const
+    {
+        return m_position;
+    }
+
+    char Peek() const
+    {
+        if (m_position >= m_data.size())
+        {
+            throw Exception("Unexpected end of bencoded data");
+        }
+
+        return m_data[m_position];
+    }
+
+    void Skip()
+    {
+        ++m_position;
+    }
+
+    void SkipInteger()
+    {
+        m_position = FindDelimiter(m_position + 1, 'e') + 1;
+    }
+
+    std::string_view GetString()
+    {
+        std::size_t const delimiter = FindDelimiter(m_position, ':');
+
+        std::uint64_t length = 0;
+        auto const [end, error] = std::from_chars(m_data.data() + m_position, m_data.data() + delimiter, length);
+        if (error != std::errc() || end != m_data.data() + delimiter || length > m_data.size() - delimiter - 1)
+        {
+            throw Exception(fmt::format("Unable to decode string length at offset {}", m_position));
+        }
+
+        std::string_view const result(m_data.data() + delimiter + 1, static_cast<std::size_t>(length));
+        m_position = delimiter + 1 + static_cast<std::size_t>(length);
+        return result;
+    }
+
+private:
+    static MarkBlockFunction GetMarkBlock()
+    {
+        static MarkBlockFunction const result = GetMarkBlockFunction();
+        return result;
+    }
+
+    std::uint64_t GetBlockMask(std::size_t blockIndex)
+    {
+        if (blockIndex != m_blockIndex)
+        {
+            std::size_t const blockOffset = blockIndex * BlockSize;
+            m_blockMask = m_data.size() - blockOffset >= BlockSize ? m_markBlock(m_data.data() + blockOffset) :
+                MarkBlockScalar(m_data.data() + blockOffset, m_data.size() - blockOffset);
+            m_blockIndex = blockIndex;
+        }
+
+        return m_blockMask;
+    }
+
+    // Nearest ':' or 'e' at or after given offset, which has to be the expected one since length prefixes and integers
+    // can't contain either
+    std::size_t FindDelimiter(std::size_t offset, char expected)
+    {
+        std::size_t const blockCount = (m_data.size() + BlockSize - 1) / BlockSize;
+
+        for (std::size_t blockIndex = offset / BlockSize; blockIndex < blockCount; ++blockIndex)
+        {
+            std::uint64_t mask = GetBlockMask(blockIndex);
+            if (blockIndex == offset / BlockSize)
+            {
+                mask &= ~std::uint64_t{0} << (offset % BlockSize);
+            }
+
+            if (mask != 0)
+            {
+                std::size_t const result = blockIndex * BlockSize + std::countr_zero(mask);
+                if (m_data[result] != expected)
+                {
+                    throw Exception(fmt::format("Expected '{}' at offset {}", expected, result));
+                }
+
+                return result;
+            }
+        }
+
+        throw Exception("Unexpected end of bencoded data");
+    }
+
+private:
+    std::span<char const> const m_data;
+    MarkBlockFunction const m_markBlock;
+    std::size_t m_position;
+    std::size_t m_blockIndex;
+    std::uint64_t m_blockMask;
+};
+
+void SkipOneValue(StructuralWalker& walker, std::size_t depth, std::size_t maxDepth)
+{
+    std::size_t const outerDepth = depth;
+
+    do
+    {
+        switch (walker.Peek())
+        {
+        case 'i':
+            walker.SkipInteger();
+            break;
+
+        case 'l':
+        case 'd':
+            walker.Skip();
+            BencodeDataCursor::CheckDepth(++depth, maxDepth);
+            break;
+
+        case 'e':
+            if (depth == outerDepth)
+            {
+                throw Exception("Unexpected end of bencoded container");
+            }
+
+            walker.Skip();
+            --depth;
+            break;
+
+        default:
+            walker.GetString();
+            break;
+        }
+    }
+    while (depth != outerDepth);
+}
+
+} // namespace
+
+BencodeStructuralIndex::BencodeStructuralIndex(std::span<char const> data, std::size_t maxDepth) :
+    m_entries()
+{
+    StructuralWalker walker(data);
+
+    if (walker.Peek() != 'd')
+    {
+        throw Exception("Bencoded data is not a dictionary");
+    }
+
+    walker.Skip();
+    BencodeDataCursor::CheckDepth(1, maxDepth);
+
+    while (walker.Peek() != 'e')
+    {
+        Entry entry;
+        entry.Key = walker.GetString();
+
+        std::size_t const valueOffset = walker.GetPosition();
+        SkipOneValue(walker, 1, maxDepth);
+        entry.Value = data.subspan(valueOffset, walker.GetPosition() - valueOffset);
+
+        m_entries.push_back(entry);
+    }
+}
+
+std::vector<BencodeStructuralIndex::Entry> const& BencodeStructuralIndex::GetEntries() const
+{
+    return m_entries;
+}
@@ -0,0 +1,48 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "BencodeCodec.h"
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Locates entries of top-level bencoded dictionary without decoding them, so that values could then be decoded on
+// their own (possibly in parallel). Data is classified in 64-byte blocks with SIMD compares marking every ':' and 'e'
+// byte; string length prefixes and integers are then delimited with bit scans, while string contents are jumped over
+// without being read
+class BencodeStructuralIndex
+{
+public:
+    struct Entry
+    {
+        std::string_view Key;
+        // Exact bytes value has been encoded as
+        std::span<char const> Value;
+    };
+
+public:
+    explicit BencodeStructuralIndex(std::span<char const> data, std::size_t maxDepth = BencodeCodec::DefaultMaxDepth);
+
+    // Entries in the order they appear in data, pointing into it
+    std::vector<Entry> const& GetEntries() const;
+
+private:
+    std::vector<Entry> m_entries;
+};
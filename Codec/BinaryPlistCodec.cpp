@@ -0,0 +1,972 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "BinaryPlistCodec.h"
+
+#include "Common/Exception.h"
+#include "Common/Util.h"
+
+#include <fmt/format.h>
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+namespace Detail
+{
+
+std::string_view const BinaryMagic = "bplist";
+std::string_view const BinaryHeader = "bplist00";
+std::size_t const TrailerSize = 32;
+
+// Dates are stored as seconds since 2001-01-01 00:00:00 UTC
+double const AppleEpochOffset = 978307200;
+
+std::size_t const MaxDepth = 512;
+
+std::string const UidKey = "CF$UID";
+
+} // namespace Detail
+
+struct ObjectType
+{
+    enum Enum
+    {
+        Simple = 0x0,
+        Integer = 0x1,
+        Real = 0x2,
+        Date = 0x3,
+        Data = 0x4,
+        AsciiString = 0x5,
+        Utf16String = 0x6,
+        Uid = 0x8,
+        Array = 0xa,
+        Set = 0xc,
+        Dict = 0xd
+    };
+};
+
+struct SimpleValue
+{
+    enum Enum
+    {
+        Null = 0x0,
+        False = 0x8,
+        True = 0x9
+    };
+};
+
+} // namespace
+
+namespace
+{
+
+void AppendUnicodeCodePoint(std::string& result, std::uint32_t code)
+{
+    if (code <= 0x7f)
+    {
+        result += static_cast<char>(code);
+    }
+    else if (code <= 0x7ff)
+    {
+        result += static_cast<char>(0xc0 | (code >> 6));
+        result += static_cast<char>(0x80 | (code & 0x3f));
+    }
+    else if (code <= 0xffff)
+    {
+        result += static_cast<char>(0xe0 | (code >> 12));
+        result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        result += static_cast<char>(0x80 | (code & 0x3f));
+    }
+    else
+    {
+        result += static_cast<char>(0xf0 | (code >> 18));
+        result += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        result += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+// Big-endian UTF-16, as binary property lists store non-ASCII strings
+std::string Utf16ToUtf8(std::span<char const> data)
+{
+    std::string result;
+    result.reserve(data.size());
+
+    auto const readUnit =
+        [&data](std::size_t index)
+        {
+            return static_cast<std::uint32_t>((static_cast<std::uint8_t>(data[index * 2]) << 8) |
+                static_cast<std::uint8_t>(data[index * 2 + 1]));
+        };
+
+    std::size_t const unitCount = data.size() / 2;
+    for (std::size_t i = 0; i < unitCount; ++i)
+    {
+        std::uint32_t code = readUnit(i);
+        if (code >= 0xd800 && code <= 0xdbff && i + 1 < unitCount)
+        {
+            std::uint32_t const lowCode = readUnit(i + 1);
+            if (lowCode >= 0xdc00 && lowCode <= 0xdfff)
+            {
+                code = 0x10000 + ((code - 0xd800) << 10) + (lowCode - 0xdc00);
+                ++i;
+            }
+        }
+
+        if (code >= 0xd800 && code <= 0xdfff)
+        {
+            throw Exception("Invalid unicode code point");
+        }
+
+        AppendUnicodeCodePoint(result, code);
+    }
+
+    return result;
+}
+
+// Returns the number of UTF-16 code units appended
+std::size_t AppendUtf16(std::string& result, std::string_view text)
+{
+    auto const appendUnit =
+        [&result](std::uint32_t unit)
+        {
+            result += static_cast<char>(unit >> 8);
+            result += static_cast<char>(unit & 0xff);
+        };
+
+    std::size_t unitCount = 0;
+    for (std::size_t i = 0; i < text.size();)
+    {
+        std::uint8_t const lead = static_cast<std::uint8_t>(text[i]);
+        std::size_t const length = lead < 0x80 ? 1 : (lead >> 5) == 0x06 ? 2 : (lead >> 4) == 0x0e ? 3 :
+            (lead >> 3) == 0x1e ? 4 : 0;
+        if (length == 0 || i + length > text.size())
+        {
+            throw Exception("Invalid UTF-8 string");
+        }
+
+        std::uint32_t code = length == 1 ? lead : lead & (0x7f >> length);
+        for (std::size_t j = 1; j < length; ++j)
+        {
+            std::uint8_t const trail = static_cast<std::uint8_t>(text[i + j]);
+            if ((trail & 0xc0) != 0x80)
+            {
+                throw Exception("Invalid UTF-8 string");
+            }
+
+            code = (code << 6) | (trail & 0x3f);
+        }
+
+        if ((code >= 0xd800 && code <= 0xdfff) || code > 0x10ffff)
+        {
+            throw Exception("Invalid UTF-8 string");
+        }
+
+        if (code >= 0x10000)
+        {
+            appendUnit(0xd800 + ((code - 0x10000) >> 10));
+            appendUnit(0xdc00 + ((code - 0x10000) & 0x3ff));
+            unitCount += 2;
+        }
+        else
+        {
+            appendUnit(code);
+            unitCount += 1;
+        }
+
+        i += length;
+    }
+
+    return unitCount;
+}
+
+template<typename T>
+T ParseXmlNumber(std::string_view text)
+{
+    text = Util::Trim(text);
+
+    T result;
+    auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+    if (error != std::errc() || end != text.data() + text.size())
+    {
+        throw Exception(fmt::format("Unable to parse property list number \"{}\"", text));
+    }
+
+    return result;
+}
+
+ojson ParseXmlInteger(std::string_view text)
+{
+    text = Util::Trim(text);
+    if (!text.empty() && text.front() == '-')
+    {
+        return ParseXmlNumber<std::int64_t>(text);
+    }
+
+    return ParseXmlNumber<std::uint64_t>(text);
+}
+
+// Dates are written as "YYYY-MM-DDTHH:MM:SSZ", always in UTC
+ojson ParseXmlDate(std::string_view text)
+{
+    text = Util::Trim(text);
+    if (text.size() != 20 || text[4] != '-' || text[7] != '-' || text[10] != 'T' || text[13] != ':' ||
+        text[16] != ':' || text[19] != 'Z')
+    {
+        throw Exception(fmt::format("Unable to parse property list date \"{}\"", text));
+    }
+
+    namespace chrono = std::chrono;
+
+    chrono::year_month_day const date{
+        chrono::year{ParseXmlNumber<int>(text.substr(0, 4))},
+        chrono::month{ParseXmlNumber<unsigned int>(text.substr(5, 2))},
+        chrono::day{ParseXmlNumber<unsigned int>(text.substr(8, 2))}};
+    if (!date.ok())
+    {
+        throw Exception(fmt::format("Unable to parse property list date \"{}\"", text));
+    }
+
+    chrono::seconds const time = chrono::sys_days{date}.time_since_epoch() +
+        chrono::hours{ParseXmlNumber<int>(text.substr(11, 2))} +
+        chrono::minutes{ParseXmlNumber<int>(text.substr(14, 2))} +
+        chrono::seconds{ParseXmlNumber<int>(text.substr(17, 2))};
+
+    return ojson(static_cast<double>(time.count()), jsoncons::semantic_tag::epoch_second);
+}
+
+// Data is base64-encoded, possibly split across multiple lines
+ojson ParseXmlData(std::string_view text)
+{
+    static std::array<std::int8_t, 256> const DecodeTable =
+        []
+        {
+            std::string_view const alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+            std::array<std::int8_t, 256> result;
+            result.fill(-1);
+            for (std::size_t i = 0; i < alphabet.size(); ++i)
+            {
+                result[static_cast<std::uint8_t>(alphabet[i])] = static_cast<std::int8_t>(i);
+            }
+            return result;
+        }();
+
+    std::vector<std::uint8_t> result;
+    result.reserve(text.size() / 4 * 3);
+
+    std::uint32_t bits = 0;
+    int bitCount = 0;
+    for (char const c : text)
+    {
+        if (c == '=')
+        {
+            break;
+        }
+
+        std::int8_t const value = DecodeTable[static_cast<std::uint8_t>(c)];
+        if (value < 0)
+        {
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            {
+                continue;
+            }
+
+            throw Exception("Invalid base64 data in property list");
+        }
+
+        bits = (bits << 6) | static_cast<std::uint32_t>(value);
+        bitCount += 6;
+        if (bitCount >= 8)
+        {
+            bitCount -= 8;
+            result.push_back(static_cast<std::uint8_t>(bits >> bitCount));
+        }
+    }
+
+    return ojson(jsoncons::byte_string_arg, result);
+}
+
+ojson FromXmlNode(pugi::xml_node const& node, std::size_t depth)
+{
+    if (depth > Detail::MaxDepth)
+    {
+        throw Exception(fmt::format("Property list is nested deeper than {} levels", Detail::MaxDepth));
+    }
+
+    std::string_view const name = node.name();
+
+    if (name == "dict")
+    {
+        ojson result = ojson::object();
+        for (pugi::xml_node key = node.first_child(); key; key = key.next_sibling())
+        {
+            pugi::xml_node const value = key.next_sibling();
+            if (std::string_view(key.name()) != "key" || !value)
+            {
+                throw Exception("Property list dictionary keys and values do not match");
+            }
+
+            result.insert_or_assign(std::string_view(key.child_value()), FromXmlNode(value, depth + 1));
+            key = value;
+        }
+        return result;
+    }
+
+    if (name == "array")
+    {
+        ojson result = ojson::array();
+        for (pugi::xml_node item = node.first_child(); item; item = item.next_sibling())
+        {
+            result.push_back(FromXmlNode(item, depth + 1));
+        }
+        return result;
+    }
+
+    if (name == "string")
+    {
+        return std::string(node.child_value());
+    }
+
+    if (name == "integer")
+    {
+        return ParseXmlInteger(node.child_value());
+    }
+
+    if (name == "real")
+    {
+        return ParseXmlNumber<double>(node.child_value());
+    }
+
+    if (name == "true" || name == "false")
+    {
+        return name == "true";
+    }
+
+    if (name == "date")
+    {
+        return ParseXmlDate(node.child_value());
+    }
+
+    if (name == "data")
+    {
+        return ParseXmlData(node.child_value());
+    }
+
+    throw Exception(fmt::format("Property list element <{}> is not supported", name));
+}
+
+ojson DecodeXml(std::span<char const> data)
+{
+    pugi::xml_document doc;
+    pugi::xml_parse_result const result = doc.load_buffer(data.data(), data.size());
+    if (!result)
+    {
+        throw Exception(fmt::format("Unable to parse XML property list: {}", result.description()));
+    }
+
+    pugi::xml_node const root = doc.child("plist").first_child();
+    if (!root)
+    {
+        throw Exception("XML property list is empty");
+    }
+
+    return FromXmlNode(root, 0);
+}
+
+class BinaryPlistReader
+{
+public:
+    explicit BinaryPlistReader(std::span<char const> data) :
+        m_data(data),
+        m_offsetSize(0),
+        m_referenceSize(0),
+        m_objectCount(0),
+        m_rootObject(0),
+        m_offsetTableOffset(0)
+    {
+        if (m_data.size() < Detail::BinaryHeader.size() + Detail::TrailerSize)
+        {
+            throw Exception("Binary property list is truncated");
+        }
+
+        std::size_t const trailerOffset = m_data.size() - Detail::TrailerSize;
+
+        m_offsetSize = ReadUnsigned(trailerOffset + 6, 1);
+        m_referenceSize = ReadUnsigned(trailerOffset + 7, 1);
+        m_objectCount = ReadUnsigned(trailerOffset + 8, 8);
+        m_rootObject = ReadUnsigned(trailerOffset + 16, 8);
+        m_offsetTableOffset = ReadUnsigned(trailerOffset + 24, 8);
+
+        if (!IsValidIntegerSize(m_offsetSize) || !IsValidIntegerSize(m_referenceSize) ||
+            m_offsetTableOffset < Detail::BinaryHeader.size() || m_offsetTableOffset > trailerOffset ||
+            m_objectCount > (trailerOffset - m_offsetTableOffset) / m_offsetSize || m_rootObject >= m_objectCount)
+        {
+            throw Exception("Binary property list trailer is invalid");
+        }
+    }
+
+    ojson Decode() const
+    {
+        return ReadObject(m_rootObject, 0);
+    }
+
+private:
+    static bool IsValidIntegerSize(std::uint64_t size)
+    {
+        return size == 1 || size == 2 || size == 4 || size == 8;
+    }
+
+    std::uint64_t ReadUnsigned(std::uint64_t offset, std::size_t size) const
+    {
+        std::uint64_t result = 0;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            result = (result << 8) | static_cast<std::uint8_t>(m_data[offset + i]);
+        }
+        return result;
+    }
+
+    // Objects may only occupy the space between header and offset table
+    void CheckObjectRange(std::uint64_t offset, std::uint64_t count, std::uint64_t itemSize) const
+    {
+        if (offset > m_offsetTableOffset || count > (m_offsetTableOffset - offset) / itemSize)
+        {
+            throw Exception("Binary property list object is out of bounds");
+        }
+    }
+
+    std::uint64_t GetObjectOffset(std::uint64_t reference) const
+    {
+        if (reference >= m_objectCount)
+        {
+            throw Exception(fmt::format("Binary property list object reference {} is out of range", reference));
+        }
+
+        std::uint64_t const offset = ReadUnsigned(m_offsetTableOffset + reference * m_offsetSize, m_offsetSize);
+        if (offset < Detail::BinaryHeader.size() || offset >= m_offsetTableOffset)
+        {
+            throw Exception(fmt::format("Binary property list object {} is out of bounds", reference));
+        }
+
+        return offset;
+    }
+
+    // Counts which don't fit into marker byte follow it as integer objects
+    std::uint64_t ReadCount(std::uint64_t& offset, unsigned int info) const
+    {
+        if (info != 0x0f)
+        {
+            return info;
+        }
+
+        CheckObjectRange(offset, 1, 1);
+        std::uint8_t const marker = static_cast<std::uint8_t>(m_data[offset]);
+        if ((marker >> 4) != ObjectType::Integer || (marker & 0x0f) > 3)
+        {
+            throw Exception("Binary property list object size is invalid");
+        }
+
+        std::size_t const size = std::size_t{1} << (marker & 0x0f);
+        CheckObjectRange(offset + 1, size, 1);
+        std::uint64_t const result = ReadUnsigned(offset + 1, size);
+        offset += 1 + size;
+        return result;
+    }
+
+    ojson ReadInteger(std::uint64_t offset, unsigned int info) const
+    {
+        if (info > 4)
+        {
+            throw Exception("Binary property list integer size is invalid");
+        }
+
+        std::size_t const size = std::size_t{1} << info;
+        CheckObjectRange(offset, size, 1);
+
+        if (size < 8)
+        {
+            return ReadUnsigned(offset, size);
+        }
+
+        if (size == 8)
+        {
+            // 8-byte integers are signed, larger unsigned ones are stored as 16-byte
+            return static_cast<std::int64_t>(ReadUnsigned(offset, size));
+        }
+
+        std::uint64_t const highPart = ReadUnsigned(offset, 8);
+        std::uint64_t const lowPart = ReadUnsigned(offset + 8, 8);
+        if (highPart == 0)
+        {
+            return lowPart;
+        }
+
+        if (highPart == std::numeric_limits<std::uint64_t>::max() && static_cast<std::int64_t>(lowPart) < 0)
+        {
+            return static_cast<std::int64_t>(lowPart);
+        }
+
+        throw Exception("Binary property list integer is out of range");
+    }
+
+    double ReadReal(std::uint64_t offset, unsigned int info) const
+    {
+        if (info == 2)
+        {
+            CheckObjectRange(offset, 4, 1);
+            return std::bit_cast<float>(static_cast<std::uint32_t>(ReadUnsigned(offset, 4)));
+        }
+
+        if (info == 3)
+        {
+            CheckObjectRange(offset, 8, 1);
+            return std::bit_cast<double>(ReadUnsigned(offset, 8));
+        }
+
+        throw Exception("Binary property list real size is invalid");
+    }
+
+    ojson ReadObject(std::uint64_t reference, std::size_t depth) const
+    {
+        if (depth > Detail::MaxDepth)
+        {
+            throw Exception(fmt::format("Property list is nested deeper than {} levels", Detail::MaxDepth));
+        }
+
+        std::uint64_t offset = GetObjectOffset(reference);
+        std::uint8_t const marker = static_cast<std::uint8_t>(m_data[offset++]);
+        unsigned int const info = marker & 0x0f;
+
+        switch (marker >> 4)
+        {
+        case ObjectType::Simple:
+            switch (info)
+            {
+            case SimpleValue::Null:
+                return ojson::null();
+            case SimpleValue::False:
+                return false;
+            case SimpleValue::True:
+                return true;
+            }
+            break;
+
+        case ObjectType::Integer:
+            return ReadInteger(offset, info);
+
+        case ObjectType::Real:
+            return ReadReal(offset, info);
+
+        case ObjectType::Date:
+            return ojson(ReadReal(offset, info) + Detail::AppleEpochOffset, jsoncons::semantic_tag::epoch_second);
+
+        case ObjectType::Data:
+            {
+                std::uint64_t const size = ReadCount(offset, info);
+                CheckObjectRange(offset, size, 1);
+                std::uint8_t const* const data = reinterpret_cast<std::uint8_t const*>(m_data.data() + offset);
+                return ojson(jsoncons::byte_string_arg, std::vector<std::uint8_t>(data, data + size));
+            }
+
+        case ObjectType::AsciiString:
+            {
+                std::uint64_t const size = ReadCount(offset, info);
+                CheckObjectRange(offset, size, 1);
+                return std::string(m_data.data() + offset, size);
+            }
+
+        case ObjectType::Utf16String:
+            {
+                std::uint64_t const size = ReadCount(offset, info);
+                CheckObjectRange(offset, size, 2);
+                return Utf16ToUtf8(m_data.subspan(offset, size * 2));
+            }
+
+        case ObjectType::Uid:
+            {
+                CheckObjectRange(offset, info + 1, 1);
+                ojson result = ojson::object();
+                result.insert_or_assign(Detail::UidKey, ReadUnsigned(offset, info + 1));
+                return result;
+            }
+
+        case ObjectType::Array:
+        case ObjectType::Set:
+            {
+                std::uint64_t const count = ReadCount(offset, info);
+                CheckObjectRange(offset, count, m_referenceSize);
+
+                ojson result = ojson::array();
+                result.reserve(count);
+                for (std::uint64_t i = 0; i < count; ++i)
+                {
+                    result.push_back(ReadObject(ReadUnsigned(offset + i * m_referenceSize, m_referenceSize),
+                        depth + 1));
+                }
+                return result;
+            }
+
+        case ObjectType::Dict:
+            {
+                // All key references go first, followed by all value references
+                std::uint64_t const count = ReadCount(offset, info);
+                CheckObjectRange(offset, count * 2, m_referenceSize);
+
+                std::uint64_t const valuesOffset = offset + count * m_referenceSize;
+
+                ojson result = ojson::object();
+                result.reserve(count);
+                for (std::uint64_t i = 0; i < count; ++i)
+                {
+                    ojson const key = ReadObject(ReadUnsigned(offset + i * m_referenceSize, m_referenceSize),
+                        depth + 1);
+                    if (!key.is_string())
+                    {
+                        throw Exception("Binary property list dictionary key is not a string");
+                    }
+
+                    result.insert_or_assign(key.as_string_view(),
+                        ReadObject(ReadUnsigned(valuesOffset + i * m_referenceSize, m_referenceSize), depth + 1));
+                }
+                return result;
+            }
+        }
+
+        throw Exception(fmt::format("Binary property list object type {:#04x} is not supported", marker));
+    }
+
+private:
+    std::span<char const> const m_data;
+    std::uint64_t m_offsetSize;
+    std::uint64_t m_referenceSize;
+    std::uint64_t m_objectCount;
+    std::uint64_t m_rootObject;
+    std::uint64_t m_offsetTableOffset;
+};
+
+void AppendUnsigned(std::string& output, std::uint64_t value, std::size_t size)
+{
+    for (std::size_t i = size; i > 0; --i)
+    {
+        output += static_cast<char>((value >> ((i - 1) * 8)) & 0xff);
+    }
+}
+
+std::size_t GetUnsignedSize(std::uint64_t value)
+{
+    return value <= 0xff ? 1 : value <= 0xffff ? 2 : value <= 0xffffffff ? 4 : 8;
+}
+
+void AppendInteger(std::string& output, std::uint64_t value)
+{
+    if (value > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+    {
+        output += static_cast<char>((ObjectType::Integer << 4) | 4);
+        AppendUnsigned(output, 0, 8);
+        AppendUnsigned(output, value, 8);
+        return;
+    }
+
+    std::size_t const size = GetUnsignedSize(value);
+    output += static_cast<char>((ObjectType::Integer << 4) | std::countr_zero(size));
+    AppendUnsigned(output, value, size);
+}
+
+void AppendMarker(std::string& output, ObjectType::Enum type, std::uint64_t count)
+{
+    if (count < 0x0f)
+    {
+        output += static_cast<char>((type << 4) | count);
+    }
+    else
+    {
+        output += static_cast<char>((type << 4) | 0x0f);
+        AppendInteger(output, count);
+    }
+}
+
+void AppendReal(std::string& output, ObjectType::Enum type, double value)
+{
+    output += static_cast<char>((type << 4) | 3);
+    AppendUnsigned(output, std::bit_cast<std::uint64_t>(value), 8);
+}
+
+void AppendString(std::string& output, std::string_view value)
+{
+    bool const isAscii = std::all_of(value.begin(), value.end(), [](char c) { return (c & 0x80) == 0; });
+    if (isAscii)
+    {
+        AppendMarker(output, ObjectType::AsciiString, value.size());
+        output.append(value);
+        return;
+    }
+
+    std::string utf16Value;
+    std::size_t const unitCount = AppendUtf16(utf16Value, value);
+    AppendMarker(output, ObjectType::Utf16String, unitCount);
+    output.append(utf16Value);
+}
+
+std::string EncodeScalar(ojson const& value)
+{
+    std::string result;
+
+    if (value.is_bool())
+    {
+        result += static_cast<char>(value.as<bool>() ? SimpleValue::True : SimpleValue::False);
+    }
+    else if (value.tag() == jsoncons::semantic_tag::epoch_second && value.is_number())
+    {
+        AppendReal(result, ObjectType::Date, value.as<double>() - Detail::AppleEpochOffset);
+    }
+    else if (value.is_int64())
+    {
+        std::int64_t const intValue = value.as<std::int64_t>();
+        if (intValue < 0)
+        {
+            // Negative integers are always 8 bytes long
+            result += static_cast<char>((ObjectType::Integer << 4) | 3);
+            AppendUnsigned(result, static_cast<std::uint64_t>(intValue), 8);
+        }
+        else
+        {
+            AppendInteger(result, static_cast<std::uint64_t>(intValue));
+        }
+    }
+    else if (value.is_uint64())
+    {
+        AppendInteger(result, value.as<std::uint64_t>());
+    }
+    else if (value.is_double())
+    {
+        AppendReal(result, ObjectType::Real, value.as<double>());
+    }
+    else if (value.is_byte_string())
+    {
+        auto const data = value.as_byte_string_view();
+        AppendMarker(result, ObjectType::Data, data.size());
+        result.append(reinterpret_cast<char const*>(data.data()), data.size());
+    }
+    else if (value.is_null())
+    {
+        throw Exception("Null values are not representable in property lists");
+    }
+    else
+    {
+        throw Exception("Value is not representable in property lists");
+    }
+
+    return result;
+}
+
+// Objects are collected first to know how wide references have to be, then written out in one go; equal strings and
+// scalars are stored once, which for lists of similar dictionaries leaves little more than the references
+class BinaryPlistWriter
+{
+public:
+    explicit BinaryPlistWriter(std::ostream& stream) :
+        m_stream(stream),
+        m_objects(),
+        m_references(),
+        m_stringObjects(),
+        m_scalarObjects()
+    {
+        //
+    }
+
+    void Encode(ojson const& root)
+    {
+        AddObject(root);
+
+        std::size_t const referenceSize = GetUnsignedSize(m_objects.size() - 1);
+
+        std::string buffer(Detail::BinaryHeader);
+
+        std::vector<std::uint64_t> offsets;
+        offsets.reserve(m_objects.size());
+        for (Object const& object : m_objects)
+        {
+            offsets.push_back(buffer.size());
+            WriteObject(buffer, object, referenceSize);
+        }
+
+        std::uint64_t const offsetTableOffset = buffer.size();
+        std::size_t const offsetSize = GetUnsignedSize(offsetTableOffset);
+        for (std::uint64_t const offset : offsets)
+        {
+            AppendUnsigned(buffer, offset, offsetSize);
+        }
+
+        buffer.append(6, '\0');
+        AppendUnsigned(buffer, offsetSize, 1);
+        AppendUnsigned(buffer, referenceSize, 1);
+        AppendUnsigned(buffer, m_objects.size(), 8);
+        AppendUnsigned(buffer, 0, 8);
+        AppendUnsigned(buffer, offsetTableOffset, 8);
+
+        m_stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
+
+private:
+    // One of: container value, whose items are referred to by a run of references starting at `FirstReference`;
+    // string (which could also be a dictionary key); or already encoded scalar
+    struct Object
+    {
+        ojson const* Container;
+        std::string_view String;
+        std::string const* EncodedScalar;
+        std::size_t FirstReference;
+    };
+
+    std::uint64_t AddString(std::string_view value)
+    {
+        auto const [it, isInserted] = m_stringObjects.try_emplace(value, m_objects.size());
+        if (isInserted)
+        {
+            m_objects.push_back({nullptr, value, nullptr, 0});
+        }
+        return it->second;
+    }
+
+    std::uint64_t AddObject(ojson const& value)
+    {
+        if (value.is_string())
+        {
+            return AddString(value.as_string_view());
+        }
+
+        if (!value.is_array() && !value.is_object())
+        {
+            // Map nodes don't move, so objects may keep pointing to the keys
+            auto const [it, isInserted] = m_scalarObjects.try_emplace(EncodeScalar(value), m_objects.size());
+            if (isInserted)
+            {
+                m_objects.push_back({nullptr, {}, &it->first, 0});
+            }
+            return it->second;
+        }
+
+        std::uint64_t const index = m_objects.size();
+        m_objects.push_back({&value, {}, nullptr, 0});
+
+        std::vector<std::uint64_t> references;
+        if (value.is_array())
+        {
+            references.reserve(value.size());
+            for (ojson const& item : value.array_range())
+            {
+                references.push_back(AddObject(item));
+            }
+        }
+        else
+        {
+            references.reserve(value.size() * 2);
+            for (auto const& item : value.object_range())
+            {
+                references.push_back(AddString(item.key()));
+            }
+            for (auto const& item : value.object_range())
+            {
+                references.push_back(AddObject(item.value()));
+            }
+        }
+
+        m_objects[index].FirstReference = m_references.size();
+        m_references.insert(m_references.end(), references.begin(), references.end());
+
+        return index;
+    }
+
+    void WriteObject(std::string& buffer, Object const& object, std::size_t referenceSize) const
+    {
+        if (object.EncodedScalar != nullptr)
+        {
+            buffer.append(*object.EncodedScalar);
+            return;
+        }
+
+        if (object.Container == nullptr)
+        {
+            AppendString(buffer, object.String);
+            return;
+        }
+
+        ojson const& value = *object.Container;
+
+        std::size_t const referenceCount = value.is_array() ? value.size() : value.size() * 2;
+        AppendMarker(buffer, value.is_array() ? ObjectType::Array : ObjectType::Dict, value.size());
+        for (std::size_t i = 0; i < referenceCount; ++i)
+        {
+            AppendUnsigned(buffer, m_references[object.FirstReference + i], referenceSize);
+        }
+    }
+
+private:
+    std::ostream& m_stream;
+    std::vector<Object> m_objects;
+    std::vector<std::uint64_t> m_references;
+    std::unordered_map<std::string_view, std::uint64_t> m_stringObjects;
+    std::unordered_map<std::string, std::uint64_t> m_scalarObjects;
+};
+
+} // namespace
+
+BinaryPlistCodec::BinaryPlistCodec() = default;
+BinaryPlistCodec::~BinaryPlistCodec() = default;
+
+void BinaryPlistCodec::Decode(std::span<char const> data, ojson& root) const
+{
+    std::string_view const header(data.data(), std::min(data.size(), Detail::BinaryHeader.size()));
+
+    if (header == Detail::BinaryHeader)
+    {
+        root = BinaryPlistReader(data).Decode();
+    }
+    else if (header.starts_with(Detail::BinaryMagic))
+    {
+        throw Exception(fmt::format("Binary property list version \"{}\" is not supported",
+            header.substr(Detail::BinaryMagic.size())));
+    }
+    else
+    {
+        root = DecodeXml(data);
+    }
+}
+
+void BinaryPlistCodec::Decode(std::istream& stream, ojson& root) const
+{
+    std::string const data = Util::ReadStream(stream);
+    Decode(data, root);
+}
+
+void BinaryPlistCodec::Encode(std::ostream& stream, ojson const& root) const
+{
+    BinaryPlistWriter(stream).Encode(root);
+}
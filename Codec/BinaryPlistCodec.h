@@ -0,0 +1,40 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "IStructuredDataCodec.h"
+
+#include <span>
+
+// Property list values map onto JSON ones, except for dates which become doubles tagged as epoch seconds, data which
+// becomes byte strings, and UIDs which become {"CF$UID": n} objects (same as `plutil` shows them)
+class BinaryPlistCodec : public IStructuredDataCodec
+{
+public:
+    BinaryPlistCodec();
+    ~BinaryPlistCodec() override;
+
+    // Decodes directly from memory, accepting both binary and XML property lists
+    void Decode(std::span<char const> data, ojson& root) const;
+
+public:
+    // IStructuredDataCodec
+    // Accepts both binary and XML property lists
+    void Decode(std::istream& stream, ojson& root) const override;
+    // Always produces binary property list, with duplicate strings (e.g. dictionary keys) stored once
+    void Encode(std::ostream& stream, ojson const& root) const override;
+};
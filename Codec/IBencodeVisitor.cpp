@@ -0,0 +1,3 @@
+#include "IBencodeVisitor.h"
+
+IBencodeVisitor::~IBencodeVisitor() = default;
@@ -0,0 +1,36 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string_view>
+
+// Receives bencoded data as a sequence of events, without building a tree of values; string views passed to the
+// visitor point into the data being decoded
+class IBencodeVisitor
+{
+public:
+    virtual ~IBencodeVisitor();
+
+    virtual void BeginDictionary() = 0;
+    // Return false to skip the value stored under this key altogether
+    virtual bool Key(std::string_view key) = 0;
+    virtual void BeginList() = 0;
+    virtual void End() = 0;
+
+    virtual void Integer(long long value) = 0;
+    virtual void String(std::string_view value) = 0;
+};
@@ -16,178 +16,142 @@
 
 #include "PickleCodec.h"
 
+#include "PickleOpcode.h"
+#include "PickleWriter.h"
+
 #include "Common/Exception.h"
+#include "Common/IForwardIterator.h"
 #include "Common/Util.h"
 
 #include <fmt/format.h>
+#include <fmt/ostream.h>
 
 #include <algorithm>
+#include <array>
 #include <bit>
+#include <charconv>
 #include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
-#include <map>
-#include <stack>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace
 {
-
-// Taken from Python sources
-enum opcode
-{
-    MARK            = '(',
-    STOP            = '.',
-    POP             = '0',
-    POP_MARK        = '1',
-    DUP             = '2',
-    FLOAT           = 'F',
-    INT             = 'I',
-    BININT          = 'J',
-    BININT1         = 'K',
-    LONG            = 'L',
-    BININT2         = 'M',
-    NONE            = 'N',
-    PERSID          = 'P',
-    BINPERSID       = 'Q',
-    REDUCE          = 'R',
-    STRING          = 'S',
-    BINSTRING       = 'T',
-    SHORT_BINSTRING = 'U',
-    UNICODE_        = 'V',
-    BINUNICODE      = 'X',
-    APPEND          = 'a',
-    BUILD           = 'b',
-    GLOBAL          = 'c',
-    DICT            = 'd',
-    EMPTY_DICT      = '}',
-    APPENDS         = 'e',
-    GET             = 'g',
-    BINGET          = 'h',
-    INST            = 'i',
-    LONG_BINGET     = 'j',
-    LIST            = 'l',
-    EMPTY_LIST      = ']',
-    OBJ             = 'o',
-    PUT             = 'p',
-    BINPUT          = 'q',
-    LONG_BINPUT     = 'r',
-    SETITEM         = 's',
-    TUPLE           = 't',
-    EMPTY_TUPLE     = ')',
-    SETITEMS        = 'u',
-    BINFLOAT        = 'G',
-
-    /* Protocol 2. */
-    PROTO       = 0x80,
-    NEWOBJ      = 0x81,
-    EXT1        = 0x82,
-    EXT2        = 0x83,
-    EXT4        = 0x84,
-    TUPLE1      = 0x85,
-    TUPLE2      = 0x86,
-    TUPLE3      = 0x87,
-    NEWTRUE     = 0x88,
-    NEWFALSE    = 0x89,
-    LONG1       = 0x8a,
-    LONG4       = 0x8b,
-
-    /* Protocol 3 (Python 3.x) */
-    BINBYTES       = 'B',
-    SHORT_BINBYTES = 'C',
-
-    /* Protocol 4 */
-    SHORT_BINUNICODE = 0x8c,
-    BINUNICODE8      = 0x8d,
-    BINBYTES8        = 0x8e,
-    EMPTY_SET        = 0x8f,
-    ADDITEMS         = 0x90,
-    FROZENSET        = 0x91,
-    NEWOBJ_EX        = 0x92,
-    STACK_GLOBAL     = 0x93,
-    MEMOIZE          = 0x94,
-    FRAME            = 0x95,
-
-    /* Protocol 5 */
-    BYTEARRAY8       = 0x96,
-    NEXT_BUFFER      = 0x97,
-    READONLY_BUFFER  = 0x98
-};
-
-struct StackItem
+namespace Detail
 {
-    StackItem() :
-        Type(0),
-        Value()
-    {
 
-    }
-
-    explicit StackItem(int type, ojson const& value = ojson()) :
-        Type(type),
-        Value(value)
-    {
-        //
-    }
+std::size_t const MaxDepth = 512;
 
-    int Type;
-    ojson Value;
-};
+} // namespace Detail
+} // namespace
 
-std::string UnicodeCodePointToUtf8(unsigned int code)
+namespace
 {
-    std::string result;
 
+void AppendUnicodeCodePoint(std::string& result, unsigned int code)
+{
     if (code <= 0x7f)
     {
-        result.resize(1);
-        result[0] = static_cast<char>(code);
+        result += static_cast<char>(code);
     }
     else if (code <= 0x7FF)
     {
-        result.resize(2);
-        result[1] = static_cast<char>(0x80 | (0x3f & code));
-        result[0] = static_cast<char>(0xc0 | (0x1f & (code >> 6)));
+        result += static_cast<char>(0xc0 | (0x1f & (code >> 6)));
+        result += static_cast<char>(0x80 | (0x3f & code));
     }
     else if (code <= 0xFFFF)
     {
-        result.resize(3);
-        result[2] = static_cast<char>(0x80 | (0x3f & code));
-        result[1] = static_cast<char>(0x80 | (0x3f & (code >> 6)));
-        result[0] = static_cast<char>(0xe0 | (0x0f & (code >> 12)));
+        result += static_cast<char>(0xe0 | (0x0f & (code >> 12)));
+        result += static_cast<char>(0x80 | (0x3f & (code >> 6)));
+        result += static_cast<char>(0x80 | (0x3f & code));
     }
     else if (code <= 0x10FFFF)
     {
-        result.resize(4);
-        result[3] = static_cast<char>(0x80 | (0x3f & code));
-        result[2] = static_cast<char>(0x80 | (0x3f & (code >> 6)));
-        result[1] = static_cast<char>(0x80 | (0x3f & (code >> 12)));
-        result[0] = static_cast<char>(0xf0 | (0x07 & (code >> 18)));
+        result += static_cast<char>(0xf0 | (0x07 & (code >> 18)));
+        result += static_cast<char>(0x80 | (0x3f & (code >> 12)));
+        result += static_cast<char>(0x80 | (0x3f & (code >> 6)));
+        result += static_cast<char>(0x80 | (0x3f & code));
     }
     else
     {
         throw Exception("Invalid unicode code point");
     }
+}
+
+unsigned int ParseHexCode(std::string_view& text, std::size_t length)
+{
+    unsigned int result = 0;
+    if (text.size() < length)
+    {
+        throw Exception("Invalid unicode code point");
+    }
+
+    auto const [end, error] = std::from_chars(text.data(), text.data() + length, result, 16);
+    if (error != std::errc() || end != text.data() + length)
+    {
+        throw Exception("Invalid unicode code point");
+    }
 
+    text.remove_prefix(length);
     return result;
 }
 
-std::string UnicodeToUtf8(std::string const& text)
+// Handles both "raw-unicode-escape" encoding of UNICODE opcode (where characters up to U+00FF are stored as is) and
+// quoted string representation of STRING opcode; unescaped runs are copied in one go
+std::string UnicodeToUtf8(std::string_view text)
 {
     std::string result;
+    result.reserve(text.size());
 
-    for (auto it = text.cbegin(), end = text.cend(); it != end; ++it)
+    while (!text.empty())
     {
-        if (*it != '\\')
+        auto const special = std::find_if(text.begin(), text.end(),
+            [](char c) { return c == '\\' || static_cast<unsigned char>(c) >= 0x80; });
+        std::size_t const runLength = static_cast<std::size_t>(special - text.begin());
+        result.append(text.substr(0, runLength));
+        text.remove_prefix(runLength);
+
+        if (text.empty())
+        {
+            break;
+        }
+
+        char const c = text.front();
+        text.remove_prefix(1);
+
+        if (c != '\\')
         {
-            result += *it;
+            AppendUnicodeCodePoint(result, static_cast<unsigned char>(c));
             continue;
         }
 
-        ++it;
-        switch (*it)
+        if (text.empty())
+        {
+            throw Exception("Unterminated escape sequence in pickled string");
+        }
+
+        char const kind = text.front();
+        text.remove_prefix(1);
+
+        unsigned int code = 0;
+        switch (kind)
         {
         case 'u':
+            code = ParseHexCode(text, 4);
+            break;
+        case 'U':
+            code = ParseHexCode(text, 8);
             break;
+        case 'x':
+            result += static_cast<char>(ParseHexCode(text, 2));
+            continue;
         case 'b':
             result += '\b';
             continue;
@@ -206,366 +170,1093 @@ std::string UnicodeToUtf8(std::string const& text)
         case '"':
         case '\\':
         default:
-            result += *it;
+            result += kind;
             continue;
         }
 
-        std::string codeBuffer;
-        codeBuffer += *(++it);
-        codeBuffer += *(++it);
-        codeBuffer += *(++it);
-        codeBuffer += *(++it);
-
-        unsigned int code = std::strtol(codeBuffer.c_str(), nullptr, 16);
         if (code >= 0xd800 && code <= 0xdbff)
         {
-            if (*(++it) != '\\')
-            {
-                throw Exception("Invalid unicode code point");
-            }
-
-            if (*(++it) != 'u')
+            if (!text.starts_with("\\u"))
             {
                 throw Exception("Invalid unicode code point");
             }
 
-            codeBuffer.clear();
-            codeBuffer += *(++it);
-            codeBuffer += *(++it);
-            codeBuffer += *(++it);
-            codeBuffer += *(++it);
+            text.remove_prefix(2);
 
-            unsigned int const code2 = std::strtol(codeBuffer.c_str(), nullptr, 16);
-            if (code2 >= 0xdc00 && code2 <= 0xdfff)
+            unsigned int const code2 = ParseHexCode(text, 4);
+            if (code2 < 0xdc00 || code2 > 0xdfff)
             {
                 throw Exception("Invalid unicode code point");
             }
 
-            code = ((code - 0xd800) << 10) | (code2 - 0xdc00);
+            code = 0x10000 + (((code - 0xd800) << 10) | (code2 - 0xdc00));
         }
 
-        result += UnicodeCodePointToUtf8(code);
+        AppendUnicodeCodePoint(result, code);
     }
 
     return result;
 }
 
-void PopMark(std::stack<StackItem>& stack)
+template<typename T>
+T ParseNumber(std::string_view text)
 {
-    while (!stack.empty() && stack.top().Type != MARK)
-    {
-        stack.pop();
-    }
-    if (!stack.empty())
+    T result{};
+    auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+    if (error != std::errc() || end != text.data() + text.size())
     {
-        stack.pop();
+        throw Exception(fmt::format("Unable to parse pickled number \"{}\"", text));
     }
+
+    return result;
 }
 
-template<typename T>
-T GetBinNumber(std::istream& stream, std::endian order = std::endian::little)
+struct PickleObject;
+
+struct StackItem
 {
-    static_assert(std::is_integral_v<T> || std::is_floating_point_v<T>);
+    StackItem() :
+        Value(),
+        Object(nullptr)
+    {
+        //
+    }
 
-    char result[sizeof(T)];
-    stream.read(result, sizeof(result));
+    explicit StackItem(ojson&& value) :
+        Value(std::move(value)),
+        Object(nullptr)
+    {
+        //
+    }
 
-    if (order != std::endian::native)
+    explicit StackItem(PickleObject* object) :
+        Value(),
+        Object(object)
     {
-        std::reverse(result, result + sizeof(result));
+        //
     }
 
-    return *reinterpret_cast<const T*>(result);
-}
+    ojson Value;
+    PickleObject* Object;
+};
 
-template<typename LengthT>
-std::string GetBinUnicode(std::istream& stream, std::endian order = std::endian::little)
+// Lists, tuples and dictionaries are kept apart from the stack so that DUP and memo lookups share them instead of
+// copying; reference count only covers slots in other containers and is used to move, not copy, singly-owned ones.
+// Objects put into memo are always copied, since they may be fetched from it at any later point.
+struct PickleObject
 {
-    LengthT const length = GetBinNumber<LengthT>(stream, order);
+    explicit PickleObject(bool isDict) :
+        IsDict(isDict),
+        IsMemoized(false),
+        IsDetached(false),
+        RefCount(0),
+        Items(),
+        Entries()
+    {
+        //
+    }
 
-    std::string result;
-    result.resize(length);
-    stream.read(result.data(), length);
-    return result;
-}
+    bool IsDict;
+    bool IsMemoized;
+    bool IsDetached;
+    std::size_t RefCount;
+    std::vector<StackItem> Items;
+    std::vector<std::pair<std::string, StackItem>> Entries;
+};
 
-} // namespace
+class PickleMachine
+{
+public:
+    PickleMachine() :
+        m_stack(),
+        m_marks(),
+        m_memo(),
+        m_objects(),
+        m_captureKey(),
+        m_captureList(nullptr),
+        m_capturedItems()
+    {
+        //
+    }
 
-PickleCodec::PickleCodec() = default;
-PickleCodec::~PickleCodec() = default;
+    // Elements of list stored under given key in top-level dictionary (or top-level object state) are handed out via
+    // `TakeCapturedItem()` as soon as they are appended to the list, instead of staying in it
+    void CaptureList(std::string_view key)
+    {
+        m_captureKey = key;
+    }
 
-void PickleCodec::Decode(std::istream& stream, ojson& root) const
-{
-    std::stack<StackItem> stack, stack2;
-    std::map<long long, StackItem> memo;
+    std::string const& GetCaptureKey() const
+    {
+        return m_captureKey;
+    }
 
-    [[maybe_unused]] int proto = 0;
+    bool IsListCaptured() const
+    {
+        return m_captureList != nullptr;
+    }
 
-    bool stopped = false;
-    StackItem currentItem, currentItem2;
-    std::string buffer, buffer2;
-    while (!stopped && !stream.eof())
+    bool HasCapturedItems() const
     {
-        int const code = GetBinNumber<std::uint8_t>(stream);
-        switch (code)
-        {
-        case MARK:
-            stack.push(StackItem(code));
-            break;
+        return !m_capturedItems.empty();
+    }
 
-        case STOP:
-            root = stack.top().Value;
-            stack.pop(); // result
-            stopped = true;
-            break;
+    ojson TakeCapturedItem()
+    {
+        ojson result = std::move(m_capturedItems.front());
+        m_capturedItems.pop_front();
+        return result;
+    }
 
-        case POP:
-            stack.pop();
-            break;
+    bool IsEmpty() const
+    {
+        return m_stack.empty();
+    }
 
-        case POP_MARK:
-            PopMark(stack);
-            break;
+    void Push(ojson value)
+    {
+        m_stack.emplace_back(std::move(value));
+    }
 
-        case DUP:
-            stack.push(stack.top());
-            break;
+    void PushContainer(bool isDict)
+    {
+        PickleObject& container = m_objects.emplace_back(isDict);
+        CheckListCapture(container, m_stack.size());
+        m_stack.emplace_back(&container);
+    }
 
-        case INT:
-            std::getline(stream, buffer, '\n');
-            if (buffer == "00")
-            {
-                stack.push(StackItem(code, false));
-            }
-            else if (buffer == "01")
-            {
-                stack.push(StackItem(code, true));
-            }
-            else
-            {
-                stack.push(StackItem(code, Util::StringToInt(buffer)));
-            }
-            break;
+    void PushMark()
+    {
+        m_marks.push_back(m_stack.size());
+    }
 
-        case FLOAT:
-            std::getline(stream, buffer, '\n');
-            stack.push(StackItem(code, std::strtod(buffer.c_str(), nullptr)));
-            break;
+    void Pop()
+    {
+        if (!m_marks.empty() && m_marks.back() == m_stack.size())
+        {
+            m_marks.pop_back();
+        }
+        else
+        {
+            PopItem();
+        }
+    }
 
-        case LONG:
-            std::getline(stream, buffer, '\n');
-            if (!buffer.empty() && buffer.back() == 'L')
-            {
-                buffer.resize(buffer.size() - 1);
-            }
-            stack.push(StackItem(code, Util::StringToInt(buffer)));
-            break;
+    void PopMark()
+    {
+        m_stack.resize(TakeMark());
+    }
 
-        case STRING:
-            std::getline(stream, buffer, '\n');
-            stack.push(StackItem(code, UnicodeToUtf8(buffer.substr(1, buffer.size() - 2))));
-            break;
+    void Dup()
+    {
+        StackItem item = Top();
+        m_stack.push_back(std::move(item));
+    }
 
-        case UNICODE_:
-            std::getline(stream, buffer, '\n');
-            stack.push(StackItem(code, UnicodeToUtf8(buffer)));
-            break;
+    void BuildDict()
+    {
+        std::size_t const mark = TakeMark();
+        PickleObject& dict = m_objects.emplace_back(true);
+        SetItemsFrom(dict, mark);
+        m_stack.emplace_back(&dict);
+    }
 
-        case INST:
-            std::getline(stream, buffer, '\n');
-            std::getline(stream, buffer, '\n');
-            [[fallthrough]];
+    void BuildList()
+    {
+        std::size_t const mark = TakeMark();
+        PickleObject& list = m_objects.emplace_back(false);
+        CheckListCapture(list, mark);
+        AppendFrom(list, mark);
+        m_stack.emplace_back(&list);
+    }
 
-        case DICT:
-            currentItem = StackItem(code, ojson::object());
-            while (stack.top().Type != MARK)
-            {
-                currentItem2 = stack.top();
-                stack.pop();
-                currentItem.Value.insert_or_assign(stack.top().Value.as<std::string>(), currentItem2.Value);
-                stack.pop();
-            }
-            stack.top() = currentItem;
-            break;
+    void BuildTuple(std::size_t size)
+    {
+        if (GetAvailableSize() < size)
+        {
+            throw Exception("Pickle stack underflow");
+        }
 
-        case LIST:
-        case TUPLE:
-            currentItem = StackItem(code, ojson::array());
-            while (stack.top().Type != MARK)
-            {
-                currentItem.Value.push_back(stack.top().Value);
-                stack.pop();
-            }
-            stack.top() = currentItem;
-            break;
+        PickleObject& tuple = m_objects.emplace_back(false);
+        AppendFrom(tuple, m_stack.size() - size);
+        m_stack.emplace_back(&tuple);
+    }
 
-        case NONE:
-            stack.push(StackItem(code, ojson::null()));
-            break;
+    void Append()
+    {
+        StackItem item = PopItem();
+        AddItem(GetContainer(Top(), false), std::move(item));
+    }
 
-        case EMPTY_DICT:
-            stack.push(StackItem(code, ojson::object()));
-            break;
+    void Appends()
+    {
+        std::size_t const mark = TakeMark();
+        AppendFrom(GetContainer(GetItemBelow(mark), false), mark);
+    }
 
-        case EMPTY_LIST:
-            stack.push(StackItem(code, ojson::array()));
-            break;
+    void SetItem()
+    {
+        StackItem value = PopItem();
+        StackItem key = PopItem();
+        AddEntry(GetContainer(Top(), true), std::move(key), std::move(value));
+    }
 
-        case TUPLE3:
-            stack2.push(std::move(stack.top()));
-            stack.pop();
-            [[fallthrough]];
+    void SetItems()
+    {
+        std::size_t const mark = TakeMark();
+        SetItemsFrom(GetContainer(GetItemBelow(mark), true), mark);
+    }
 
-        case TUPLE2:
-            stack2.push(std::move(stack.top()));
-            stack.pop();
-            [[fallthrough]];
+    void Build()
+    {
+        StackItem state = PopItem();
+        Top() = std::move(state);
+    }
 
-        case TUPLE1:
-            stack2.push(std::move(stack.top()));
-            stack.pop();
-            [[fallthrough]];
+    // Objects end up as dictionaries of their state (see BUILD), so class and constructor arguments are dropped
+    void NewObj(std::size_t argumentCount)
+    {
+        for (std::size_t i = 0; i <= argumentCount; ++i)
+        {
+            PopItem();
+        }
 
-        case EMPTY_TUPLE:
-            stack.push(StackItem(code, ojson::array()));
-            while (!stack2.empty())
-            {
-                stack.top().Value.push_back(std::move(stack2.top().Value));
-                stack2.pop();
-            }
-            break;
+        PushContainer(true);
+    }
 
-        case APPEND:
-            currentItem = stack.top();
-            stack.pop();
-            stack.top().Value.push_back(currentItem.Value);
-            break;
+    ojson PopValue()
+    {
+        StackItem item = PopItem();
+        if (item.Object != nullptr)
+        {
+            throw Exception("Pickle scalar expected on stack");
+        }
 
-        case BUILD:
-            currentItem = stack.top();
-            stack.pop();
-            stack.top() = currentItem;
-            break;
+        return std::move(item.Value);
+    }
 
-        case GET:
-            std::getline(stream, buffer, '\n');
-            stack.push(memo.at(Util::StringToInt(buffer)));
-            break;
+    void Put(std::size_t index)
+    {
+        if (index >= m_memo.size())
+        {
+            m_memo.resize(index + 1);
+        }
 
-        case PUT:
-            std::getline(stream, buffer, '\n');
-            memo[Util::StringToInt(buffer)] = stack.top();
-            break;
+        StackItem const& item = Top();
+        if (item.Object != nullptr)
+        {
+            item.Object->IsMemoized = true;
+        }
 
-        case SETITEM:
-            currentItem = stack.top();
-            stack.pop();
-            currentItem2 = stack.top();
-            stack.pop();
-            stack.top().Value.insert_or_assign(currentItem2.Value.as<std::string>(), currentItem.Value);
-            break;
+        m_memo[index] = item;
+    }
 
-        case PROTO:
-            proto = static_cast<unsigned int>(stream.get());
-            break;
+    void Memoize()
+    {
+        Put(m_memo.size());
+    }
 
-        case GLOBAL:
-            std::getline(stream, buffer, '\n');
-            std::getline(stream, buffer2, '\n');
-            stack.push(StackItem(code, buffer + ':' + buffer2));
-            break;
+    void Get(std::size_t index)
+    {
+        if (index >= m_memo.size() || !m_memo[index].has_value())
+        {
+            throw Exception(fmt::format("Pickle memo has no entry {}", index));
+        }
 
-        case BINPUT:
-            memo[GetBinNumber<std::uint8_t>(stream)] = stack.top();
-            break;
+        // Memoized objects are never moved out, so this only happens if object has been memoized after that
+        StackItem const& item = *m_memo[index];
+        if (item.Object != nullptr && item.Object->IsDetached)
+        {
+            throw Exception(fmt::format("Pickle memo entry {} has already been handed out", index));
+        }
 
-        case NEWOBJ:
-            currentItem = stack.top();
-            stack.pop();
-            currentItem2 = stack.top();
-            stack.pop();
-            stack.push(StackItem(code, ojson::object()));
-            break;
+        m_stack.push_back(item);
+    }
 
-        case BINUNICODE:
-            stack.push(StackItem(code, GetBinUnicode<std::uint32_t>(stream)));
-            break;
+    ojson Stop()
+    {
+        StackItem root = PopItem();
+        m_memo.clear();
 
-        case NEWTRUE:
-            stack.push(StackItem(code, true));
-            break;
+        if (root.Object != nullptr)
+        {
+            ++root.Object->RefCount;
+        }
 
-        case NEWFALSE:
-            stack.push(StackItem(code, false));
-            break;
+        return Materialize(root, true, 0);
+    }
 
-        case BINFLOAT:
-            stack.push(StackItem(code, GetBinNumber<double>(stream, std::endian::big)));
-            break;
+private:
+    std::size_t GetAvailableSize() const
+    {
+        return m_stack.size() - (m_marks.empty() ? 0 : m_marks.back());
+    }
 
-        case BININT1:
-            stack.push(StackItem(code, GetBinNumber<std::int8_t>(stream)));
-            break;
+    StackItem& Top()
+    {
+        if (GetAvailableSize() == 0)
+        {
+            throw Exception("Pickle stack underflow");
+        }
 
-        case APPENDS:
-            while (!stack.empty() && stack.top().Type != MARK)
-            {
-                stack2.push(std::move(stack.top()));
-                stack.pop();
-            }
-            stack.pop();
-            while (!stack2.empty())
-            {
-                stack.top().Value.push_back(std::move(stack2.top().Value));
-                stack2.pop();
-            }
-            break;
+        return m_stack.back();
+    }
 
-        case BININT:
-            stack.push(StackItem(code, GetBinNumber<std::int32_t>(stream)));
-            break;
+    StackItem PopItem()
+    {
+        StackItem result = std::move(Top());
+        m_stack.pop_back();
+        return result;
+    }
 
-        case BINGET:
-            stack.push(memo[GetBinNumber<std::uint8_t>(stream)]);
-            break;
+    std::size_t TakeMark()
+    {
+        if (m_marks.empty())
+        {
+            throw Exception("Pickle mark not found");
+        }
 
-        case SETITEMS:
-            while (!stack.empty() && stack.top().Type != MARK)
-            {
-                stack2.push(std::move(stack.top()));
-                stack.pop();
-            }
-            stack.pop();
-            while (!stack2.empty())
-            {
-                currentItem = std::move(stack2.top());
-                stack2.pop();
-                currentItem2 = std::move(stack2.top());
-                stack2.pop();
-                stack.top().Value.insert_or_assign(currentItem.Value.as<std::string>(), std::move(currentItem2.Value));
-            }
-            break;
+        std::size_t const result = m_marks.back();
+        m_marks.pop_back();
+        return result;
+    }
 
-        case LONG_BINPUT:
-            memo[GetBinNumber<std::uint32_t>(stream)] = stack.top();
-            break;
+    StackItem& GetItemBelow(std::size_t mark)
+    {
+        if (mark == 0 || (!m_marks.empty() && m_marks.back() == mark))
+        {
+            throw Exception("Pickle stack underflow");
+        }
 
-        case LONG_BINGET:
-            stack.push(memo[GetBinNumber<std::uint32_t>(stream)]);
-            break;
+        return m_stack[mark - 1];
+    }
 
-        default:
-            throw Exception(fmt::format("Pickle opcode {} not yet supported", code));
+    void AppendFrom(PickleObject& list, std::size_t begin)
+    {
+        list.Items.reserve(list.Items.size() + m_stack.size() - begin);
+        for (std::size_t i = begin; i < m_stack.size(); ++i)
+        {
+            AddItem(list, std::move(m_stack[i]));
+        }
+
+        m_stack.resize(begin);
+    }
+
+    void SetItemsFrom(PickleObject& dict, std::size_t begin)
+    {
+        if ((m_stack.size() - begin) % 2 != 0)
+        {
+            throw Exception("Odd number of pickled dictionary keys and values");
+        }
+
+        dict.Entries.reserve(dict.Entries.size() + (m_stack.size() - begin) / 2);
+        for (std::size_t i = begin; i < m_stack.size(); i += 2)
+        {
+            AddEntry(dict, std::move(m_stack[i]), std::move(m_stack[i + 1]));
         }
+
+        m_stack.resize(begin);
     }
 
-    if (!stack.empty())
+    static PickleObject& GetContainer(StackItem& item, bool isDict)
     {
-        throw Exception("Pickle stack is not empty at the end");
+        if (item.Object == nullptr || item.Object->IsDict != isDict)
+        {
+            throw Exception(fmt::format("Pickle {} expected on stack", isDict ? "dictionary" : "list"));
+        }
+
+        return *item.Object;
     }
+
+    // List about to be placed at given stack position is captured if it's a value for the capture key, and the
+    // dictionary it goes into is either the root or the state of root object (sitting right above it)
+    void CheckListCapture(PickleObject& list, std::size_t position)
+    {
+        if (m_captureKey.empty() || m_captureList != nullptr || list.IsDict || position < 2)
+        {
+            return;
+        }
+
+        std::size_t const keyPosition = position - 1;
+        std::size_t dictPosition = keyPosition - 1;
+        if (!m_marks.empty() && m_marks.back() >= position)
+        {
+            return;
+        }
+
+        if (!m_marks.empty() && m_marks.back() <= keyPosition)
+        {
+            // Key and value are part of SETITEMS batch, preceded by other keys and values
+            std::size_t const mark = m_marks.back();
+            if (mark == 0 || (keyPosition - mark) % 2 != 0)
+            {
+                return;
+            }
+
+            dictPosition = mark - 1;
+        }
+
+        StackItem const& dict = m_stack[dictPosition];
+        StackItem const& key = m_stack[keyPosition];
+        if (dictPosition <= 1 && dict.Object != nullptr && dict.Object->IsDict && key.Object == nullptr &&
+            key.Value.is<std::string>() && key.Value.as_string_view() == m_captureKey)
+        {
+            m_captureList = &list;
+        }
+    }
+
+    void AddItem(PickleObject& list, StackItem&& item)
+    {
+        if (item.Object != nullptr)
+        {
+            ++item.Object->RefCount;
+        }
+
+        if (&list == m_captureList)
+        {
+            m_capturedItems.push_back(Materialize(item, true, 1));
+            return;
+        }
+
+        list.Items.push_back(std::move(item));
+    }
+
+    static void AddEntry(PickleObject& dict, StackItem&& key, StackItem&& value)
+    {
+        std::string name = key.Object == nullptr ? key.Value.as<std::string>() :
+            Materialize(key, false, 0).as<std::string>();
+
+        if (value.Object != nullptr)
+        {
+            ++value.Object->RefCount;
+        }
+
+        dict.Entries.emplace_back(std::move(name), std::move(value));
+    }
+
+    // Object is copied for all but the last of its references, which takes its contents instead
+    static ojson Materialize(StackItem& item, bool canMove, std::size_t depth)
+    {
+        if (item.Object == nullptr)
+        {
+            if (canMove)
+            {
+                return std::move(item.Value);
+            }
+
+            return item.Value;
+        }
+
+        if (depth >= Detail::MaxDepth)
+        {
+            throw Exception(fmt::format("Pickled data is nested deeper than {} levels", Detail::MaxDepth));
+        }
+
+        PickleObject& object = *item.Object;
+        bool const moveChildren = canMove && --object.RefCount == 0 && !object.IsMemoized;
+
+        ojson result;
+        if (object.IsDict)
+        {
+            result = ojson::object();
+            result.reserve(object.Entries.size());
+            for (auto& [key, value] : object.Entries)
+            {
+                result.insert_or_assign(key, Materialize(value, moveChildren, depth + 1));
+            }
+        }
+        else
+        {
+            result = ojson::array();
+            result.reserve(object.Items.size());
+            for (StackItem& value : object.Items)
+            {
+                result.push_back(Materialize(value, moveChildren, depth + 1));
+            }
+        }
+
+        if (moveChildren)
+        {
+            object.IsDetached = true;
+            object.Items = {};
+            object.Entries = {};
+        }
+
+        return result;
+    }
+
+private:
+    std::vector<StackItem> m_stack;
+    std::vector<std::size_t> m_marks;
+    std::vector<std::optional<StackItem>> m_memo;
+    std::deque<PickleObject> m_objects;
+    std::string m_captureKey;
+    PickleObject* m_captureList;
+    std::deque<ojson> m_capturedItems;
+};
+
+class PickleDecoder
+{
+public:
+    explicit PickleDecoder(std::span<char const> data) :
+        m_position(data.data()),
+        m_end(data.data() + data.size()),
+        m_machine(),
+        m_result(),
+        m_isStopped(false)
+    {
+        //
+    }
+
+    ojson Decode()
+    {
+        while (!m_isStopped)
+        {
+            Step();
+        }
+
+        return std::move(m_result);
+    }
+
+    void CaptureList(std::string_view key)
+    {
+        m_machine.CaptureList(key);
+    }
+
+    // Decodes only as far as needed to get the next element of captured list
+    bool DecodeNextListItem(ojson& item)
+    {
+        while (!m_machine.HasCapturedItems() && !m_isStopped)
+        {
+            Step();
+        }
+
+        if (!m_machine.HasCapturedItems())
+        {
+            if (!m_machine.IsListCaptured())
+            {
+                throw Exception(fmt::format("Pickled list \"{}\" not found", m_machine.GetCaptureKey()));
+            }
+
+            return false;
+        }
+
+        item = m_machine.TakeCapturedItem();
+        return true;
+    }
+
+private:
+    using OpcodeHandler = void (PickleDecoder::*)(std::uint8_t code);
+
+    // Defined as constexpr below, once the class is complete and MakeOpcodeHandlers() can be evaluated at compile time
+    static std::array<OpcodeHandler, 256> const OpcodeHandlers;
+
+    static constexpr std::array<OpcodeHandler, 256> MakeOpcodeHandlers()
+    {
+        std::array<OpcodeHandler, 256> result{};
+        result.fill(&PickleDecoder::OnUnsupported);
+
+        result[PickleOpcode::MARK] = &PickleDecoder::OnMark;
+        result[PickleOpcode::STOP] = &PickleDecoder::OnStop;
+        result[PickleOpcode::POP] = &PickleDecoder::OnPop;
+        result[PickleOpcode::POP_MARK] = &PickleDecoder::OnPopMark;
+        result[PickleOpcode::DUP] = &PickleDecoder::OnDup;
+        result[PickleOpcode::FLOAT] = &PickleDecoder::OnFloat;
+        result[PickleOpcode::INT] = &PickleDecoder::OnInt;
+        result[PickleOpcode::BININT] = &PickleDecoder::OnBinInt<std::int32_t>;
+        result[PickleOpcode::BININT1] = &PickleDecoder::OnBinInt<std::uint8_t>;
+        result[PickleOpcode::LONG] = &PickleDecoder::OnLong;
+        result[PickleOpcode::BININT2] = &PickleDecoder::OnBinInt<std::uint16_t>;
+        result[PickleOpcode::NONE] = &PickleDecoder::OnNone;
+        result[PickleOpcode::STRING] = &PickleDecoder::OnString;
+        result[PickleOpcode::BINSTRING] = &PickleDecoder::OnBinString<std::uint32_t>;
+        result[PickleOpcode::SHORT_BINSTRING] = &PickleDecoder::OnBinString<std::uint8_t>;
+        result[PickleOpcode::UNICODE_] = &PickleDecoder::OnUnicode;
+        result[PickleOpcode::BINUNICODE] = &PickleDecoder::OnBinString<std::uint32_t>;
+        result[PickleOpcode::APPEND] = &PickleDecoder::OnAppend;
+        result[PickleOpcode::BUILD] = &PickleDecoder::OnBuild;
+        result[PickleOpcode::GLOBAL] = &PickleDecoder::OnGlobal;
+        result[PickleOpcode::DICT] = &PickleDecoder::OnDict;
+        result[PickleOpcode::EMPTY_DICT] = &PickleDecoder::OnEmptyDict;
+        result[PickleOpcode::APPENDS] = &PickleDecoder::OnAppends;
+        result[PickleOpcode::GET] = &PickleDecoder::OnGet;
+        result[PickleOpcode::BINGET] = &PickleDecoder::OnBinGet<std::uint8_t>;
+        result[PickleOpcode::INST] = &PickleDecoder::OnInst;
+        result[PickleOpcode::LONG_BINGET] = &PickleDecoder::OnBinGet<std::uint32_t>;
+        result[PickleOpcode::LIST] = &PickleDecoder::OnList;
+        result[PickleOpcode::EMPTY_LIST] = &PickleDecoder::OnEmptyList;
+        result[PickleOpcode::PUT] = &PickleDecoder::OnPut;
+        result[PickleOpcode::BINPUT] = &PickleDecoder::OnBinPut<std::uint8_t>;
+        result[PickleOpcode::LONG_BINPUT] = &PickleDecoder::OnBinPut<std::uint32_t>;
+        result[PickleOpcode::SETITEM] = &PickleDecoder::OnSetItem;
+        result[PickleOpcode::TUPLE] = &PickleDecoder::OnList;
+        result[PickleOpcode::EMPTY_TUPLE] = &PickleDecoder::OnTuple;
+        result[PickleOpcode::SETITEMS] = &PickleDecoder::OnSetItems;
+        result[PickleOpcode::BINFLOAT] = &PickleDecoder::OnBinFloat;
+
+        result[PickleOpcode::PROTO] = &PickleDecoder::OnProto;
+        result[PickleOpcode::NEWOBJ] = &PickleDecoder::OnNewObj;
+        result[PickleOpcode::TUPLE1] = &PickleDecoder::OnTuple;
+        result[PickleOpcode::TUPLE2] = &PickleDecoder::OnTuple;
+        result[PickleOpcode::TUPLE3] = &PickleDecoder::OnTuple;
+        result[PickleOpcode::NEWTRUE] = &PickleDecoder::OnBool;
+        result[PickleOpcode::NEWFALSE] = &PickleDecoder::OnBool;
+        result[PickleOpcode::LONG1] = &PickleDecoder::OnBinLong<std::uint8_t>;
+        result[PickleOpcode::LONG4] = &PickleDecoder::OnBinLong<std::uint32_t>;
+
+        result[PickleOpcode::BINBYTES] = &PickleDecoder::OnBinString<std::uint32_t>;
+        result[PickleOpcode::SHORT_BINBYTES] = &PickleDecoder::OnBinString<std::uint8_t>;
+
+        result[PickleOpcode::SHORT_BINUNICODE] = &PickleDecoder::OnBinString<std::uint8_t>;
+        result[PickleOpcode::BINUNICODE8] = &PickleDecoder::OnBinString<std::uint64_t>;
+        result[PickleOpcode::BINBYTES8] = &PickleDecoder::OnBinString<std::uint64_t>;
+        result[PickleOpcode::EMPTY_SET] = &PickleDecoder::OnEmptyList;
+        result[PickleOpcode::ADDITEMS] = &PickleDecoder::OnAppends;
+        result[PickleOpcode::FROZENSET] = &PickleDecoder::OnList;
+        result[PickleOpcode::NEWOBJ_EX] = &PickleDecoder::OnNewObj;
+        result[PickleOpcode::STACK_GLOBAL] = &PickleDecoder::OnStackGlobal;
+        result[PickleOpcode::MEMOIZE] = &PickleDecoder::OnMemoize;
+        result[PickleOpcode::FRAME] = &PickleDecoder::OnFrame;
+
+        return result;
+    }
+
+    std::string_view ReadBytes(std::size_t size)
+    {
+        if (size > static_cast<std::size_t>(m_end - m_position))
+        {
+            throw Exception("Unexpected end of pickled data");
+        }
+
+        std::string_view const result(m_position, size);
+        m_position += size;
+        return result;
+    }
+
+    std::uint8_t ReadByte()
+    {
+        return static_cast<std::uint8_t>(ReadBytes(1).front());
+    }
+
+    template<typename T>
+    T ReadNumber(std::endian order = std::endian::little)
+    {
+        static_assert(std::is_integral_v<T> || std::is_floating_point_v<T>);
+
+        std::string_view const data = ReadBytes(sizeof(T));
+
+        std::array<char, sizeof(T)> result;
+        std::copy(data.begin(), data.end(), result.begin());
+
+        if (order != std::endian::native)
+        {
+            std::reverse(result.begin(), result.end());
+        }
+
+        return std::bit_cast<T>(result);
+    }
+
+    std::string_view ReadLine()
+    {
+        void const* const end = std::memchr(m_position, '\n', static_cast<std::size_t>(m_end - m_position));
+        if (end == nullptr)
+        {
+            throw Exception("Unexpected end of pickled data");
+        }
+
+        std::string_view const result(m_position, static_cast<char const*>(end) - m_position);
+        m_position += result.size() + 1;
+        return result;
+    }
+
+    void Step()
+    {
+        std::uint8_t const code = ReadByte();
+        (this->*OpcodeHandlers[code])(code);
+    }
+
+    void OnUnsupported(std::uint8_t code)
+    {
+        throw Exception(fmt::format("Pickle opcode {} not yet supported", code));
+    }
+
+    void OnMark(std::uint8_t /*code*/)
+    {
+        m_machine.PushMark();
+    }
+
+    void OnStop(std::uint8_t /*code*/)
+    {
+        m_result = m_machine.Stop();
+        m_isStopped = true;
+
+        if (!m_machine.IsEmpty())
+        {
+            throw Exception("Pickle stack is not empty at the end");
+        }
+    }
+
+    void OnPop(std::uint8_t /*code*/)
+    {
+        m_machine.Pop();
+    }
+
+    void OnPopMark(std::uint8_t /*code*/)
+    {
+        m_machine.PopMark();
+    }
+
+    void OnDup(std::uint8_t /*code*/)
+    {
+        m_machine.Dup();
+    }
+
+    void OnInt(std::uint8_t /*code*/)
+    {
+        std::string_view const text = ReadLine();
+        if (text == "00")
+        {
+            m_machine.Push(false);
+        }
+        else if (text == "01")
+        {
+            m_machine.Push(true);
+        }
+        else
+        {
+            m_machine.Push(ParseNumber<long long>(text));
+        }
+    }
+
+    void OnLong(std::uint8_t /*code*/)
+    {
+        std::string_view text = ReadLine();
+        if (text.ends_with('L'))
+        {
+            text.remove_suffix(1);
+        }
+
+        m_machine.Push(ParseNumber<long long>(text));
+    }
+
+    void OnFloat(std::uint8_t /*code*/)
+    {
+        m_machine.Push(ParseNumber<double>(ReadLine()));
+    }
+
+    void OnString(std::uint8_t /*code*/)
+    {
+        std::string_view const text = ReadLine();
+        if (text.size() < 2)
+        {
+            throw Exception("Invalid pickled string");
+        }
+
+        m_machine.Push(UnicodeToUtf8(text.substr(1, text.size() - 2)));
+    }
+
+    void OnUnicode(std::uint8_t /*code*/)
+    {
+        m_machine.Push(UnicodeToUtf8(ReadLine()));
+    }
+
+    template<typename LengthT>
+    void OnBinString(std::uint8_t /*code*/)
+    {
+        std::size_t const length = ReadNumber<LengthT>();
+        m_machine.Push(std::string(ReadBytes(length)));
+    }
+
+    template<typename T>
+    void OnBinInt(std::uint8_t /*code*/)
+    {
+        m_machine.Push(static_cast<std::int64_t>(ReadNumber<T>()));
+    }
+
+    // Two's complement little-endian integer of given length; values not fitting into 64 bits (signed or unsigned) are
+    // not supported
+    template<typename LengthT>
+    void OnBinLong(std::uint8_t /*code*/)
+    {
+        std::size_t const length = ReadNumber<LengthT>();
+        std::string_view data = ReadBytes(length);
+
+        bool const isUnsigned = length == sizeof(std::uint64_t) + 1 && data.back() == 0;
+        if (isUnsigned)
+        {
+            data.remove_suffix(1);
+        }
+        else if (length > sizeof(std::uint64_t))
+        {
+            throw Exception(fmt::format("Pickled integer of {} bytes is too large", length));
+        }
+
+        std::uint64_t value = 0;
+        for (auto it = data.rbegin(); it != data.rend(); ++it)
+        {
+            value = (value << 8) | static_cast<std::uint8_t>(*it);
+        }
+
+        if (isUnsigned)
+        {
+            m_machine.Push(value);
+            return;
+        }
+
+        if (length > 0 && length < sizeof(std::uint64_t) && (static_cast<std::uint8_t>(data.back()) & 0x80) != 0)
+        {
+            value |= ~std::uint64_t{0} << (length * 8);
+        }
+
+        m_machine.Push(static_cast<std::int64_t>(value));
+    }
+
+    void OnBinFloat(std::uint8_t /*code*/)
+    {
+        m_machine.Push(ReadNumber<double>(std::endian::big));
+    }
+
+    void OnBool(std::uint8_t code)
+    {
+        m_machine.Push(code == PickleOpcode::NEWTRUE);
+    }
+
+    void OnNone(std::uint8_t /*code*/)
+    {
+        m_machine.Push(ojson::null());
+    }
+
+    void OnInst(std::uint8_t /*code*/)
+    {
+        ReadLine(); // module
+        ReadLine(); // class
+        m_machine.BuildDict();
+    }
+
+    void OnDict(std::uint8_t /*code*/)
+    {
+        m_machine.BuildDict();
+    }
+
+    void OnList(std::uint8_t /*code*/)
+    {
+        m_machine.BuildList();
+    }
+
+    void OnTuple(std::uint8_t code)
+    {
+        m_machine.BuildTuple(code == PickleOpcode::EMPTY_TUPLE ? 0 : code - PickleOpcode::TUPLE1 + 1);
+    }
+
+    void OnEmptyDict(std::uint8_t /*code*/)
+    {
+        m_machine.PushContainer(true);
+    }
+
+    void OnEmptyList(std::uint8_t /*code*/)
+    {
+        m_machine.PushContainer(false);
+    }
+
+    void OnAppend(std::uint8_t /*code*/)
+    {
+        m_machine.Append();
+    }
+
+    void OnAppends(std::uint8_t /*code*/)
+    {
+        m_machine.Appends();
+    }
+
+    void OnSetItem(std::uint8_t /*code*/)
+    {
+        m_machine.SetItem();
+    }
+
+    void OnSetItems(std::uint8_t /*code*/)
+    {
+        m_machine.SetItems();
+    }
+
+    void OnBuild(std::uint8_t /*code*/)
+    {
+        m_machine.Build();
+    }
+
+    void OnNewObj(std::uint8_t code)
+    {
+        m_machine.NewObj(code == PickleOpcode::NEWOBJ_EX ? 2 : 1);
+    }
+
+    void OnGlobal(std::uint8_t /*code*/)
+    {
+        std::string_view const module = ReadLine();
+        std::string_view const name = ReadLine();
+        m_machine.Push(fmt::format("{}:{}", module, name));
+    }
+
+    void OnStackGlobal(std::uint8_t /*code*/)
+    {
+        ojson const name = m_machine.PopValue();
+        ojson const module = m_machine.PopValue();
+        m_machine.Push(fmt::format("{}:{}", module.as<std::string>(), name.as<std::string>()));
+    }
+
+    void OnGet(std::uint8_t /*code*/)
+    {
+        m_machine.Get(ParseNumber<std::size_t>(ReadLine()));
+    }
+
+    template<typename IndexT>
+    void OnBinGet(std::uint8_t /*code*/)
+    {
+        m_machine.Get(ReadNumber<IndexT>());
+    }
+
+    void OnPut(std::uint8_t /*code*/)
+    {
+        m_machine.Put(ParseNumber<std::size_t>(ReadLine()));
+    }
+
+    template<typename IndexT>
+    void OnBinPut(std::uint8_t /*code*/)
+    {
+        m_machine.Put(ReadNumber<IndexT>());
+    }
+
+    void OnMemoize(std::uint8_t /*code*/)
+    {
+        m_machine.Memoize();
+    }
+
+    void OnProto(std::uint8_t /*code*/)
+    {
+        // Opcodes are handled the same way regardless of declared protocol version
+        ReadByte();
+    }
+
+    // With whole pickle already in memory, frames only need to be checked against the data size
+    void OnFrame(std::uint8_t /*code*/)
+    {
+        std::uint64_t const frameSize = ReadNumber<std::uint64_t>();
+        if (frameSize > static_cast<std::uint64_t>(m_end - m_position))
+        {
+            throw Exception("Pickle frame exceeds the data size");
+        }
+    }
+
+private:
+    char const* m_position;
+    char const* const m_end;
+    PickleMachine m_machine;
+    ojson m_result;
+    bool m_isStopped;
+};
+
+constexpr std::array<PickleDecoder::OpcodeHandler, 256> PickleDecoder::OpcodeHandlers =
+    PickleDecoder::MakeOpcodeHandlers();
+
+class PickleListIterator : public IForwardIterator<ojson>
+{
+public:
+    PickleListIterator(std::span<char const> data, std::string_view listKey) :
+        m_decoder(data)
+    {
+        m_decoder.CaptureList(listKey);
+    }
+
+public:
+    // IForwardIterator
+    bool GetNext(ojson& item) override
+    {
+        return m_decoder.DecodeNextListItem(item);
+    }
+
+private:
+    PickleDecoder m_decoder;
+};
+
+void EncodeOneValue(PickleWriter& writer, ojson const& value)
+{
+    if (value.is_object())
+    {
+        writer.BeginDict();
+        for (auto const& item : value.object_range())
+        {
+            writer.WriteString(item.key());
+            EncodeOneValue(writer, item.value());
+        }
+        writer.EndDict();
+    }
+    else if (value.is_array())
+    {
+        writer.BeginList();
+        for (auto const& item : value.array_range())
+        {
+            EncodeOneValue(writer, item);
+        }
+        writer.EndList();
+    }
+    else if (value.is_null())
+    {
+        writer.WriteNone();
+    }
+    else if (value.is_bool())
+    {
+        writer.WriteBool(value.as<bool>());
+    }
+    else if (value.is<std::string>())
+    {
+        writer.WriteString(value.as_string_view());
+    }
+    else if (value.is<std::int64_t>())
+    {
+        writer.WriteInteger(value.as<std::int64_t>());
+    }
+    else if (value.is<std::uint64_t>())
+    {
+        writer.WriteUnsigned(value.as<std::uint64_t>());
+    }
+    else if (value.is_double())
+    {
+        writer.WriteDouble(value.as<double>());
+    }
+    else
+    {
+        throw Exception(fmt::format("Unable to encode value: {}", fmt::streamed(value)));
+    }
+}
+
+} // namespace
+
+PickleCodec::PickleCodec(int protocol) :
+    m_protocol(protocol)
+{
+    //
+}
+
+PickleCodec::~PickleCodec() = default;
+
+void PickleCodec::Decode(std::span<char const> data, ojson& root) const
+{
+    root = PickleDecoder(data).Decode();
+}
+
+void PickleCodec::Decode(std::istream& stream, ojson& root) const
+{
+    std::string const data = Util::ReadStream(stream);
+    Decode(data, root);
+}
+
+std::unique_ptr<IForwardIterator<ojson>> PickleCodec::DecodeList(std::span<char const> data,
+    std::string_view listKey) const
+{
+    return std::make_unique<PickleListIterator>(data, listKey);
 }
 
-void PickleCodec::Encode(std::ostream& /*stream*/, ojson const& /*root*/) const
+void PickleCodec::Encode(std::ostream& stream, ojson const& root) const
 {
-    throw NotImplementedException(__func__);
+    PickleWriter writer(stream, m_protocol);
+    EncodeOneValue(writer, root);
+    writer.Finish();
 }
@@ -18,14 +18,36 @@
 
 #include "IStructuredDataCodec.h"
 
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+template<typename... ArgsT>
+class IForwardIterator;
+
 class PickleCodec : public IStructuredDataCodec
 {
 public:
-    PickleCodec();
+    // Highest protocol understood by both Python 2 and 3, same as Deluge writes its own state with
+    static int const DefaultProtocol = 2;
+
+public:
+    explicit PickleCodec(int protocol = DefaultProtocol);
     ~PickleCodec() override;
 
+    // Decodes directly from memory, without going through the stream machinery
+    void Decode(std::span<char const> data, ojson& root) const;
+    // Decodes incrementally, handing out elements of the list stored under `listKey` in top-level dictionary (or
+    // top-level object state) one at a time as soon as they are appended to it; data must outlive the iterator
+    std::unique_ptr<IForwardIterator<ojson>> DecodeList(std::span<char const> data, std::string_view listKey) const;
+
 public:
     // IStructuredDataCodec
     void Decode(std::istream& stream, ojson& root) const override;
+    // Output is streamed as it is produced, with objects written as dictionaries
     void Encode(std::ostream& stream, ojson const& root) const override;
+
+private:
+    int const m_protocol;
 };
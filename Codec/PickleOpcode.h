@@ -0,0 +1,103 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// Taken from Python sources
+struct PickleOpcode
+{
+    enum Enum
+    {
+        MARK            = '(',
+        STOP            = '.',
+        POP             = '0',
+        POP_MARK        = '1',
+        DUP             = '2',
+        FLOAT           = 'F',
+        INT             = 'I',
+        BININT          = 'J',
+        BININT1         = 'K',
+        LONG            = 'L',
+        BININT2         = 'M',
+        NONE            = 'N',
+        PERSID          = 'P',
+        BINPERSID       = 'Q',
+        REDUCE          = 'R',
+        STRING          = 'S',
+        BINSTRING       = 'T',
+        SHORT_BINSTRING = 'U',
+        UNICODE_        = 'V',
+        BINUNICODE      = 'X',
+        APPEND          = 'a',
+        BUILD           = 'b',
+        GLOBAL          = 'c',
+        DICT            = 'd',
+        EMPTY_DICT      = '}',
+        APPENDS         = 'e',
+        GET             = 'g',
+        BINGET          = 'h',
+        INST            = 'i',
+        LONG_BINGET     = 'j',
+        LIST            = 'l',
+        EMPTY_LIST      = ']',
+        OBJ             = 'o',
+        PUT             = 'p',
+        BINPUT          = 'q',
+        LONG_BINPUT     = 'r',
+        SETITEM         = 's',
+        TUPLE           = 't',
+        EMPTY_TUPLE     = ')',
+        SETITEMS        = 'u',
+        BINFLOAT        = 'G',
+
+        /* Protocol 2. */
+        PROTO       = 0x80,
+        NEWOBJ      = 0x81,
+        EXT1        = 0x82,
+        EXT2        = 0x83,
+        EXT4        = 0x84,
+        TUPLE1      = 0x85,
+        TUPLE2      = 0x86,
+        TUPLE3      = 0x87,
+        NEWTRUE     = 0x88,
+        NEWFALSE    = 0x89,
+        LONG1       = 0x8a,
+        LONG4       = 0x8b,
+
+        /* Protocol 3 (Python 3.x) */
+        BINBYTES       = 'B',
+        SHORT_BINBYTES = 'C',
+
+        /* Protocol 4 */
+        SHORT_BINUNICODE = 0x8c,
+        BINUNICODE8      = 0x8d,
+        BINBYTES8        = 0x8e,
+        EMPTY_SET        = 0x8f,
+        ADDITEMS         = 0x90,
+        FROZENSET        = 0x91,
+        NEWOBJ_EX        = 0x92,
+        STACK_GLOBAL     = 0x93,
+        MEMOIZE          = 0x94,
+        FRAME            = 0x95,
+
+        /* Protocol 5 */
+        BYTEARRAY8       = 0x96,
+        NEXT_BUFFER      = 0x97,
+        READONLY_BUFFER  = 0x98
+    };
+
+    //
+};
@@ -0,0 +1,434 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "PickleWriter.h"
+
+#include "PickleOpcode.h"
+
+#include "Common/Exception.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <ostream>
+
+namespace
+{
+namespace Detail
+{
+
+// Same as Python uses, to keep unpickler stack small
+std::size_t const BatchSize = 1000;
+// Protocol 4 frames are committed once they reach this size
+std::size_t const FrameSize = 64 * 1024;
+
+} // namespace Detail
+} // namespace
+
+PickleWriter::PickleWriter(std::ostream& stream, int protocol) :
+    m_stream(stream),
+    m_protocol(protocol),
+    m_buffer(),
+    m_containers(),
+    m_stringMemo(),
+    m_classMemo(),
+    m_memoSize(0),
+    m_hasRoot(false),
+    m_isFinished(false)
+{
+    if (m_protocol < 2 || m_protocol > 4)
+    {
+        throw Exception(fmt::format("Pickle protocol {} is not supported", m_protocol));
+    }
+
+    m_buffer.reserve(Detail::FrameSize + Detail::FrameSize / 2);
+
+    // Protocol opcode precedes the first frame
+    WriteOpcode(PickleOpcode::PROTO);
+    WriteNumber<std::uint8_t>(m_protocol);
+    m_stream.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+}
+
+PickleWriter::~PickleWriter() = default;
+
+void PickleWriter::BeginList()
+{
+    BeginValue();
+    WriteOpcode(PickleOpcode::EMPTY_LIST);
+    BeginContainer(ContainerType::List);
+}
+
+void PickleWriter::EndList()
+{
+    EndContainer(ContainerType::List);
+    EndValue();
+}
+
+void PickleWriter::BeginDict()
+{
+    BeginValue();
+    WriteOpcode(PickleOpcode::EMPTY_DICT);
+    BeginContainer(ContainerType::Dict);
+}
+
+void PickleWriter::EndDict()
+{
+    EndContainer(ContainerType::Dict);
+    EndValue();
+}
+
+void PickleWriter::BeginObject(std::string_view module, std::string_view name)
+{
+    BeginValue();
+    WriteClass(module, name);
+    WriteOpcode(PickleOpcode::EMPTY_TUPLE);
+    WriteOpcode(PickleOpcode::NEWOBJ);
+    WriteOpcode(PickleOpcode::EMPTY_DICT);
+    BeginContainer(ContainerType::Object);
+}
+
+void PickleWriter::EndObject()
+{
+    EndContainer(ContainerType::Object);
+    WriteOpcode(PickleOpcode::BUILD);
+    EndValue();
+}
+
+void PickleWriter::WriteNone()
+{
+    BeginValue();
+    WriteOpcode(PickleOpcode::NONE);
+    EndValue();
+}
+
+void PickleWriter::WriteBool(bool value)
+{
+    BeginValue();
+    WriteOpcode(value ? PickleOpcode::NEWTRUE : PickleOpcode::NEWFALSE);
+    EndValue();
+}
+
+void PickleWriter::WriteInteger(std::int64_t value)
+{
+    BeginValue();
+
+    if (value >= 0 && value <= std::numeric_limits<std::uint8_t>::max())
+    {
+        WriteOpcode(PickleOpcode::BININT1);
+        WriteNumber(static_cast<std::uint8_t>(value));
+    }
+    else if (value >= 0 && value <= std::numeric_limits<std::uint16_t>::max())
+    {
+        WriteOpcode(PickleOpcode::BININT2);
+        WriteNumber(static_cast<std::uint16_t>(value));
+    }
+    else if (value >= std::numeric_limits<std::int32_t>::min() && value <= std::numeric_limits<std::int32_t>::max())
+    {
+        WriteOpcode(PickleOpcode::BININT);
+        WriteNumber(static_cast<std::int32_t>(value));
+    }
+    else
+    {
+        // Shortest two's complement representation which still has the right sign
+        auto bytes = std::bit_cast<std::array<std::uint8_t, sizeof(value)>>(value);
+        if constexpr (std::endian::native == std::endian::big)
+        {
+            std::reverse(bytes.begin(), bytes.end());
+        }
+
+        std::size_t size = bytes.size();
+        while (size > 1 && ((bytes[size - 1] == 0x00 && (bytes[size - 2] & 0x80) == 0) ||
+            (bytes[size - 1] == 0xff && (bytes[size - 2] & 0x80) != 0)))
+        {
+            --size;
+        }
+
+        WriteOpcode(PickleOpcode::LONG1);
+        WriteNumber(static_cast<std::uint8_t>(size));
+        WriteBytes({reinterpret_cast<char const*>(bytes.data()), size});
+    }
+
+    EndValue();
+}
+
+void PickleWriter::WriteUnsigned(std::uint64_t value)
+{
+    if (value <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+    {
+        WriteInteger(static_cast<std::int64_t>(value));
+        return;
+    }
+
+    BeginValue();
+
+    // Extra zero byte keeps the value positive
+    WriteOpcode(PickleOpcode::LONG1);
+    WriteNumber<std::uint8_t>(sizeof(value) + 1);
+    WriteNumber(value);
+    WriteNumber<std::uint8_t>(0);
+
+    EndValue();
+}
+
+void PickleWriter::WriteDouble(double value)
+{
+    BeginValue();
+    WriteOpcode(PickleOpcode::BINFLOAT);
+    WriteNumber(value, std::endian::big);
+    EndValue();
+}
+
+void PickleWriter::WriteString(std::string_view value)
+{
+    BeginValue();
+    WriteStringValue(value);
+    EndValue();
+}
+
+void PickleWriter::Finish()
+{
+    if (!m_containers.empty())
+    {
+        throw Exception("Pickled container is not terminated");
+    }
+
+    if (!m_hasRoot || m_isFinished)
+    {
+        throw Exception("Pickle has to contain exactly one top-level value");
+    }
+
+    WriteOpcode(PickleOpcode::STOP);
+    Flush();
+
+    m_isFinished = true;
+}
+
+void PickleWriter::BeginValue()
+{
+    if (m_containers.empty())
+    {
+        if (m_hasRoot)
+        {
+            throw Exception("Pickle has to contain exactly one top-level value");
+        }
+    }
+    else if (m_containers.back().BatchSize == 0)
+    {
+        WriteOpcode(PickleOpcode::MARK);
+    }
+}
+
+void PickleWriter::EndValue()
+{
+    if (m_containers.empty())
+    {
+        m_hasRoot = true;
+    }
+    else
+    {
+        Container& container = m_containers.back();
+        std::size_t const batchLimit = container.Type == ContainerType::List ? Detail::BatchSize : Detail::BatchSize * 2;
+        if (++container.BatchSize == batchLimit)
+        {
+            WriteOpcode(container.Type == ContainerType::List ? PickleOpcode::APPENDS : PickleOpcode::SETITEMS);
+            container.BatchSize = 0;
+        }
+    }
+
+    if (m_buffer.size() >= Detail::FrameSize)
+    {
+        Flush();
+    }
+}
+
+void PickleWriter::BeginContainer(ContainerType type)
+{
+    m_containers.push_back({type, 0});
+}
+
+void PickleWriter::EndContainer(ContainerType type)
+{
+    if (m_containers.empty() || m_containers.back().Type != type)
+    {
+        throw Exception("Pickled container end does not match its beginning");
+    }
+
+    Container const container = m_containers.back();
+    m_containers.pop_back();
+
+    if (container.BatchSize == 0)
+    {
+        return;
+    }
+
+    if (type == ContainerType::List)
+    {
+        WriteOpcode(PickleOpcode::APPENDS);
+    }
+    else if (container.BatchSize % 2 == 0)
+    {
+        WriteOpcode(PickleOpcode::SETITEMS);
+    }
+    else
+    {
+        throw Exception("Pickled dictionary key has no value");
+    }
+}
+
+void PickleWriter::WriteStringValue(std::string_view value)
+{
+    if (WriteMemoGet(m_stringMemo, value))
+    {
+        return;
+    }
+
+    if (m_protocol >= 4 && value.size() <= std::numeric_limits<std::uint8_t>::max())
+    {
+        WriteOpcode(PickleOpcode::SHORT_BINUNICODE);
+        WriteNumber(static_cast<std::uint8_t>(value.size()));
+    }
+    else if (value.size() <= std::numeric_limits<std::uint32_t>::max())
+    {
+        WriteOpcode(PickleOpcode::BINUNICODE);
+        WriteNumber(static_cast<std::uint32_t>(value.size()));
+    }
+    else if (m_protocol >= 4)
+    {
+        WriteOpcode(PickleOpcode::BINUNICODE8);
+        WriteNumber(static_cast<std::uint64_t>(value.size()));
+    }
+    else
+    {
+        throw Exception(fmt::format("String of {} bytes is too long for pickle protocol {}", value.size(), m_protocol));
+    }
+
+    WriteBytes(value);
+    WriteMemoPut(m_stringMemo, value);
+}
+
+void PickleWriter::WriteClass(std::string_view module, std::string_view name)
+{
+    std::string const key = fmt::format("{}\n{}", module, name);
+    if (WriteMemoGet(m_classMemo, key))
+    {
+        return;
+    }
+
+    if (m_protocol >= 4)
+    {
+        WriteStringValue(module);
+        WriteStringValue(name);
+        WriteOpcode(PickleOpcode::STACK_GLOBAL);
+    }
+    else
+    {
+        WriteOpcode(PickleOpcode::GLOBAL);
+        WriteBytes(key);
+        WriteBytes("\n");
+    }
+
+    WriteMemoPut(m_classMemo, key);
+}
+
+bool PickleWriter::WriteMemoGet(Memo const& memo, std::string_view key)
+{
+    auto const it = memo.find(key);
+    if (it == memo.end())
+    {
+        return false;
+    }
+
+    if (it->second <= std::numeric_limits<std::uint8_t>::max())
+    {
+        WriteOpcode(PickleOpcode::BINGET);
+        WriteNumber(static_cast<std::uint8_t>(it->second));
+    }
+    else
+    {
+        WriteOpcode(PickleOpcode::LONG_BINGET);
+        WriteNumber(it->second);
+    }
+
+    return true;
+}
+
+void PickleWriter::WriteMemoPut(Memo& memo, std::string_view key)
+{
+    if (m_protocol >= 4)
+    {
+        WriteOpcode(PickleOpcode::MEMOIZE);
+    }
+    else if (m_memoSize <= std::numeric_limits<std::uint8_t>::max())
+    {
+        WriteOpcode(PickleOpcode::BINPUT);
+        WriteNumber(static_cast<std::uint8_t>(m_memoSize));
+    }
+    else
+    {
+        WriteOpcode(PickleOpcode::LONG_BINPUT);
+        WriteNumber(m_memoSize);
+    }
+
+    memo.emplace(key, m_memoSize++);
+}
+
+void PickleWriter::WriteOpcode(int opcode)
+{
+    m_buffer += static_cast<char>(opcode);
+}
+
+void PickleWriter::WriteBytes(std::string_view value)
+{
+    m_buffer.append(value);
+}
+
+template<typename T>
+void PickleWriter::WriteNumber(T value, std::endian order)
+{
+    auto bytes = std::bit_cast<std::array<char, sizeof(T)>>(value);
+    if (order != std::endian::native)
+    {
+        std::reverse(bytes.begin(), bytes.end());
+    }
+
+    m_buffer.append(bytes.data(), bytes.size());
+}
+
+void PickleWriter::Flush()
+{
+    if (m_buffer.empty())
+    {
+        return;
+    }
+
+    if (m_protocol >= 4)
+    {
+        std::array<char, 1 + sizeof(std::uint64_t)> frameHeader;
+        frameHeader[0] = static_cast<char>(PickleOpcode::FRAME);
+        for (std::size_t i = 0, frameSize = m_buffer.size(); i < sizeof(std::uint64_t); ++i, frameSize >>= 8)
+        {
+            frameHeader[1 + i] = static_cast<char>(frameSize & 0xff);
+        }
+
+        m_stream.write(frameHeader.data(), static_cast<std::streamsize>(frameHeader.size()));
+    }
+
+    m_stream.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+}
@@ -0,0 +1,109 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Writes pickled data to the stream as values are produced, so that large states don't need to be built in memory
+// first. Strings and classes are memoized by value, with repeated occurrences referring back to the first one.
+class PickleWriter
+{
+public:
+    PickleWriter(std::ostream& stream, int protocol);
+    ~PickleWriter();
+
+    void BeginList();
+    void EndList();
+    void BeginDict();
+    void EndDict();
+    // Instance of `module.name` class created without calling its constructor; keys and values written until
+    // `EndObject()` form its state, same as for dictionaries
+    void BeginObject(std::string_view module, std::string_view name);
+    void EndObject();
+
+    void WriteNone();
+    void WriteBool(bool value);
+    void WriteInteger(std::int64_t value);
+    void WriteUnsigned(std::uint64_t value);
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+
+    // Terminates the pickle and writes out whatever is still buffered
+    void Finish();
+
+private:
+    enum class ContainerType
+    {
+        List,
+        Dict,
+        Object
+    };
+
+    struct Container
+    {
+        ContainerType Type;
+        std::size_t BatchSize;
+    };
+
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view value) const
+        {
+            return std::hash<std::string_view>()(value);
+        }
+    };
+
+    using Memo = std::unordered_map<std::string, std::uint32_t, StringHash, std::equal_to<>>;
+
+private:
+    void BeginValue();
+    void EndValue();
+    void BeginContainer(ContainerType type);
+    void EndContainer(ContainerType type);
+
+    void WriteStringValue(std::string_view value);
+    void WriteClass(std::string_view module, std::string_view name);
+    bool WriteMemoGet(Memo const& memo, std::string_view key);
+    void WriteMemoPut(Memo& memo, std::string_view key);
+
+    void WriteOpcode(int opcode);
+    void WriteBytes(std::string_view value);
+    template<typename T>
+    void WriteNumber(T value, std::endian order = std::endian::little);
+    void Flush();
+
+private:
+    std::ostream& m_stream;
+    int const m_protocol;
+    std::string m_buffer;
+    std::vector<Container> m_containers;
+    Memo m_stringMemo;
+    Memo m_classMemo;
+    std::uint32_t m_memoSize;
+    bool m_hasRoot;
+    bool m_isFinished;
+};
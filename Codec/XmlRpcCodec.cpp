@@ -0,0 +1,292 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "XmlRpcCodec.h"
+
+#include "Common/Exception.h"
+
+#include <fmt/format.h>
+#include <pugixml.hpp>
+
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+namespace Detail
+{
+
+std::size_t const MaxDepth = 512;
+
+} // namespace Detail
+} // namespace
+
+namespace
+{
+
+void WriteEscaped(std::ostream& stream, std::string_view text)
+{
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        char const* entity;
+        switch (text[i])
+        {
+        case '&':
+            entity = "&amp;";
+            break;
+        case '<':
+            entity = "&lt;";
+            break;
+        case '>':
+            entity = "&gt;";
+            break;
+        default:
+            continue;
+        }
+
+        stream << text.substr(begin, i - begin) << entity;
+        begin = i + 1;
+    }
+
+    stream << text.substr(begin);
+}
+
+void WriteValue(std::ostream& stream, ojson const& value)
+{
+    stream << "<value>";
+
+    if (value.is_string())
+    {
+        stream << "<string>";
+        WriteEscaped(stream, value.as_string_view());
+        stream << "</string>";
+    }
+    else if (value.is_bool())
+    {
+        stream << "<boolean>" << (value.as<bool>() ? 1 : 0) << "</boolean>";
+    }
+    else if (value.is_int64())
+    {
+        std::int64_t const number = value.as<std::int64_t>();
+        bool const isSmall = number >= std::numeric_limits<std::int32_t>::min() &&
+            number <= std::numeric_limits<std::int32_t>::max();
+        stream << (isSmall ? "<i4>" : "<i8>") << number << (isSmall ? "</i4>" : "</i8>");
+    }
+    else if (value.is_double())
+    {
+        stream << "<double>" << fmt::format("{}", value.as<double>()) << "</double>";
+    }
+    else if (value.is_byte_string())
+    {
+        std::string text;
+        auto const bytes = value.as_byte_string_view();
+        jsoncons::encode_base64(bytes.begin(), bytes.end(), text);
+        stream << "<base64>" << text << "</base64>";
+    }
+    else if (value.is_array())
+    {
+        stream << "<array><data>";
+        for (ojson const& item : value.array_range())
+        {
+            WriteValue(stream, item);
+        }
+        stream << "</data></array>";
+    }
+    else if (value.is_object())
+    {
+        stream << "<struct>";
+        for (auto const& member : value.object_range())
+        {
+            stream << "<member><name>";
+            WriteEscaped(stream, member.key());
+            stream << "</name>";
+            WriteValue(stream, member.value());
+            stream << "</member>";
+        }
+        stream << "</struct>";
+    }
+    else
+    {
+        throw Exception("Value can't be represented in XML-RPC");
+    }
+
+    stream << "</value>";
+}
+
+ojson ParseInteger(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '+'))
+    {
+        text.remove_prefix(1);
+    }
+
+    std::int64_t result = 0;
+    auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+    if (error != std::errc() || end != text.data() + text.size())
+    {
+        throw Exception(fmt::format("Invalid XML-RPC integer: {}", text));
+    }
+
+    return result;
+}
+
+ojson ParseDouble(std::string_view text)
+{
+    double result = 0;
+    auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+    if (error != std::errc() || end != text.data() + text.size())
+    {
+        throw Exception(fmt::format("Invalid XML-RPC double: {}", text));
+    }
+
+    return result;
+}
+
+ojson FromXmlValue(pugi::xml_node const& value, std::size_t depth)
+{
+    if (depth > Detail::MaxDepth)
+    {
+        throw Exception(fmt::format("XML-RPC value is nested deeper than {} levels", Detail::MaxDepth));
+    }
+
+    pugi::xml_node node = value.first_child();
+    while (node && node.type() != pugi::node_element)
+    {
+        node = node.next_sibling();
+    }
+
+    // Value without type element is a string
+    if (!node)
+    {
+        return std::string(value.child_value());
+    }
+
+    std::string_view const name = node.name();
+
+    if (name == "string" || name == "dateTime.iso8601")
+    {
+        return std::string(node.child_value());
+    }
+
+    if (name == "i4" || name == "int" || name == "i8")
+    {
+        return ParseInteger(node.child_value());
+    }
+
+    if (name == "boolean")
+    {
+        return std::string_view(node.child_value()) == "1";
+    }
+
+    if (name == "double")
+    {
+        return ParseDouble(node.child_value());
+    }
+
+    if (name == "base64")
+    {
+        std::string_view const text = node.child_value();
+        std::vector<std::uint8_t> bytes;
+        jsoncons::decode_base64(text.begin(), text.end(), bytes);
+        return ojson(jsoncons::byte_string_arg, bytes);
+    }
+
+    if (name == "array")
+    {
+        ojson result = ojson::array();
+        for (pugi::xml_node item = node.child("data").first_child(); item; item = item.next_sibling())
+        {
+            result.push_back(FromXmlValue(item, depth + 1));
+        }
+        return result;
+    }
+
+    if (name == "struct")
+    {
+        ojson result = ojson::object();
+        for (pugi::xml_node member = node.first_child(); member; member = member.next_sibling())
+        {
+            result.insert_or_assign(std::string_view(member.child("name").child_value()),
+                FromXmlValue(member.child("value"), depth + 1));
+        }
+        return result;
+    }
+
+    if (name == "nil")
+    {
+        return ojson::null();
+    }
+
+    throw Exception(fmt::format("XML-RPC element <{}> is not supported", name));
+}
+
+} // namespace
+
+XmlRpcCodec::XmlRpcCodec() = default;
+XmlRpcCodec::~XmlRpcCodec() = default;
+
+void XmlRpcCodec::EncodeCall(std::ostream& stream, std::string_view methodName, ojson const& params) const
+{
+    stream << "<?xml version=\"1.0\"?><methodCall><methodName>";
+    WriteEscaped(stream, methodName);
+    stream << "</methodName><params>";
+
+    for (ojson const& param : params.array_range())
+    {
+        stream << "<param>";
+        WriteValue(stream, param);
+        stream << "</param>";
+    }
+
+    stream << "</params></methodCall>";
+}
+
+void XmlRpcCodec::DecodeResponse(std::span<char const> data, ojson& result) const
+{
+    pugi::xml_document doc;
+    pugi::xml_parse_result const parseResult = doc.load_buffer(data.data(), data.size());
+    if (!parseResult)
+    {
+        throw Exception(fmt::format("Unable to parse XML-RPC response: {}", parseResult.description()));
+    }
+
+    pugi::xml_node const response = doc.child("methodResponse");
+
+    if (pugi::xml_node const fault = response.child("fault"); fault)
+    {
+        ojson const faultValue = FromXmlValue(fault.child("value"), 0);
+        if (!faultValue.is_object())
+        {
+            throw Exception("XML-RPC fault is malformed");
+        }
+
+        throw Exception(fmt::format("XML-RPC fault {}: {}", faultValue.get_value_or<std::int64_t>("faultCode", 0),
+            faultValue.get_value_or<std::string>("faultString", "")));
+    }
+
+    pugi::xml_node const value = response.child("params").child("param").child("value");
+    if (!value)
+    {
+        throw Exception("XML-RPC response has no value");
+    }
+
+    result = FromXmlValue(value, 0);
+}
@@ -0,0 +1,38 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <jsoncons/json.hpp>
+
+#include <iosfwd>
+#include <span>
+#include <string_view>
+
+using jsoncons::ojson;
+
+// XML-RPC values map onto JSON ones, except for base64 which becomes byte strings and dateTime.iso8601 which is kept
+// as string. Calls are only encoded and responses only decoded, since this side is always a client.
+class XmlRpcCodec
+{
+public:
+    XmlRpcCodec();
+    ~XmlRpcCodec();
+
+    void EncodeCall(std::ostream& stream, std::string_view methodName, ojson const& params) const;
+    // Throws on fault responses
+    void DecodeResponse(std::span<char const> data, ojson& result) const;
+};
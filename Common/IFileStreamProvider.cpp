@@ -1,5 +1,20 @@
 #include "IFileStreamProvider.h"
 
+namespace fs = std::filesystem;
+
 IFileStreamProvider::~IFileStreamProvider() noexcept(false)
 {
 }
+
+std::vector<IWriteStreamPtr> IFileStreamProvider::GetWriteStreams(std::vector<fs::path> const& paths)
+{
+    std::vector<IWriteStreamPtr> result;
+    result.reserve(paths.size());
+
+    for (fs::path const& path : paths)
+    {
+        result.push_back(GetWriteStream(path));
+    }
+
+    return result;
+}
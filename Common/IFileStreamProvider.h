@@ -19,9 +19,13 @@
 #include <filesystem>
 #include <iosfwd>
 #include <memory>
+#include <vector>
+
+class MappedFile;
 
 typedef std::unique_ptr<std::istream> IReadStreamPtr;
 typedef std::unique_ptr<std::ostream> IWriteStreamPtr;
+typedef std::unique_ptr<MappedFile const> MappedFilePtr;
 
 class IFileStreamProvider
 {
@@ -29,5 +33,9 @@ public:
     virtual ~IFileStreamProvider() noexcept(false);
 
     virtual IReadStreamPtr GetReadStream(std::filesystem::path const& path) const = 0;
+    virtual MappedFilePtr GetMappedFile(std::filesystem::path const& path) const = 0;
     virtual IWriteStreamPtr GetWriteStream(std::filesystem::path const& path) = 0;
+    // Files written together are also committed together, last path first, so that clients keying on the first file
+    // (e.g. the .torrent one) never see it without the rest
+    virtual std::vector<IWriteStreamPtr> GetWriteStreams(std::vector<std::filesystem::path> const& paths);
 };
@@ -0,0 +1,149 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "MappedFile.h"
+
+#include "Exception.h"
+
+#include <fmt/format.h>
+#include <fmt/std.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(fs::path const& path) :
+    m_data(nullptr),
+    m_size(0)
+{
+    HANDLE const file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw Exception(fmt::format("Unable to open file for mapping: {} (error {})", path, ::GetLastError()));
+    }
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(file, &size))
+    {
+        DWORD const error = ::GetLastError();
+        ::CloseHandle(file);
+        throw Exception(fmt::format("Unable to get file size: {} (error {})", path, error));
+    }
+
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    // Empty files can't be mapped, and there is nothing to map anyway
+    if (m_size != 0)
+    {
+        HANDLE const mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        DWORD const error = ::GetLastError();
+        ::CloseHandle(file);
+        if (mapping == nullptr)
+        {
+            throw Exception(fmt::format("Unable to map file: {} (error {})", path, error));
+        }
+
+        // View keeps the mapping alive on its own
+        m_data = static_cast<char const*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        DWORD const viewError = ::GetLastError();
+        ::CloseHandle(mapping);
+        if (m_data == nullptr)
+        {
+            throw Exception(fmt::format("Unable to map file: {} (error {})", path, viewError));
+        }
+    }
+    else
+    {
+        ::CloseHandle(file);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr)
+    {
+        ::UnmapViewOfFile(m_data);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(fs::path const& path) :
+    m_data(nullptr),
+    m_size(0)
+{
+    int const file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file == -1)
+    {
+        throw Exception(fmt::format("Unable to open file for mapping: {} ({})", path, std::strerror(errno)));
+    }
+
+    struct stat status;
+    if (::fstat(file, &status) == -1)
+    {
+        int const error = errno;
+        ::close(file);
+        throw Exception(fmt::format("Unable to get file size: {} ({})", path, std::strerror(error)));
+    }
+
+    m_size = static_cast<std::size_t>(status.st_size);
+
+    // Empty files can't be mapped, and there is nothing to map anyway
+    if (m_size != 0)
+    {
+        void* const data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+        int const error = errno;
+        ::close(file);
+        if (data == MAP_FAILED)
+        {
+            throw Exception(fmt::format("Unable to map file: {} ({})", path, std::strerror(error)));
+        }
+
+        m_data = static_cast<char const*>(data);
+    }
+    else
+    {
+        ::close(file);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr)
+    {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+}
+
+#endif
+
+std::span<char const> MappedFile::GetData() const
+{
+    return {m_data, m_size};
+}
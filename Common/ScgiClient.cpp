@@ -0,0 +1,482 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "ScgiClient.h"
+
+#include "Exception.h"
+
+#include <fmt/format.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace
+{
+namespace Detail
+{
+
+std::string_view const HeaderSeparator = "\r\n\r\n";
+std::string_view const StatusHeader = "Status: ";
+std::string_view const OkStatus = "200";
+
+std::size_t const IoChunkSize = 64 * 1024;
+
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+SocketHandle const InvalidSocket = INVALID_SOCKET;
+#else
+typedef int SocketHandle;
+SocketHandle const InvalidSocket = -1;
+#endif
+
+#if defined(MSG_NOSIGNAL)
+int const SendFlags = MSG_NOSIGNAL;
+#else
+int const SendFlags = 0;
+#endif
+
+} // namespace Detail
+} // namespace
+
+namespace
+{
+
+#ifdef _WIN32
+
+std::string GetLastSocketError()
+{
+    return fmt::format("error {}", ::WSAGetLastError());
+}
+
+void CloseSocket(Detail::SocketHandle socket)
+{
+    ::closesocket(socket);
+}
+
+bool IsLastSocketErrorTimeout()
+{
+    int const error = ::WSAGetLastError();
+    return error == WSAETIMEDOUT || error == WSAEWOULDBLOCK;
+}
+
+bool IsLastSocketErrorInProgress()
+{
+    return ::WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+bool SetSocketBlocking(Detail::SocketHandle socket, bool isBlocking)
+{
+    u_long isNonBlocking = isBlocking ? 0 : 1;
+    return ::ioctlsocket(socket, FIONBIO, &isNonBlocking) == 0;
+}
+
+bool SetSocketIoTimeout(Detail::SocketHandle socket, std::chrono::milliseconds timeout)
+{
+    DWORD const value = static_cast<DWORD>(timeout.count());
+    return
+        ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<char const*>(&value), sizeof(value)) == 0 &&
+        ::setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<char const*>(&value), sizeof(value)) == 0;
+}
+
+void InitializeSockets()
+{
+    static int const result =
+        []
+        {
+            WSADATA data;
+            return ::WSAStartup(MAKEWORD(2, 2), &data);
+        }();
+
+    if (result != 0)
+    {
+        throw Exception(fmt::format("Unable to initialize Windows sockets (error {})", result));
+    }
+}
+
+#else
+
+std::string GetLastSocketError()
+{
+    return std::strerror(errno);
+}
+
+void CloseSocket(Detail::SocketHandle socket)
+{
+    ::close(socket);
+}
+
+bool IsLastSocketErrorTimeout()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == ETIMEDOUT;
+}
+
+bool IsLastSocketErrorInProgress()
+{
+    return errno == EINPROGRESS;
+}
+
+bool SetSocketBlocking(Detail::SocketHandle socket, bool isBlocking)
+{
+    int const flags = ::fcntl(socket, F_GETFL);
+    return flags != -1 && ::fcntl(socket, F_SETFL, isBlocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK)) != -1;
+}
+
+bool SetSocketIoTimeout(Detail::SocketHandle socket, std::chrono::milliseconds timeout)
+{
+    timeval value = {};
+    value.tv_sec = static_cast<decltype(value.tv_sec)>(timeout.count() / 1000);
+    value.tv_usec = static_cast<decltype(value.tv_usec)>(timeout.count() % 1000 * 1000);
+    return
+        ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &value, sizeof(value)) == 0 &&
+        ::setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &value, sizeof(value)) == 0;
+}
+
+void InitializeSockets()
+{
+    //
+}
+
+#endif
+
+class Socket
+{
+public:
+    explicit Socket(Detail::SocketHandle handle) :
+        m_handle(handle)
+    {
+        //
+    }
+
+    ~Socket()
+    {
+        if (m_handle != Detail::InvalidSocket)
+        {
+            CloseSocket(m_handle);
+        }
+    }
+
+    Socket(Socket const&) = delete;
+    Socket& operator=(Socket const&) = delete;
+
+    Detail::SocketHandle Get() const
+    {
+        return m_handle;
+    }
+
+private:
+    Detail::SocketHandle const m_handle;
+};
+
+// Connection is attempted in non-blocking mode so that it could be abandoned once timeout expires; socket is switched
+// back to blocking mode afterwards, with the same timeout applied to each send and receive
+bool ConnectSocket(Socket const& socket, sockaddr const* address, std::size_t addressSize,
+    std::chrono::milliseconds timeout, std::string& error)
+{
+    if (socket.Get() == Detail::InvalidSocket || !SetSocketBlocking(socket.Get(), false))
+    {
+        error = GetLastSocketError();
+        return false;
+    }
+
+    if (::connect(socket.Get(), address, static_cast<int>(addressSize)) != 0)
+    {
+        if (!IsLastSocketErrorInProgress())
+        {
+            error = GetLastSocketError();
+            return false;
+        }
+
+        fd_set sockets;
+        FD_ZERO(&sockets);
+        FD_SET(socket.Get(), &sockets);
+
+        timeval selectTimeout = {};
+        selectTimeout.tv_sec = static_cast<decltype(selectTimeout.tv_sec)>(timeout.count() / 1000);
+        selectTimeout.tv_usec = static_cast<decltype(selectTimeout.tv_usec)>(timeout.count() % 1000 * 1000);
+
+        int const selectResult = ::select(static_cast<int>(socket.Get()) + 1, nullptr, &sockets, nullptr,
+            &selectTimeout);
+        if (selectResult < 0)
+        {
+            error = GetLastSocketError();
+            return false;
+        }
+
+        if (selectResult == 0)
+        {
+            error = fmt::format("timed out after {} ms", timeout.count());
+            return false;
+        }
+
+        int connectError = 0;
+        socklen_t connectErrorSize = sizeof(connectError);
+        if (::getsockopt(socket.Get(), SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&connectError),
+            &connectErrorSize) != 0)
+        {
+            error = GetLastSocketError();
+            return false;
+        }
+
+        if (connectError != 0)
+        {
+#ifdef _WIN32
+            error = fmt::format("error {}", connectError);
+#else
+            error = std::strerror(connectError);
+#endif
+            return false;
+        }
+    }
+
+    if (!SetSocketBlocking(socket.Get(), true) || !SetSocketIoTimeout(socket.Get(), timeout))
+    {
+        error = GetLastSocketError();
+        return false;
+    }
+
+    return true;
+}
+
+// "<host>:<port>", with host possibly in brackets if it's IPv6 address; anything else is a socket path
+bool ParseTcpAddress(std::string const& address, std::string& host, std::string& port)
+{
+    std::size_t const colonPos = address.rfind(':');
+    if (colonPos == std::string::npos || colonPos == 0 || colonPos + 1 == address.size() ||
+        address.find('/') != std::string::npos)
+    {
+        return false;
+    }
+
+    if (!std::all_of(address.begin() + colonPos + 1, address.end(), [](char c) { return c >= '0' && c <= '9'; }))
+    {
+        return false;
+    }
+
+    host = address.substr(0, colonPos);
+    port = address.substr(colonPos + 1);
+
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+    {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    return true;
+}
+
+std::unique_ptr<Socket> ConnectTcp(std::string const& address, std::string const& host, std::string const& port,
+    std::chrono::milliseconds timeout)
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    addrinfo* addresses = nullptr;
+    if (int const error = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses); error != 0)
+    {
+        throw Exception(fmt::format("Unable to resolve SCGI server address: {} ({})", address, ::gai_strerror(error)));
+    }
+
+    std::string lastError = "no addresses";
+    std::unique_ptr<Socket> result;
+
+    for (addrinfo const* it = addresses; it != nullptr && result == nullptr; it = it->ai_next)
+    {
+        auto socket = std::make_unique<Socket>(::socket(it->ai_family, it->ai_socktype, it->ai_protocol));
+        if (!ConnectSocket(*socket, it->ai_addr, it->ai_addrlen, timeout, lastError))
+        {
+            continue;
+        }
+
+        result = std::move(socket);
+    }
+
+    ::freeaddrinfo(addresses);
+
+    if (result == nullptr)
+    {
+        throw Exception(fmt::format("Unable to connect to SCGI server: {} ({})", address, lastError));
+    }
+
+    return result;
+}
+
+std::unique_ptr<Socket> ConnectLocal(std::string const& path, std::chrono::milliseconds timeout)
+{
+#ifdef _WIN32
+    throw Exception(fmt::format("Unix domain sockets are not supported on this platform: {}", path));
+#else
+    sockaddr_un localAddress = {};
+    localAddress.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(localAddress.sun_path))
+    {
+        throw Exception(fmt::format("SCGI socket path is too long: {}", path));
+    }
+
+    std::copy(path.begin(), path.end(), localAddress.sun_path);
+
+    auto result = std::make_unique<Socket>(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (std::string error; !ConnectSocket(*result, reinterpret_cast<sockaddr const*>(&localAddress),
+        sizeof(localAddress), timeout, error))
+    {
+        throw Exception(fmt::format("Unable to connect to SCGI server: {} ({})", path, error));
+    }
+
+    return result;
+#endif
+}
+
+// Request is a netstring of NUL-separated headers, CONTENT_LENGTH going first, followed by the body
+std::string FormatRequest(std::string_view body)
+{
+    using namespace std::string_view_literals;
+
+    std::string headers;
+    headers += "CONTENT_LENGTH"sv;
+    headers += '\0';
+    headers += std::to_string(body.size());
+    headers += '\0';
+    headers += "SCGI\0" "1\0"sv;
+    headers += "REQUEST_METHOD\0" "POST\0"sv;
+    headers += "REQUEST_URI\0" "/RPC2\0"sv;
+
+    std::string result;
+    result.reserve(headers.size() + body.size() + 16);
+    result += std::to_string(headers.size());
+    result += ':';
+    result += headers;
+    result += ',';
+    result += body;
+    return result;
+}
+
+// Response is CGI-like: headers (optionally including status), blank line, body
+std::string ParseResponse(std::string const& address, std::string&& response)
+{
+    std::size_t const separatorPos = response.find(Detail::HeaderSeparator);
+    if (separatorPos == std::string::npos)
+    {
+        throw Exception(fmt::format("Malformed response from SCGI server: {}", address));
+    }
+
+    std::string_view const headers = std::string_view(response).substr(0, separatorPos);
+    if (headers.starts_with(Detail::StatusHeader))
+    {
+        std::string_view const status = headers.substr(Detail::StatusHeader.size(),
+            headers.find("\r\n") - Detail::StatusHeader.size());
+        if (!status.starts_with(Detail::OkStatus))
+        {
+            throw Exception(fmt::format("SCGI server {} responded with status: {}", address, status));
+        }
+    }
+
+    response.erase(0, separatorPos + Detail::HeaderSeparator.size());
+    return std::move(response);
+}
+
+} // namespace
+
+ScgiClient::ScgiClient(std::string const& address, std::chrono::milliseconds timeout) :
+    m_address(address),
+    m_timeout(timeout)
+{
+    InitializeSockets();
+}
+
+ScgiClient::~ScgiClient() = default;
+
+std::string const& ScgiClient::GetAddress() const
+{
+    return m_address;
+}
+
+std::string ScgiClient::Send(std::string_view body) const
+{
+    std::unique_ptr<Socket> socket;
+    if (std::string host, port; ParseTcpAddress(m_address, host, port))
+    {
+        socket = ConnectTcp(m_address, host, port, m_timeout);
+    }
+    else
+    {
+        socket = ConnectLocal(m_address, m_timeout);
+    }
+
+    std::string const request = FormatRequest(body);
+    for (std::size_t offset = 0; offset < request.size();)
+    {
+        std::size_t const chunkSize = std::min<std::size_t>(request.size() - offset, Detail::IoChunkSize);
+        auto const sentSize = ::send(socket->Get(), request.data() + offset, static_cast<int>(chunkSize),
+            Detail::SendFlags);
+        if (sentSize < 0 && IsLastSocketErrorTimeout())
+        {
+            throw Exception(fmt::format("SCGI server {} did not accept request within {} ms", m_address,
+                m_timeout.count()));
+        }
+
+        if (sentSize <= 0)
+        {
+            throw Exception(fmt::format("Unable to send request to SCGI server: {} ({})", m_address,
+                GetLastSocketError()));
+        }
+
+        offset += static_cast<std::size_t>(sentSize);
+    }
+
+    std::string response;
+    std::array<char, Detail::IoChunkSize> buffer;
+    while (true)
+    {
+        auto const receivedSize = ::recv(socket->Get(), buffer.data(), static_cast<int>(buffer.size()), 0);
+        if (receivedSize < 0 && IsLastSocketErrorTimeout())
+        {
+            throw Exception(fmt::format("SCGI server {} did not respond within {} ms", m_address, m_timeout.count()));
+        }
+
+        if (receivedSize < 0)
+        {
+            throw Exception(fmt::format("Unable to receive response from SCGI server: {} ({})", m_address,
+                GetLastSocketError()));
+        }
+
+        if (receivedSize == 0)
+        {
+            break;
+        }
+
+        response.append(buffer.data(), static_cast<std::size_t>(receivedSize));
+    }
+
+    return ParseResponse(m_address, std::move(response));
+}
@@ -0,0 +1,43 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+// Client side of SCGI protocol, as spoken by e.g. rTorrent's XML-RPC endpoint. Address is either "<host>:<port>" or
+// path to Unix domain socket. Server closes connection after each response, so every request opens a new one.
+// Connecting, as well as each send and receive, fails if server doesn't make progress within the timeout.
+class ScgiClient
+{
+public:
+    ScgiClient(std::string const& address, std::chrono::milliseconds timeout);
+    ~ScgiClient();
+
+    ScgiClient(ScgiClient const&) = delete;
+    ScgiClient& operator=(ScgiClient const&) = delete;
+
+    std::string const& GetAddress() const;
+
+    // Returns response body, with headers stripped
+    std::string Send(std::string_view body) const;
+
+private:
+    std::string const m_address;
+    std::chrono::milliseconds const m_timeout;
+};
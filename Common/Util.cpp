@@ -27,6 +27,7 @@
 #include <cerrno>
 #include <cstdlib>
 #include <filesystem>
+#include <istream>
 #include <locale>
 
 namespace fs = std::filesystem;
@@ -82,9 +83,9 @@ fs::path GetPath(std::string_view nativePath)
     }
 }
 
-std::string CalculateSha1(std::string const& data)
+std::string CalculateSha1(std::string_view data)
 {
-    return digestpp::sha1().absorb(data).hexdigest();
+    return digestpp::sha1().absorb(data.data(), data.size()).hexdigest();
 }
 
 std::string BinaryToHex(std::string const& data)
@@ -137,4 +138,31 @@ std::string_view Trim(std::string_view text)
     return text;
 }
 
+std::string ReadStream(std::istream& stream)
+{
+    std::string result;
+
+    // Going through stream buffer directly to avoid tripping over exceptions set on the stream itself
+    std::streambuf& buffer = *stream.rdbuf();
+
+    std::streampos const begin = buffer.pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+    std::streampos const end = buffer.pubseekoff(0, std::ios_base::end, std::ios_base::in);
+    if (begin != std::streampos(-1) && end != std::streampos(-1) &&
+        buffer.pubseekpos(begin, std::ios_base::in) == begin)
+    {
+        result.resize(static_cast<std::size_t>(end - begin));
+        result.resize(static_cast<std::size_t>(buffer.sgetn(result.data(), result.size())));
+    }
+    else
+    {
+        char chunk[64 * 1024];
+        for (std::streamsize size; (size = buffer.sgetn(chunk, sizeof(chunk))) > 0;)
+        {
+            result.append(chunk, static_cast<std::size_t>(size));
+        }
+    }
+
+    return result;
+}
+
 } // namespace Util
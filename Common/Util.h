@@ -19,6 +19,7 @@
 #include <jsoncons/json.hpp>
 
 #include <filesystem>
+#include <iosfwd>
 #include <locale>
 #include <string>
 #include <string_view>
@@ -32,7 +33,7 @@ long long StringToInt(std::string const& text);
 
 std::filesystem::path GetPath(std::string_view nativePath);
 
-std::string CalculateSha1(std::string const& data);
+std::string CalculateSha1(std::string_view data);
 
 std::string BinaryToHex(std::string const& data);
 
@@ -44,4 +45,6 @@ bool IsEqualNoCase(std::string_view lhs, std::string_view rhs, std::locale const
 
 std::string_view Trim(std::string_view text);
 
+std::string ReadStream(std::istream& stream);
+
 } // namespace Util
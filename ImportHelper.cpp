@@ -32,7 +32,10 @@ ImportHelper::ImportHelper(ITorrentStateStorePtr sourceStore, fs::path const& so
     m_targetStore(std::move(targetStore)),
     m_targetDataDir(targetDataDir),
     m_fileStreamProvider(fileStreamProvider),
-    m_signalHandler(signalHandler)
+    m_signalHandler(signalHandler),
+    m_isExportFailed(false),
+    m_exportError(),
+    m_exportErrorMutex()
 {
     //
 }
@@ -42,12 +45,16 @@ ImportHelper::~ImportHelper() = default;
 ImportHelper::Result ImportHelper::Import(unsigned int threadCount)
 {
     Result result;
+    m_isExportFailed = false;
+    m_exportError = nullptr;
 
     try
     {
         ITorrentStateIteratorPtr boxes = m_sourceStore->Export(m_sourceDataDir, m_fileStreamProvider);
         boxes = std::make_unique<DebugTorrentStateIterator>(std::move(boxes));
 
+        m_targetStore->BeginImport(m_targetDataDir, m_fileStreamProvider);
+
         std::vector<std::thread> threads;
         for (unsigned int i = 0; i < threadCount; ++i)
         {
@@ -59,6 +66,14 @@ ImportHelper::Result ImportHelper::Import(unsigned int threadCount)
         {
             thread.join();
         }
+
+        // Torrents imported before interruption still need to be accounted for
+        m_targetStore->FinishImport(m_targetDataDir, m_fileStreamProvider);
+
+        if (m_isExportFailed)
+        {
+            std::rethrow_exception(m_exportError);
+        }
     }
     catch (std::exception const& e)
     {
@@ -80,7 +95,7 @@ ImportHelper::Result ImportHelper::Import(unsigned int threadCount)
 void ImportHelper::ImportImpl(fs::path const& targetDataDir, ITorrentStateIterator& boxes, Result& result)
 {
     Box box;
-    while (!m_signalHandler.IsInterrupted() && boxes.GetNext(box))
+    while (!m_signalHandler.IsInterrupted() && GetNextBox(boxes, box))
     {
         std::string const prefix = "[" + box.SavePath.filename().string() + "] ";
 
@@ -103,3 +118,30 @@ void ImportHelper::ImportImpl(fs::path const& targetDataDir, ITorrentStateIterat
         }
     }
 }
+
+// Source stores may decode lazily, so that export errors surface here, on worker threads, rather than in Export; the
+// first one stops all workers and is rethrown once they are done
+bool ImportHelper::GetNextBox(ITorrentStateIterator& boxes, Box& box)
+{
+    if (m_isExportFailed)
+    {
+        return false;
+    }
+
+    try
+    {
+        return boxes.GetNext(box);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(m_exportErrorMutex);
+
+        if (!m_isExportFailed)
+        {
+            m_exportError = std::current_exception();
+            m_isExportFailed = true;
+        }
+    }
+
+    return false;
+}
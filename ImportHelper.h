@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <exception>
 #include <filesystem>
 #include <memory>
+#include <mutex>
 
 template<typename... ArgsT>
 class IForwardIterator;
@@ -39,6 +42,7 @@ public:
 
 private:
     void ImportImpl(std::filesystem::path const& targetDataDir, ITorrentStateIterator& boxes, Result& result);
+    bool GetNextBox(ITorrentStateIterator& boxes, Box& box);
 
 private:
     ITorrentStateStorePtr const m_sourceStore;
@@ -47,4 +51,7 @@ private:
     std::filesystem::path const m_targetDataDir;
     IFileStreamProvider& m_fileStreamProvider;
     SignalHandler const& m_signalHandler;
+    std::atomic<bool> m_isExportFailed;
+    std::exception_ptr m_exportError;
+    std::mutex m_exportErrorMutex;
 };
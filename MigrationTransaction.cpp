@@ -18,6 +18,7 @@
 
 #include "Common/Exception.h"
 #include "Common/Logger.h"
+#include "Common/MappedFile.h"
 
 #include <fmt/chrono.h>
 #include <fmt/format.h>
@@ -28,6 +29,7 @@
 #include <fstream>
 #include <locale>
 #include <sstream>
+#include <system_error>
 
 namespace fs = std::filesystem;
 
@@ -36,6 +38,7 @@ MigrationTransaction::MigrationTransaction(bool writeThrough, bool dryRun) :
     m_dryRun(dryRun),
     m_transactionId(fmt::format("{:%FT%T%z}", std::chrono::system_clock::now())),
     m_safePaths(),
+    m_commitUnits(),
     m_safePathsMutex()
 {
     //
@@ -75,17 +78,26 @@ void MigrationTransaction::Commit()
 
     Logger(Logger::Info) << "Committing changes";
 
-    for (fs::path const& safePath : m_safePaths)
+    for (std::vector<fs::path> const& unit : m_commitUnits)
     {
-        if (fs::exists(safePath))
+        for (auto it = unit.rbegin(); it != unit.rend(); ++it)
         {
-            fs::rename(safePath, GetBackupPath(safePath));
-        }
+            fs::path const& safePath = *it;
+
+            // Trying to back up right away instead of checking whether there is anything to back up saves a stat
+            std::error_code error;
+            fs::rename(safePath, GetBackupPath(safePath), error);
+            if (error && error != std::errc::no_such_file_or_directory)
+            {
+                throw Exception(fmt::format("Unable to back up file: {} ({})", safePath, error.message()));
+            }
 
-        fs::rename(GetTemporaryPath(safePath), safePath);
+            fs::rename(GetTemporaryPath(safePath), safePath);
+        }
     }
 
     m_safePaths.clear();
+    m_commitUnits.clear();
 }
 
 IReadStreamPtr MigrationTransaction::GetReadStream(fs::path const& path) const
@@ -112,7 +124,73 @@ IReadStreamPtr MigrationTransaction::GetReadStream(fs::path const& path) const
     return result;
 }
 
+MappedFilePtr MigrationTransaction::GetMappedFile(fs::path const& path) const
+{
+    try
+    {
+        return std::make_unique<MappedFile const>(m_safePaths.find(path) != m_safePaths.end() ?
+            GetTemporaryPath(path) : path);
+    }
+    catch (std::exception const&)
+    {
+        throw Exception(fmt::format("Unable to open file for reading: {}", path));
+    }
+}
+
 IWriteStreamPtr MigrationTransaction::GetWriteStream(fs::path const& path)
+{
+    return std::move(GetWriteStreams({path}).front());
+}
+
+std::vector<IWriteStreamPtr> MigrationTransaction::GetWriteStreams(std::vector<fs::path> const& paths)
+{
+    std::vector<IWriteStreamPtr> result;
+    result.reserve(paths.size());
+
+    try
+    {
+        for (fs::path const& path : paths)
+        {
+            result.push_back(OpenWriteStream(path));
+        }
+    }
+    catch (std::exception const&)
+    {
+        // Don't leave part of the unit behind
+        if (!m_writeThrough && !m_dryRun)
+        {
+            for (std::size_t i = 0; i < result.size(); ++i)
+            {
+                result[i].reset();
+
+                std::error_code error;
+                fs::remove(GetTemporaryPath(paths[i]), error);
+            }
+        }
+
+        throw;
+    }
+
+    if (!m_writeThrough && !m_dryRun)
+    {
+        std::lock_guard<std::mutex> lock(m_safePathsMutex);
+
+        std::vector<fs::path>& unit = m_commitUnits.emplace_back();
+        unit.reserve(paths.size());
+
+        for (fs::path const& path : paths)
+        {
+            if (m_safePaths.insert(path).second)
+            {
+                unit.push_back(path);
+            }
+        }
+    }
+
+    return result;
+}
+
+IWriteStreamPtr MigrationTransaction::OpenWriteStream(fs::path const& path) const
 {
     static std::string const BlackHoleFilename =
 #ifdef _WIN32
@@ -136,10 +214,7 @@ IWriteStreamPtr MigrationTransaction::GetWriteStream(fs::path const& path)
         }
         else
         {
-            std::lock_guard<std::mutex> lock(m_safePathsMutex);
-
             result->open(GetTemporaryPath(path), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
-            m_safePaths.insert(path);
         }
     }
     catch (std::exception const&)
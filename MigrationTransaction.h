@@ -22,6 +22,7 @@
 #include <mutex>
 #include <set>
 #include <string>
+#include <vector>
 
 class MigrationTransaction : public IFileStreamProvider
 {
@@ -34,9 +35,12 @@ public:
 public:
     // IFileStreamProvider
     IReadStreamPtr GetReadStream(std::filesystem::path const& path) const override;
+    MappedFilePtr GetMappedFile(std::filesystem::path const& path) const override;
     IWriteStreamPtr GetWriteStream(std::filesystem::path const& path) override;
+    std::vector<IWriteStreamPtr> GetWriteStreams(std::vector<std::filesystem::path> const& paths) override;
 
 private:
+    IWriteStreamPtr OpenWriteStream(std::filesystem::path const& path) const;
     std::filesystem::path GetTemporaryPath(std::filesystem::path const& path) const;
     std::filesystem::path GetBackupPath(std::filesystem::path const& path) const;
 
@@ -45,5 +49,6 @@ private:
     bool const m_dryRun;
     std::string const m_transactionId;
     std::set<std::filesystem::path> m_safePaths;
+    std::vector<std::vector<std::filesystem::path>> m_commitUnits;
     std::mutex m_safePathsMutex;
 };
@@ -16,12 +16,15 @@
 
 #include "DelugeStateStore.h"
 
-#include "Codec/BencodeCodec.h"
+#include "Codec/BencodeDataCursor.h"
+#include "Codec/BencodeDocument.h"
+#include "Codec/BencodeStructuralIndex.h"
 #include "Codec/PickleCodec.h"
 #include "Common/Exception.h"
 #include "Common/IFileStreamProvider.h"
 #include "Common/IForwardIterator.h"
 #include "Common/Logger.h"
+#include "Common/MappedFile.h"
 #include "Common/Util.h"
 #include "Torrent/Box.h"
 #include "Torrent/BoxHelper.h"
@@ -29,12 +32,20 @@
 #include <fmt/format.h>
 #include <jsoncons/json.hpp>
 
+#include <array>
+#include <charconv>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <limits>
 #include <locale>
+#include <memory>
 #include <mutex>
-#include <sstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 namespace fs = std::filesystem;
 
@@ -125,13 +136,13 @@ Box::LimitInfo FromStoreSpeedLimit(ojson const& storeLimit)
     return result;
 }
 
-fs::path GetChangedFilePath(ojson const& mappedFiles, std::size_t index)
+fs::path GetChangedFilePath(BencodeValue const& mappedFiles, std::size_t index)
 {
     fs::path result;
 
-    if (!mappedFiles.is_null() && index < mappedFiles.size())
+    if (!mappedFiles.IsNull() && index < mappedFiles.GetSize())
     {
-        if (const auto maybePath = mappedFiles[index].as<std::string>(); !maybePath.empty())
+        if (const auto maybePath = mappedFiles[index].AsString(); !maybePath.empty())
         {
             fs::path const path = Util::GetPath(maybePath);
             fs::path::iterator pathIt = path.begin();
@@ -145,10 +156,77 @@ fs::path GetChangedFilePath(ojson const& mappedFiles, std::size_t index)
     return result;
 }
 
+using InfoHash = std::array<std::uint8_t, 20>;
+
+struct InfoHashHash
+{
+    std::size_t operator()(InfoHash const& value) const
+    {
+        // Hash is already uniformly distributed, any part of it would do
+        std::size_t result;
+        std::memcpy(&result, value.data(), sizeof(result));
+        return result;
+    }
+};
+
+using FastResumeIndex = std::unordered_map<InfoHash, std::span<char const>, InfoHashHash>;
+
+bool ParseInfoHash(std::string_view text, InfoHash& infoHash)
+{
+    if (text.size() != infoHash.size() * 2)
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < infoHash.size(); ++i)
+    {
+        char const* const begin = text.data() + i * 2;
+        auto const [end, error] = std::from_chars(begin, begin + 2, infoHash[i], 16);
+        if (error != std::errc() || end != begin + 2)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Resume data of each torrent is stored as a bencoded string under hex infohash key; only locating those strings is
+// needed up front, decoding is left to whichever thread processes the torrent
+FastResumeIndex IndexFastResume(std::span<char const> data)
+{
+    BencodeStructuralIndex const index(data);
+
+    FastResumeIndex result;
+    result.reserve(index.GetEntries().size());
+
+    for (BencodeStructuralIndex::Entry const& entry : index.GetEntries())
+    {
+        InfoHash infoHash;
+        if (!ParseInfoHash(entry.Key, infoHash))
+        {
+            Logger(Logger::Warning) << "Resume info key " << entry.Key << " is not an infohash, skipping";
+            continue;
+        }
+
+        // Structural index has validated framing already, so leading digit is all it takes to be a string
+        if (entry.Value.empty() || entry.Value.front() < '0' || entry.Value.front() > '9')
+        {
+            Logger(Logger::Warning) << "Resume info value for " << entry.Key << " is not a string, skipping";
+            continue;
+        }
+
+        std::string_view const resumeData = BencodeDataCursor(entry.Value).GetString();
+        result.insert_or_assign(infoHash, std::span<char const>(resumeData.data(), resumeData.size()));
+    }
+
+    return result;
+}
+
 class DelugeTorrentStateIterator : public ITorrentStateIterator
 {
 public:
-    DelugeTorrentStateIterator(fs::path const& stateDir, ojson&& fastResume, ojson&& state,
+    DelugeTorrentStateIterator(fs::path const& stateDir, MappedFilePtr fastResumeFile, MappedFilePtr stateFile,
         IFileStreamProvider const& fileStreamProvider);
 
 public:
@@ -156,29 +234,30 @@ public:
     bool GetNext(Box& nextBox) override;
 
 private:
-    bool GetNext(fs::path& torrentFilePath, ojson& state, std::string& fastResumeData);
+    bool GetNext(fs::path& torrentFilePath, ojson& state, std::span<char const>& fastResumeData);
+    bool GetNextState(ojson& state, std::size_t& stateIndex);
 
 private:
     fs::path const m_stateDir;
-    ojson const m_fastResume;
-    ojson const m_state;
+    MappedFilePtr const m_fastResumeFile;
+    FastResumeIndex const m_fastResumeIndex;
+    MappedFilePtr const m_stateFile;
+    std::unique_ptr<IForwardIterator<ojson>> const m_stateReader;
     IFileStreamProvider const& m_fileStreamProvider;
-    ojson::const_array_iterator m_stateIt;
-    ojson::const_array_iterator const m_stateEnd;
-    std::mutex m_stateItMutex;
-    BencodeCodec const m_bencoder;
+    std::size_t m_stateIndex;
+    std::mutex m_stateReaderMutex;
 };
 
-DelugeTorrentStateIterator::DelugeTorrentStateIterator(fs::path const& stateDir, ojson&& fastResume, ojson&& state,
-    IFileStreamProvider const& fileStreamProvider) :
+DelugeTorrentStateIterator::DelugeTorrentStateIterator(fs::path const& stateDir, MappedFilePtr fastResumeFile,
+    MappedFilePtr stateFile, IFileStreamProvider const& fileStreamProvider) :
     m_stateDir(stateDir),
-    m_fastResume(std::move(fastResume)),
-    m_state(std::move(state)),
+    m_fastResumeFile(std::move(fastResumeFile)),
+    m_fastResumeIndex(IndexFastResume(m_fastResumeFile->GetData())),
+    m_stateFile(std::move(stateFile)),
+    m_stateReader(PickleCodec().DecodeList(m_stateFile->GetData(), Detail::StateField::Torrents)),
     m_fileStreamProvider(fileStreamProvider),
-    m_stateIt(m_state[Detail::StateField::Torrents].array_range().begin()),
-    m_stateEnd(m_state[Detail::StateField::Torrents].array_range().end()),
-    m_stateItMutex(),
-    m_bencoder()
+    m_stateIndex(0),
+    m_stateReaderMutex()
 {
     //
 }
@@ -190,23 +269,20 @@ bool DelugeTorrentStateIterator::GetNext(Box& nextBox)
 
     fs::path torrentFilePath;
     ojson state;
-    std::string fastResumeData;
+    std::span<char const> fastResumeData;
     if (!GetNext(torrentFilePath, state, fastResumeData))
     {
         return false;
     }
 
-    ojson fastResume;
-    {
-        std::istringstream stream(fastResumeData, std::ios_base::in | std::ios_base::binary);
-        m_bencoder.Decode(stream, fastResume);
-    }
+    BencodeDocument const fastResumeDocument(fastResumeData);
+    BencodeValue const fastResume = fastResumeDocument.GetRoot();
 
     Box box;
 
     {
         IReadStreamPtr const stream = m_fileStreamProvider.GetReadStream(torrentFilePath);
-        box.Torrent = TorrentInfo::Decode(*stream, m_bencoder);
+        box.Torrent = TorrentInfo::Decode(*stream);
 
         std::string const infoHash = state[STField::TorrentId].as<std::string>();
         if (!Util::IsEqualNoCase(box.Torrent.GetInfoHash(), infoHash, std::locale::classic()))
@@ -215,23 +291,23 @@ bool DelugeTorrentStateIterator::GetNext(Box& nextBox)
         }
     }
 
-    box.AddedAt = fastResume[FRField::AddedTime].as<std::time_t>();
-    box.CompletedAt = fastResume[FRField::CompletedTime].as<std::time_t>();
+    box.AddedAt = static_cast<std::time_t>(fastResume[FRField::AddedTime].AsInteger());
+    box.CompletedAt = static_cast<std::time_t>(fastResume[FRField::CompletedTime].AsInteger());
     box.IsPaused = state[STField::Paused].as<bool>();
-    box.DownloadedSize = fastResume[FRField::TotalDownloaded].as<std::uint64_t>();
-    box.UploadedSize = fastResume[FRField::TotalUploaded].as<std::uint64_t>();
+    box.DownloadedSize = static_cast<std::uint64_t>(fastResume[FRField::TotalDownloaded].AsInteger());
+    box.UploadedSize = static_cast<std::uint64_t>(fastResume[FRField::TotalUploaded].AsInteger());
     box.CorruptedSize = 0;
-    box.SavePath = Util::GetPath(state[STField::SavePath].as<std::string>()) / (fastResume.contains(FRField::MappedFiles) ?
-        *Util::GetPath(fastResume[FRField::MappedFiles][0].as<std::string>()).begin() : Util::GetPath(box.Torrent.GetName()));
+    box.SavePath = Util::GetPath(state[STField::SavePath].as<std::string>()) / (fastResume.Contains(FRField::MappedFiles) ?
+        *Util::GetPath(fastResume[FRField::MappedFiles][0].AsString()).begin() : Util::GetPath(box.Torrent.GetName()));
     box.BlockSize = box.Torrent.GetPieceSize();
     box.RatioLimit = FromStoreRatioLimit(state[STField::StopAtRatio], state[STField::StopRatio]);
     box.DownloadSpeedLimit = FromStoreSpeedLimit(state[STField::MaxDownloadSpeed]);
     box.UploadSpeedLimit = FromStoreSpeedLimit(state[STField::MaxUploadSpeed]);
 
     ojson const& filePriorities = state[STField::FilePriorities];
-    ojson const& mappedFiles = fastResume.at_or_null(FRField::MappedFiles);
+    BencodeValue const mappedFiles = fastResume.Find(FRField::MappedFiles);
     Logger(Logger::Debug) << "Got " << filePriorities.size() << " file priorities, " <<
-        (mappedFiles.is_null() ? 0 : mappedFiles.size()) << " mapped files";
+        (mappedFiles.IsNull() ? 0 : mappedFiles.GetSize()) << " mapped files";
 
     box.Files.reserve(filePriorities.size());
     for (std::size_t i = 0; i < filePriorities.size(); ++i)
@@ -251,7 +327,7 @@ bool DelugeTorrentStateIterator::GetNext(Box& nextBox)
     std::uint64_t const totalSize = box.Torrent.GetTotalSize();
     std::uint64_t const totalBlockCount = (totalSize + box.BlockSize - 1) / box.BlockSize;
     box.ValidBlocks.reserve(totalBlockCount);
-    for (bool const isPieceValid : fastResume[FRField::Pieces].as<std::string>())
+    for (bool const isPieceValid : fastResume[FRField::Pieces].AsString())
     {
         box.ValidBlocks.push_back(isPieceValid);
     }
@@ -271,21 +347,18 @@ bool DelugeTorrentStateIterator::GetNext(Box& nextBox)
     return true;
 }
 
-bool DelugeTorrentStateIterator::GetNext(fs::path& torrentFilePath, ojson& state, std::string& fastResumeData)
+bool DelugeTorrentStateIterator::GetNext(fs::path& torrentFilePath, ojson& state,
+    std::span<char const>& fastResumeData)
 {
     namespace STField = Detail::StateField::TorrentField;
 
-    std::lock_guard<std::mutex> lock(m_stateItMutex);
-
-    for (; m_stateIt != m_stateEnd; ++m_stateIt)
+    std::size_t stateIndex;
+    while (GetNextState(state, stateIndex))
     {
-        state = *m_stateIt;
-
         auto const torrentIdIt = state.find(STField::TorrentId);
         if (torrentIdIt == state.object_range().end())
         {
-            Logger(Logger::Warning) << "Torrent ID is missing from state entry #" <<
-                std::distance(m_state[Detail::StateField::Torrents].array_range().begin(), m_stateIt) << ", skipping";
+            Logger(Logger::Warning) << "Torrent ID is missing from state entry #" << stateIndex << ", skipping";
             continue;
         }
 
@@ -298,22 +371,37 @@ bool DelugeTorrentStateIterator::GetNext(fs::path& torrentFilePath, ojson& state
             continue;
         }
 
-        auto const resumeIt = m_fastResume.find(infoHash);
-        if (resumeIt == m_fastResume.object_range().end())
+        InfoHash binaryInfoHash;
+        auto const resumeIt = ParseInfoHash(infoHash, binaryInfoHash) ? m_fastResumeIndex.find(binaryInfoHash) :
+            m_fastResumeIndex.end();
+        if (resumeIt == m_fastResumeIndex.end())
         {
             Logger(Logger::Warning) << "Resume info for infohash " << infoHash << " is missing, skipping";
             continue;
         }
 
-        fastResumeData = resumeIt->value().as<std::string>();
+        fastResumeData = resumeIt->second;
 
-        ++m_stateIt;
         return true;
     }
 
     return false;
 }
 
+bool DelugeTorrentStateIterator::GetNextState(ojson& state, std::size_t& stateIndex)
+{
+    std::lock_guard<std::mutex> lock(m_stateReaderMutex);
+
+    // State entries are decoded on demand, so that first torrents get processed while the rest is still being read
+    if (!m_stateReader->GetNext(state))
+    {
+        return false;
+    }
+
+    stateIndex = m_stateIndex++;
+    return true;
+}
+
 } // namespace
 
 DelugeStateStore::DelugeStateStore() = default;
@@ -363,21 +451,16 @@ ITorrentStateIteratorPtr DelugeStateStore::Export(fs::path const& dataDir, IFile
 
     Logger(Logger::Debug) << "[Deluge] Loading " << Detail::FastResumeFilename;
 
-    ojson fastResume;
-    {
-        IReadStreamPtr const stream = fileStreamProvider.GetReadStream(stateDir / Detail::FastResumeFilename);
-        BencodeCodec().Decode(*stream, fastResume);
-    }
+    // Resume blobs are decoded in place, straight from the mapping, by whichever thread picks up the torrent
+    MappedFilePtr fastResumeFile = fileStreamProvider.GetMappedFile(stateDir / Detail::FastResumeFilename);
 
     Logger(Logger::Debug) << "[Deluge] Loading " << Detail::StateFilename;
 
-    ojson state;
-    {
-        IReadStreamPtr const stream = fileStreamProvider.GetReadStream(stateDir / Detail::StateFilename);
-        PickleCodec().Decode(*stream, state);
-    }
+    // Torrents are decoded from the mapping one at a time, as they are requested
+    MappedFilePtr stateFile = fileStreamProvider.GetMappedFile(stateDir / Detail::StateFilename);
 
-    return std::make_unique<DelugeTorrentStateIterator>(stateDir, std::move(fastResume), std::move(state), fileStreamProvider);
+    return std::make_unique<DelugeTorrentStateIterator>(stateDir, std::move(fastResumeFile), std::move(stateFile),
+        fileStreamProvider);
 }
 
 void DelugeStateStore::Import(fs::path const& /*dataDir*/, Box const& /*box*/,
@@ -1,5 +1,17 @@
 #include "ITorrentStateStore.h"
 
+namespace fs = std::filesystem;
+
 ITorrentStateStore::~ITorrentStateStore() = default;
 
+void ITorrentStateStore::BeginImport(fs::path const& /*dataDir*/, IFileStreamProvider& /*fileStreamProvider*/) const
+{
+    //
+}
+
+void ITorrentStateStore::FinishImport(fs::path const& /*dataDir*/, IFileStreamProvider& /*fileStreamProvider*/) const
+{
+    //
+}
+
 ImportCancelledException::~ImportCancelledException() = default;
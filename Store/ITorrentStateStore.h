@@ -46,6 +46,11 @@ public:
         IFileStreamProvider const& fileStreamProvider) const = 0;
     virtual void Import(std::filesystem::path const& dataDir, Box const& box,
         IFileStreamProvider& fileStreamProvider) const = 0;
+
+    // Called once before the first and after the last `Import` (even if interrupted), so that stores keeping some
+    // state in a single aggregate file could write it out once instead of for every torrent
+    virtual void BeginImport(std::filesystem::path const& dataDir, IFileStreamProvider& fileStreamProvider) const;
+    virtual void FinishImport(std::filesystem::path const& dataDir, IFileStreamProvider& fileStreamProvider) const;
 };
 
 class ImportCancelledException : public Exception
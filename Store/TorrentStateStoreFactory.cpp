@@ -25,10 +25,15 @@
 #include "Common/Exception.h"
 
 #include <filesystem>
+#include <string>
 
 namespace fs = std::filesystem;
 
-TorrentStateStoreFactory::TorrentStateStoreFactory() = default;
+TorrentStateStoreFactory::TorrentStateStoreFactory(std::string const& rTorrentScgiAddress) :
+    m_rTorrentScgiAddress(rTorrentScgiAddress)
+{
+    //
+}
 
 ITorrentStateStorePtr TorrentStateStoreFactory::CreateForClient(TorrentClient::Enum client) const
 {
@@ -37,7 +42,7 @@ ITorrentStateStorePtr TorrentStateStoreFactory::CreateForClient(TorrentClient::E
     case TorrentClient::Deluge:
         return std::make_unique<DelugeStateStore>();
     case TorrentClient::rTorrent:
-        return std::make_unique<rTorrentStateStore>();
+        return std::make_unique<rTorrentStateStore>(m_rTorrentScgiAddress);
     case TorrentClient::Transmission:
         return std::make_unique<TransmissionStateStore>(TransmissionStateType::Generic);
     case TorrentClient::TransmissionMac:
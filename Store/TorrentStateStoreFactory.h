@@ -21,6 +21,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <string>
 
 class ITorrentStateStore;
 typedef std::unique_ptr<ITorrentStateStore> ITorrentStateStorePtr;
@@ -28,8 +29,11 @@ typedef std::unique_ptr<ITorrentStateStore> ITorrentStateStorePtr;
 class TorrentStateStoreFactory
 {
 public:
-    TorrentStateStoreFactory();
+    explicit TorrentStateStoreFactory(std::string const& rTorrentScgiAddress);
 
     ITorrentStateStorePtr CreateForClient(TorrentClient::Enum client) const;
     ITorrentStateStorePtr GuessByDataDir(std::filesystem::path const& dataDir, Intention::Enum intention) const;
+
+private:
+    std::string const m_rTorrentScgiAddress;
 };
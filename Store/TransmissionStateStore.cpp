@@ -16,9 +16,11 @@
 
 #include "TransmissionStateStore.h"
 
+#include "Codec/BencodeDocument.h"
 #include "Common/Exception.h"
 #include "Common/IFileStreamProvider.h"
 #include "Common/IForwardIterator.h"
+#include "Common/Logger.h"
 #include "Common/Util.h"
 #include "Torrent/Box.h"
 #include "Torrent/BoxHelper.h"
@@ -26,15 +28,24 @@
 #include <fmt/format.h>
 #include <fmt/std.h>
 #include <jsoncons/json.hpp>
-#include <pugixml.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
-#include <tuple>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -52,6 +63,7 @@ std::string const Destination = "destination";
 std::string const Dnd = "dnd";
 std::string const DoneDate = "done-date";
 std::string const Downloaded = "downloaded";
+std::string const Files = "files";
 std::string const Name = "name";
 std::string const Paused = "paused";
 std::string const Priority = "priority";
@@ -66,6 +78,7 @@ namespace ProgressField
 
 std::string const Blocks = "blocks";
 std::string const Have = "have";
+std::string const Pieces = "pieces";
 std::string const TimeChecked = "time-checked";
 
 } // namespace ProgressField
@@ -81,6 +94,7 @@ std::string const RatioLimit = "ratio-limit";
 namespace SpeedLimitField
 {
 
+std::string const Speed = "speed";
 std::string const SpeedBps = "speed-Bps";
 std::string const UseGlobalSpeedLimit = "use-global-speed-limit";
 std::string const UseSpeedLimit = "use-speed-limit";
@@ -89,6 +103,18 @@ std::string const UseSpeedLimit = "use-speed-limit";
 
 } // namespace ResumeField
 
+namespace MacTransferField
+{
+
+std::string const Active = "Active";
+std::string const GroupValue = "GroupValue";
+std::string const InternalTorrentPath = "InternalTorrentPath";
+std::string const RemoveWhenFinishedSeeding = "RemoveWhenFinishedSeeding";
+std::string const TorrentHash = "TorrentHash";
+std::string const WaitToStart = "WaitToStart";
+
+} // namespace MacTransferField
+
 enum Priority
 {
     MinPriority = -1,
@@ -101,6 +127,13 @@ std::string const MacDataDirName = "Transmission";
 
 std::uint32_t const BlockSize = 16 * 1024;
 
+std::string const TorrentFileExtension = ".torrent";
+std::string const ResumeFileExtension = ".resume";
+
+// Special bitfield values
+std::string const AllBits = "all";
+std::string const NoneBits = "none";
+
 fs::path GetResumeDir(fs::path const& dataDir, TransmissionStateType stateType)
 {
     return dataDir / (stateType == TransmissionStateType::Mac ? "Resume" : "resume");
@@ -108,7 +141,7 @@ fs::path GetResumeDir(fs::path const& dataDir, TransmissionStateType stateType)
 
 fs::path GetResumeFilePath(fs::path const& dataDir, std::string const& basename, TransmissionStateType stateType)
 {
-    return GetResumeDir(dataDir, stateType) / (basename + ".resume");
+    return GetResumeDir(dataDir, stateType) / (basename + ResumeFileExtension);
 }
 
 fs::path GetTorrentsDir(fs::path const& dataDir, TransmissionStateType stateType)
@@ -118,7 +151,7 @@ fs::path GetTorrentsDir(fs::path const& dataDir, TransmissionStateType stateType
 
 fs::path GetTorrentFilePath(fs::path const& dataDir, std::string const& basename, TransmissionStateType stateType)
 {
-    return GetTorrentsDir(dataDir, stateType) / (basename + ".torrent");
+    return GetTorrentsDir(dataDir, stateType) / (basename + TorrentFileExtension);
 }
 
 fs::path GetMacTransfersFilePath(fs::path const& dataDir)
@@ -148,54 +181,217 @@ ojson ToStorePriority(std::vector<Box::FileInfo> const& files)
     return result;
 }
 
-ojson ToStoreProgress(std::vector<bool> const& validBlocks, std::uint32_t blockSize, std::uint64_t totalSize,
-    std::size_t fileCount)
+// Packs bits 64 to a word, first bit into the lowest one, so that they could be counted and scanned a word at a time
+std::vector<std::uint64_t> PackBits(std::vector<bool> const& bits)
 {
-    namespace RPField = Detail::ResumeField::ProgressField;
+    std::vector<std::uint64_t> result((bits.size() + 63) / 64, 0);
 
-    std::size_t const validBlockCount = std::count(validBlocks.begin(), validBlocks.end(), true);
+    auto bitIt = bits.begin();
+    for (std::size_t wordIndex = 0; wordIndex < result.size(); ++wordIndex)
+    {
+        std::size_t const bitCount = std::min<std::size_t>(64, bits.size() - wordIndex * 64);
 
-    ojson result = ojson::object();
-    if (validBlockCount == validBlocks.size())
+        std::uint64_t word = 0;
+        for (std::size_t i = 0; i < bitCount; ++i, ++bitIt)
+        {
+            word |= static_cast<std::uint64_t>(*bitIt) << i;
+        }
+
+        result[wordIndex] = word;
+    }
+
+    return result;
+}
+
+// Builds most-significant-bit-first bitfield out of runs of equal bits, with whole bytes of each run appended at once
+class BitfieldBuilder
+{
+public:
+    explicit BitfieldBuilder(std::uint64_t bitCount) :
+        m_result(),
+        m_pendingByte(0),
+        m_pendingBitCount(0)
     {
-        result[RPField::Blocks] = "all";
-        result[RPField::Have] = "all";
+        m_result.reserve((bitCount + 7) / 8);
     }
-    else if (validBlockCount == 0)
+
+    void AppendRun(bool isSet, std::uint64_t count)
     {
-        result[RPField::Blocks] = "none";
+        if (m_pendingBitCount != 0)
+        {
+            std::uint32_t const headCount = static_cast<std::uint32_t>(std::min<std::uint64_t>(count,
+                8 - m_pendingBitCount));
+            if (isSet)
+            {
+                m_pendingByte |= static_cast<std::uint8_t>((0xff >> m_pendingBitCount) &
+                    (0xff << (8 - m_pendingBitCount - headCount)));
+            }
+
+            m_pendingBitCount += headCount;
+            count -= headCount;
+
+            if (m_pendingBitCount == 8)
+            {
+                m_result += static_cast<char>(m_pendingByte);
+                m_pendingByte = 0;
+                m_pendingBitCount = 0;
+            }
+        }
+
+        if (count >= 8)
+        {
+            m_result.append(count / 8, static_cast<char>(isSet ? 0xff : 0x00));
+            count %= 8;
+        }
+
+        if (count != 0)
+        {
+            m_pendingByte = isSet ? static_cast<std::uint8_t>(0xff << (8 - count)) : 0;
+            m_pendingBitCount = static_cast<std::uint32_t>(count);
+        }
     }
-    else
+
+    std::string Finish()
     {
-        std::uint32_t const trBlocksPerBlock = blockSize / Detail::BlockSize;
+        if (m_pendingBitCount != 0)
+        {
+            m_result += static_cast<char>(m_pendingByte);
+        }
+
+        return std::move(m_result);
+    }
 
-        std::string trBlocks;
-        trBlocks.reserve((validBlocks.size() * trBlocksPerBlock + 7) / 8);
+private:
+    std::string m_result;
+    std::uint8_t m_pendingByte;
+    std::uint32_t m_pendingBitCount;
+};
+
+// With 1, 2 or 4 blocks per piece every output byte covers 8, 4 or 2 whole pieces, so it is looked up in one go
+std::string ExpandPiecesByTable(std::vector<std::uint64_t> const& pieces, std::size_t pieceCount,
+    std::uint32_t blocksPerPiece)
+{
+    using ExpansionTable = std::array<std::uint8_t, 256>;
 
-        std::uint8_t blockPack = 0;
-        std::int8_t blockPackShift = 7;
-        for (bool const isValidBlock : validBlocks)
+    static auto const MakeExpansionTable =
+        [](std::uint32_t blocksPerPiece)
         {
-            for (std::uint32_t i = 0; i < trBlocksPerBlock; ++i)
+            ExpansionTable result;
+            for (std::uint32_t pieces = 0; pieces < result.size(); ++pieces)
             {
-                blockPack |= (isValidBlock ? 1 : 0) << blockPackShift;
-                if (--blockPackShift < 0)
+                std::uint32_t blocks = 0;
+                for (std::uint32_t i = 0; i < 8 / blocksPerPiece; ++i)
                 {
-                    trBlocks += static_cast<char>(blockPack);
-                    blockPack = 0;
-                    blockPackShift = 7;
+                    if ((pieces & (1 << i)) != 0)
+                    {
+                        blocks |= ((1 << blocksPerPiece) - 1) << (8 - (i + 1) * blocksPerPiece);
+                    }
                 }
+                result[pieces] = static_cast<std::uint8_t>(blocks);
+            }
+            return result;
+        };
+
+    static std::array<ExpansionTable, 3> const ExpansionTables =
+        {
+            MakeExpansionTable(1),
+            MakeExpansionTable(2),
+            MakeExpansionTable(4)
+        };
+
+    ExpansionTable const& table = ExpansionTables[std::countr_zero(blocksPerPiece)];
+    std::uint32_t const piecesPerByte = 8 / blocksPerPiece;
+    std::uint64_t const piecesMask = (std::uint64_t{1} << piecesPerByte) - 1;
+    std::size_t const bytesPerWord = 64 / piecesPerByte;
+
+    // Bits past the last piece are clear, as are the blocks they expand to
+    std::string result((pieceCount + piecesPerByte - 1) / piecesPerByte, '\0');
+
+    for (std::size_t wordIndex = 0, byteIndex = 0; byteIndex < result.size(); ++wordIndex)
+    {
+        std::uint64_t word = pieces[wordIndex];
+        std::size_t const byteCount = std::min(bytesPerWord, result.size() - byteIndex);
+
+        if (word == std::numeric_limits<std::uint64_t>::max())
+        {
+            std::fill_n(result.begin() + byteIndex, byteCount, static_cast<char>(0xff));
+        }
+        else if (word != 0)
+        {
+            for (std::size_t i = 0; i < byteCount; ++i)
+            {
+                result[byteIndex + i] = static_cast<char>(table[word & piecesMask]);
+                word >>= piecesPerByte;
             }
         }
 
-        if (blockPackShift < 7)
+        byteIndex += byteCount;
+    }
+
+    return result;
+}
+
+// Other ratios go run by run, where runs are found a word at a time
+std::string ExpandPiecesByRuns(std::vector<std::uint64_t> const& pieces, std::size_t pieceCount,
+    std::uint32_t blocksPerPiece)
+{
+    BitfieldBuilder builder(static_cast<std::uint64_t>(pieceCount) * blocksPerPiece);
+
+    for (std::size_t wordIndex = 0; wordIndex < pieces.size(); ++wordIndex)
+    {
+        std::uint64_t word = pieces[wordIndex];
+        std::size_t const bitCount = std::min<std::size_t>(64, pieceCount - wordIndex * 64);
+
+        for (std::size_t i = 0; i < bitCount;)
         {
-            trBlocks += static_cast<char>(blockPack);
+            bool const isSet = (word & 1) != 0;
+            std::size_t const runLength = std::min<std::size_t>(isSet ? std::countr_one(word) : std::countr_zero(word),
+                bitCount - i);
+
+            builder.AppendRun(isSet, static_cast<std::uint64_t>(runLength) * blocksPerPiece);
+
+            word = runLength < 64 ? word >> runLength : 0;
+            i += runLength;
         }
+    }
+
+    return builder.Finish();
+}
+
+ojson ToStoreProgress(std::vector<bool> const& validBlocks, std::uint32_t blockSize, std::uint64_t totalSize,
+    std::size_t fileCount)
+{
+    namespace RPField = Detail::ResumeField::ProgressField;
+
+    std::vector<std::uint64_t> const validBlockWords = PackBits(validBlocks);
+
+    std::size_t validBlockCount = 0;
+    for (std::uint64_t const word : validBlockWords)
+    {
+        validBlockCount += std::popcount(word);
+    }
+
+    ojson result = ojson::object();
+    if (validBlockCount == validBlocks.size())
+    {
+        result[RPField::Blocks] = Detail::AllBits;
+        result[RPField::Have] = Detail::AllBits;
+    }
+    else if (validBlockCount == 0)
+    {
+        result[RPField::Blocks] = Detail::NoneBits;
+    }
+    else
+    {
+        std::uint32_t const trBlocksPerBlock = blockSize / Detail::BlockSize;
+
+        std::string trBlocks = std::has_single_bit(trBlocksPerBlock) && trBlocksPerBlock <= 4 ?
+            ExpandPiecesByTable(validBlockWords, validBlocks.size(), trBlocksPerBlock) :
+            ExpandPiecesByRuns(validBlockWords, validBlocks.size(), trBlocksPerBlock);
 
         trBlocks.resize(((totalSize + Detail::BlockSize - 1) / Detail::BlockSize + 7) / 8);
 
-        result[RPField::Blocks] = trBlocks;
+        result[RPField::Blocks] = std::move(trBlocks);
     }
 
     std::int64_t const timeChecked = std::time(nullptr);
@@ -230,42 +426,326 @@ ojson ToStoreSpeedLimit(Box::LimitInfo const& boxLimit)
     return result;
 }
 
-std::tuple<pugi::xml_document, pugi::xml_node> CreateMacPropertyList()
+struct TorrentFilePaths
+{
+    fs::path TorrentFilePath;
+    fs::path ResumeFilePath;
+};
+
+// Torrent and resume files share base name, whether it's "<hash>" (3.x and later) or "<name>.<hash16>" (2.9x), so
+// each directory is listed once and files are paired up by it
+std::vector<TorrentFilePaths> PairTorrentFiles(fs::path const& torrentsDir, fs::path const& resumeDir)
 {
-    pugi::xml_document doc;
+    std::unordered_map<std::string, fs::path> resumeFilePaths;
+    for (fs::directory_entry const& entry : fs::directory_iterator(resumeDir))
+    {
+        if (entry.path().extension() == Detail::ResumeFileExtension && entry.is_regular_file())
+        {
+            resumeFilePaths.emplace(entry.path().stem().string(), entry.path());
+        }
+    }
+
+    std::vector<TorrentFilePaths> result;
+    result.reserve(resumeFilePaths.size());
+
+    for (fs::directory_entry const& entry : fs::directory_iterator(torrentsDir))
+    {
+        if (entry.path().extension() != Detail::TorrentFileExtension || !entry.is_regular_file())
+        {
+            continue;
+        }
+
+        auto const resumeFilePathIt = resumeFilePaths.find(entry.path().stem().string());
+        if (resumeFilePathIt == resumeFilePaths.end())
+        {
+            Logger(Logger::Warning) << "Resume file for " << entry.path() << " is missing, skipping";
+            continue;
+        }
 
-    auto xmlDecl = doc.append_child(pugi::node_declaration);
-    xmlDecl.append_attribute("version") = "1.0";
-    xmlDecl.append_attribute("encoding") = "UTF-8";
+        result.push_back({entry.path(), std::move(resumeFilePathIt->second)});
+    }
 
-    auto docType = doc.append_child(pugi::node_doctype);
-    docType.set_value(R"(plist PUBLIC "-//Apple//DTD PLIST 1.0//EN" "http://www.apple.com/DTDs/PropertyList-1.0.dtd")");
+    // Directory listing order is arbitrary
+    std::sort(result.begin(), result.end(),
+        [](TorrentFilePaths const& lhs, TorrentFilePaths const& rhs) { return lhs.TorrentFilePath < rhs.TorrentFilePath; });
 
-    auto plist = doc.append_child("plist");
-    plist.append_attribute("version") = "1.0";
+    return result;
+}
 
-    return {std::move(doc), std::move(plist)};
+long long GetIntegerOr(BencodeValue const& dict, std::string_view key, long long defaultValue)
+{
+    BencodeValue const value = dict.IsDictionary() ? dict.Find(key) : BencodeValue();
+    return value.IsInteger() ? value.AsInteger() : defaultValue;
 }
 
-void ToMacStoreTransfer(Box const& box, fs::path const& torrentFilePath, pugi::xml_node& transfer)
+// Stored paths of multi-file torrents start with torrent directory name, which is already part of the save path;
+// single-file torrents store just the file name
+fs::path GetChangedFilePath(std::string_view storePath, fs::path const& originalPath, bool isMultiFile)
 {
-    transfer.append_child("key").text() = "Active";
-    transfer.append_child(box.IsPaused ? "false" : "true");
+    fs::path result;
+
+    if (!storePath.empty())
+    {
+        fs::path const path = Util::GetPath(storePath);
+        if (isMultiFile)
+        {
+            fs::path::iterator pathIt = path.begin();
+            while (++pathIt != path.end())
+            {
+                result /= *pathIt;
+            }
+        }
+        else
+        {
+            result = path;
+        }
+    }
 
-    transfer.append_child("key").text() = "GroupValue";
-    transfer.append_child("integer").text() = "-1";
+    return result == originalPath ? fs::path() : result;
+}
 
-    transfer.append_child("key").text() = "InternalTorrentPath";
-    transfer.append_child("string").text() = torrentFilePath.string().c_str();
+Box::LimitInfo FromStoreRatioLimit(BencodeValue const& storeLimit)
+{
+    namespace RRLField = Detail::ResumeField::RatioLimitField;
 
-    transfer.append_child("key").text() = "RemoveWhenFinishedSeeding";
-    transfer.append_child("false");
+    Box::LimitInfo result;
 
-    transfer.append_child("key").text() = "TorrentHash";
-    transfer.append_child("string").text() = box.Torrent.GetInfoHash().c_str();
+    long long const mode = GetIntegerOr(storeLimit, RRLField::RatioMode, 0);
+    result.Mode = mode == 0 ? Box::LimitMode::Inherit : (mode == 1 ? Box::LimitMode::Enabled : Box::LimitMode::Disabled);
 
-    transfer.append_child("key").text() = "WaitToStart";
-    transfer.append_child("false");
+    // Real numbers are stored as strings
+    BencodeValue const limit = storeLimit.IsDictionary() ? storeLimit.Find(RRLField::RatioLimit) : BencodeValue();
+    if (limit.IsString())
+    {
+        std::string_view const text = limit.AsString();
+        auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), result.Value);
+        if (error != std::errc() || end != text.data() + text.size())
+        {
+            Logger(Logger::Warning) << "Ratio limit \"" << text << "\" is malformed, using default";
+            return Box::LimitInfo();
+        }
+    }
+    else if (limit.IsInteger())
+    {
+        result.Value = static_cast<double>(limit.AsInteger());
+    }
+
+    return result;
+}
+
+Box::LimitInfo FromStoreSpeedLimit(BencodeValue const& storeLimit)
+{
+    namespace RSLField = Detail::ResumeField::SpeedLimitField;
+
+    Box::LimitInfo result;
+    result.Mode = GetIntegerOr(storeLimit, RSLField::UseSpeedLimit, 0) != 0 ? Box::LimitMode::Enabled :
+        (GetIntegerOr(storeLimit, RSLField::UseGlobalSpeedLimit, 1) != 0 ? Box::LimitMode::Inherit :
+        Box::LimitMode::Disabled);
+    // Versions before 2.50 stored the limit in KiB/s
+    result.Value = static_cast<double>(std::max(0LL, GetIntegerOr(storeLimit, RSLField::SpeedBps,
+        GetIntegerOr(storeLimit, RSLField::Speed, 0) * 1024)));
+    return result;
+}
+
+// Checks bits from `firstBit` to `lastBit` inclusive of most-significant-bit-first bitfield, whole bytes at once
+bool IsBitRangeSet(std::string_view bitfield, std::uint64_t firstBit, std::uint64_t lastBit)
+{
+    std::uint64_t const firstByte = firstBit / 8;
+    std::uint64_t const lastByte = lastBit / 8;
+    if (lastByte >= bitfield.size())
+    {
+        return false;
+    }
+
+    std::uint8_t const firstMask = 0xff >> (firstBit % 8);
+    std::uint8_t const lastMask = static_cast<std::uint8_t>(0xff << (7 - lastBit % 8));
+
+    auto const isMaskSet =
+        [&bitfield](std::uint64_t byte, std::uint8_t mask)
+        {
+            return (static_cast<std::uint8_t>(bitfield[byte]) & mask) == mask;
+        };
+
+    if (firstByte == lastByte)
+    {
+        return isMaskSet(firstByte, firstMask & lastMask);
+    }
+
+    return isMaskSet(firstByte, firstMask) && isMaskSet(lastByte, lastMask) &&
+        std::all_of(bitfield.begin() + firstByte + 1, bitfield.begin() + lastByte,
+            [](char c) { return static_cast<std::uint8_t>(c) == 0xff; });
+}
+
+// Piece is only valid if all of the blocks it overlaps with are; newer versions also store piece bitfield itself
+std::vector<bool> FromStoreProgress(BencodeValue const& progress, std::uint64_t totalSize, std::uint32_t pieceSize)
+{
+    namespace RPField = Detail::ResumeField::ProgressField;
+
+    std::uint64_t const pieceCount = (totalSize + pieceSize - 1) / pieceSize;
+
+    BencodeValue const pieces = progress.IsDictionary() ? progress.Find(RPField::Pieces) : BencodeValue();
+    BencodeValue const have = progress.IsDictionary() ? progress.Find(RPField::Have) : BencodeValue();
+    BencodeValue const blocks = progress.IsDictionary() ? progress.Find(RPField::Blocks) : BencodeValue();
+
+    BencodeValue const& bitfield = pieces.IsString() ? pieces : (have.IsString() ? have : blocks);
+    bool const isPieceBitfield = pieces.IsString() || have.IsString();
+
+    std::string_view const bits = bitfield.IsString() ? bitfield.AsString() : Detail::NoneBits;
+    if (bits == Detail::AllBits || bits == Detail::NoneBits)
+    {
+        return std::vector<bool>(pieceCount, bits == Detail::AllBits);
+    }
+
+    std::vector<bool> result;
+    result.reserve(pieceCount);
+
+    for (std::uint64_t i = 0; i < pieceCount; ++i)
+    {
+        if (isPieceBitfield)
+        {
+            result.push_back(IsBitRangeSet(bits, i, i));
+        }
+        else
+        {
+            std::uint64_t const pieceEnd = std::min<std::uint64_t>((i + 1) * pieceSize, totalSize);
+            result.push_back(IsBitRangeSet(bits, i * pieceSize / Detail::BlockSize,
+                (pieceEnd - 1) / Detail::BlockSize));
+        }
+    }
+
+    return result;
+}
+
+// Torrents are paired with their resume files up front, so that threads only need to agree on the next index
+class TransmissionTorrentStateIterator : public ITorrentStateIterator
+{
+public:
+    TransmissionTorrentStateIterator(std::vector<TorrentFilePaths>&& torrents,
+        IFileStreamProvider const& fileStreamProvider);
+
+public:
+    // ITorrentStateIterator
+    bool GetNext(Box& nextBox) override;
+
+private:
+    void LoadBox(TorrentFilePaths const& paths, Box& box) const;
+
+private:
+    std::vector<TorrentFilePaths> const m_torrents;
+    IFileStreamProvider const& m_fileStreamProvider;
+    std::atomic<std::size_t> m_torrentIndex;
+};
+
+TransmissionTorrentStateIterator::TransmissionTorrentStateIterator(std::vector<TorrentFilePaths>&& torrents,
+    IFileStreamProvider const& fileStreamProvider) :
+    m_torrents(std::move(torrents)),
+    m_fileStreamProvider(fileStreamProvider),
+    m_torrentIndex(0)
+{
+    //
+}
+
+bool TransmissionTorrentStateIterator::GetNext(Box& nextBox)
+{
+    while (true)
+    {
+        std::size_t const torrentIndex = m_torrentIndex++;
+        if (torrentIndex >= m_torrents.size())
+        {
+            return false;
+        }
+
+        TorrentFilePaths const& paths = m_torrents[torrentIndex];
+
+        try
+        {
+            Box box;
+            LoadBox(paths, box);
+            nextBox = std::move(box);
+            return true;
+        }
+        catch (Exception const& e)
+        {
+            Logger(Logger::Warning) << "Unable to load torrent " << paths.TorrentFilePath << " (" << e.what() <<
+                "), skipping";
+        }
+    }
+}
+
+void TransmissionTorrentStateIterator::LoadBox(TorrentFilePaths const& paths, Box& box) const
+{
+    namespace RField = Detail::ResumeField;
+
+    std::unique_ptr<BencodeDocument const> resumeDocument;
+    {
+        IReadStreamPtr const stream = m_fileStreamProvider.GetReadStream(paths.ResumeFilePath);
+        resumeDocument = std::make_unique<BencodeDocument const>(Util::ReadStream(*stream));
+    }
+
+    BencodeValue const resume = resumeDocument->GetRoot();
+
+    {
+        IReadStreamPtr const stream = m_fileStreamProvider.GetReadStream(paths.TorrentFilePath);
+        box.Torrent = TorrentInfo::Decode(*stream);
+    }
+
+    BencodeValue const name = resume.Find(RField::Name);
+
+    box.AddedAt = static_cast<std::time_t>(GetIntegerOr(resume, RField::AddedDate, 0));
+    box.CompletedAt = static_cast<std::time_t>(GetIntegerOr(resume, RField::DoneDate, 0));
+    box.IsPaused = GetIntegerOr(resume, RField::Paused, 0) != 0;
+    box.DownloadedSize = static_cast<std::uint64_t>(GetIntegerOr(resume, RField::Downloaded, 0));
+    box.UploadedSize = static_cast<std::uint64_t>(GetIntegerOr(resume, RField::Uploaded, 0));
+    box.CorruptedSize = static_cast<std::uint64_t>(GetIntegerOr(resume, RField::Corrupt, 0));
+    box.SavePath = Util::GetPath(resume[RField::Destination].AsString()) /
+        (name.IsString() ? Util::GetPath(name.AsString()) : Util::GetPath(box.Torrent.GetName()));
+    box.BlockSize = box.Torrent.GetPieceSize();
+    box.RatioLimit = FromStoreRatioLimit(resume.Find(RField::RatioLimit));
+    box.DownloadSpeedLimit = FromStoreSpeedLimit(resume.Find(RField::SpeedLimitDown));
+    box.UploadSpeedLimit = FromStoreSpeedLimit(resume.Find(RField::SpeedLimitUp));
+
+    BencodeValue const doNotDownload = resume.Find(RField::Dnd);
+    std::size_t const doNotDownloadCount = doNotDownload.IsList() ? doNotDownload.GetSize() : 0;
+    BencodeValue const priorities = resume.Find(RField::Priority);
+    std::size_t const priorityCount = priorities.IsList() ? priorities.GetSize() : 0;
+    BencodeValue const filePaths = resume.Find(RField::Files);
+    std::size_t const filePathCount = filePaths.IsList() ? filePaths.GetSize() : 0;
+
+    // Any of the per-file lists may be missing or shorter, torrent is what tells the actual number of files
+    box.Files.resize(box.Torrent.GetFileCount());
+    for (std::size_t i = 0; i < box.Files.size(); ++i)
+    {
+        Box::FileInfo& file = box.Files[i];
+        file.DoNotDownload = i < doNotDownloadCount && doNotDownload[i].AsInteger() != 0;
+        file.Priority = i < priorityCount ? BoxHelper::Priority::FromStore(
+            static_cast<int>(priorities[i].AsInteger()), Detail::MinPriority, Detail::MaxPriority) : Box::NormalPriority;
+
+        if (i < filePathCount && filePaths[i].IsString())
+        {
+            file.Path = GetChangedFilePath(filePaths[i].AsString(), box.Torrent.GetFilePath(i),
+                box.Torrent.IsMultiFile());
+        }
+    }
+
+    box.ValidBlocks = FromStoreProgress(resume.Find(RField::Progress), box.Torrent.GetTotalSize(), box.BlockSize);
+    box.Trackers = box.Torrent.GetTrackers();
+}
+
+// Identifies import in progress across all store instances, for threads to tell their transfer buffers apart
+std::atomic<std::uint64_t> LastImportId(0);
+
+ojson ToMacStoreTransfer(Box const& box, fs::path const& torrentFilePath)
+{
+    namespace MTField = Detail::MacTransferField;
+
+    ojson result = ojson::object();
+    result[MTField::Active] = !box.IsPaused;
+    result[MTField::GroupValue] = -1;
+    result[MTField::InternalTorrentPath] = torrentFilePath.string();
+    result[MTField::RemoveWhenFinishedSeeding] = false;
+    result[MTField::TorrentHash] = box.Torrent.GetInfoHash();
+    result[MTField::WaitToStart] = false;
+    return result;
 }
 
 } // namespace
@@ -273,7 +753,10 @@ void ToMacStoreTransfer(Box const& box, fs::path const& torrentFilePath, pugi::x
 TransmissionStateStore::TransmissionStateStore(TransmissionStateType stateType) :
     m_stateType(stateType),
     m_bencoder(),
-    m_tranfersPlistMutex()
+    m_plistCodec(),
+    m_importId(0),
+    m_transfersBuffers(),
+    m_transfersBuffersMutex()
 {
     //
 }
@@ -339,10 +822,15 @@ bool TransmissionStateStore::IsValidDataDir(fs::path const& dataDir, Intention::
         fs::is_directory(Detail::GetTorrentsDir(dataDir, m_stateType));
 }
 
-ITorrentStateIteratorPtr TransmissionStateStore::Export(fs::path const& /*dataDir*/,
-    IFileStreamProvider const& /*fileStreamProvider*/) const
+ITorrentStateIteratorPtr TransmissionStateStore::Export(fs::path const& dataDir,
+    IFileStreamProvider const& fileStreamProvider) const
 {
-    throw NotImplementedException(__func__);
+    Logger(Logger::Debug) << "[Transmission] Pairing torrent and resume files";
+
+    std::vector<TorrentFilePaths> torrents = PairTorrentFiles(Detail::GetTorrentsDir(dataDir, m_stateType),
+        Detail::GetResumeDir(dataDir, m_stateType));
+
+    return std::make_unique<TransmissionTorrentStateIterator>(std::move(torrents), fileStreamProvider);
 }
 
 void TransmissionStateStore::Import(fs::path const& dataDir, Box const& box, IFileStreamProvider& fileStreamProvider) const
@@ -403,48 +891,93 @@ void TransmissionStateStore::Import(fs::path const& dataDir, Box const& box, IFi
     fs::path const resumeFilePath = Detail::GetResumeFilePath(dataDir, baseName, m_stateType);
     fs::create_directories(resumeFilePath.parent_path());
 
+    {
+        IWriteStreamPtr const stream = fileStreamProvider.GetWriteStream(torrentFilePath);
+        torrent.Encode(*stream);
+    }
+
+    {
+        IWriteStreamPtr const stream = fileStreamProvider.GetWriteStream(resumeFilePath);
+        m_bencoder.Encode(*stream, resume);
+    }
+
     if (m_stateType == TransmissionStateType::Mac)
     {
-        fs::path const transfersPlistPath = Detail::GetMacTransfersFilePath(dataDir);
+        GetTransfersBuffer().push_back(ToMacStoreTransfer(box, torrentFilePath));
+    }
+}
+
+void TransmissionStateStore::BeginImport(fs::path const& /*dataDir*/, IFileStreamProvider& /*fileStreamProvider*/) const
+{
+    m_importId = ++LastImportId;
+    m_transfersBuffers.clear();
+}
 
-        pugi::xml_document plistDoc;
-        pugi::xml_node plistNode;
-        pugi::xml_node arrayNode;
+void TransmissionStateStore::FinishImport(fs::path const& dataDir, IFileStreamProvider& fileStreamProvider) const
+{
+    std::deque<std::vector<ojson>> transfersBuffers;
+    std::swap(transfersBuffers, m_transfersBuffers);
+    m_importId = 0;
+
+    if (m_stateType != TransmissionStateType::Mac)
+    {
+        return;
+    }
 
-        // Avoid concurrent access to Transfers.plist, could lead to file corruption
-        std::lock_guard<std::mutex> lock(m_tranfersPlistMutex);
+    fs::path const transfersPlistPath = Detail::GetMacTransfersFilePath(dataDir);
 
+    ojson transfers = ojson::array();
+
+    // Only a missing file is treated as empty, anything else would end up wiping the existing transfer list
+    if (fs::exists(transfersPlistPath))
+    {
         try
         {
             IReadStreamPtr const readStream = fileStreamProvider.GetReadStream(transfersPlistPath);
-            plistDoc.load(*readStream, pugi::parse_default | pugi::parse_declaration | pugi::parse_doctype);
-            plistNode = plistDoc.child("plist");
-            arrayNode = plistNode.child("array");
+            m_plistCodec.Decode(*readStream, transfers);
         }
-        catch (Exception const&)
+        catch (Exception const& e)
         {
+            throw Exception(fmt::format("Unable to read transfers list {}: {}", transfersPlistPath, e.what()));
         }
 
-        if (arrayNode.empty())
+        if (!transfers.is_array())
         {
-            std::tie(plistDoc, plistNode) = CreateMacPropertyList();
-            arrayNode = plistNode.append_child("array");
+            throw Exception(fmt::format("Transfers list {} is not an array", transfersPlistPath));
         }
+    }
 
-        pugi::xml_node dictNode = arrayNode.append_child("dict");
-        ToMacStoreTransfer(box, torrentFilePath, dictNode);
-
-        IWriteStreamPtr const writeStream = fileStreamProvider.GetWriteStream(transfersPlistPath);
-        plistDoc.save(*writeStream);
+    for (std::vector<ojson>& transfersBuffer : transfersBuffers)
+    {
+        for (ojson& transfer : transfersBuffer)
+        {
+            transfers.push_back(std::move(transfer));
+        }
     }
 
+    // Existing file may be in either format, but is always written back in binary one which is faster to process
+    IWriteStreamPtr const writeStream = fileStreamProvider.GetWriteStream(transfersPlistPath);
+    m_plistCodec.Encode(*writeStream, transfers);
+}
+
+std::vector<ojson>& TransmissionStateStore::GetTransfersBuffer() const
+{
+    // Buffer is only looked up under the lock the first time a thread imports something, after that the thread
+    // appends to it on its own
+    thread_local std::uint64_t threadImportId = 0;
+    thread_local std::vector<ojson>* threadTransfersBuffer = nullptr;
+
+    if (m_importId == 0)
     {
-        IWriteStreamPtr const stream = fileStreamProvider.GetWriteStream(torrentFilePath);
-        torrent.Encode(*stream, m_bencoder);
+        throw Exception("Transfers list can only be updated between beginning and finishing the import");
     }
 
+    if (threadImportId != m_importId)
     {
-        IWriteStreamPtr const stream = fileStreamProvider.GetWriteStream(resumeFilePath);
-        m_bencoder.Encode(*stream, resume);
+        std::lock_guard<std::mutex> lock(m_transfersBuffersMutex);
+        threadTransfersBuffer = &m_transfersBuffers.emplace_back();
+        threadImportId = m_importId;
     }
+
+    return *threadTransfersBuffer;
 }
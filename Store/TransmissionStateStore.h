@@ -19,8 +19,12 @@
 #include "ITorrentStateStore.h"
 
 #include "Codec/BencodeCodec.h"
+#include "Codec/BinaryPlistCodec.h"
 
+#include <cstdint>
+#include <deque>
 #include <mutex>
+#include <vector>
 
 enum class TransmissionStateType
 {
@@ -45,8 +49,17 @@ public:
         IFileStreamProvider const& fileStreamProvider) const override;
     void Import(std::filesystem::path const& dataDir, Box const& box, IFileStreamProvider& fileStreamProvider) const override;
 
+    void BeginImport(std::filesystem::path const& dataDir, IFileStreamProvider& fileStreamProvider) const override;
+    void FinishImport(std::filesystem::path const& dataDir, IFileStreamProvider& fileStreamProvider) const override;
+
+private:
+    std::vector<ojson>& GetTransfersBuffer() const;
+
 private:
     TransmissionStateType const m_stateType;
     BencodeCodec const m_bencoder;
-    std::mutex mutable m_tranfersPlistMutex;
+    BinaryPlistCodec const m_plistCodec;
+    std::uint64_t mutable m_importId;
+    std::deque<std::vector<ojson>> mutable m_transfersBuffers;
+    std::mutex mutable m_transfersBuffersMutex;
 };
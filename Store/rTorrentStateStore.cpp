@@ -17,23 +17,38 @@
 #include "rTorrentStateStore.h"
 
 #include "Codec/BencodeCodec.h"
+#include "Codec/BencodeDocument.h"
+#include "Codec/IBencodeVisitor.h"
+#include "Codec/XmlRpcCodec.h"
 #include "Common/Exception.h"
 #include "Common/IFileStreamProvider.h"
 #include "Common/IForwardIterator.h"
 #include "Common/Logger.h"
+#include "Common/ScgiClient.h"
 #include "Common/Util.h"
 #include "Torrent/Box.h"
 #include "Torrent/BoxHelper.h"
 
 #include <fmt/format.h>
-#include <jsoncons/json.hpp>
-
+#include <fmt/std.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
 #include <locale>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -54,6 +69,7 @@ std::string const Trackers = "trackers";
 namespace FileField
 {
 
+std::string const Mtime = "mtime";
 std::string const Priority = "priority";
 
 } // namespace FileField
@@ -70,14 +86,28 @@ std::string const Enabled = "enabled";
 namespace StateField
 {
 
+std::string const ChunksDone = "chunks_done";
+std::string const Complete = "complete";
 std::string const Directory = "directory";
 std::string const Priority = "priority";
+std::string const State = "state";
+std::string const StateChanged = "state_changed";
 std::string const TimestampFinished = "timestamp.finished";
 std::string const TimestampStarted = "timestamp.started";
 std::string const TotalUploaded = "total_uploaded";
 
 } // namespace StateField
 
+struct State
+{
+    std::optional<std::string> Directory;
+    std::optional<long long> Priority;
+    std::optional<long long> State;
+    std::optional<long long> TimestampFinished;
+    std::optional<long long> TimestampStarted;
+    std::optional<long long> TotalUploaded;
+};
+
 enum Priority
 {
     DoNotDownloadPriority = 0,
@@ -85,44 +115,339 @@ enum Priority
     MaxPriority = 1
 };
 
+enum DownloadState
+{
+    StoppedState = 0,
+    StartedState = 1
+};
+
+int const NormalDownloadPriority = 2;
+
 std::string const ConfigFilename = ".rtorrent.rc";
+std::string const TorrentFileExtension = ".torrent";
 std::string const StateFileExtension = ".rtorrent";
 std::string const LibTorrentStateFileExtension = ".libtorrent_resume";
 
+std::string const DhtTrackerUrl = "dht://";
+
+namespace RpcMethod
+{
+
+std::string const DownloadMulticall = "d.multicall2";
+std::string const FileMulticall = "f.multicall";
+std::string const TrackerMulticall = "t.multicall";
+std::string const SystemMulticall = "system.multicall";
+
+} // namespace RpcMethod
+
+std::string const RpcMainView = "main";
+
+enum DownloadColumn
+{
+    HashColumn,
+    SessionFileColumn,
+    DirectoryColumn,
+    PriorityColumn,
+    StateColumn,
+    TimestampStartedColumn,
+    TimestampFinishedColumn,
+    TotalUploadedColumn,
+    BitfieldColumn,
+    CompleteColumn,
+    CompletedChunksColumn,
+    DownloadColumnCount
+};
+
+std::array<std::string, DownloadColumnCount> const DownloadCommands =
+{
+    "d.hash=",
+    "d.session_file=",
+    "d.directory=",
+    "d.priority=",
+    "d.state=",
+    "d.timestamp.started=",
+    "d.timestamp.finished=",
+    "d.up.total=",
+    "d.bitfield=",
+    "d.complete=",
+    "d.completed_chunks="
+};
+
+std::string const FilePriorityCommand = "f.priority=";
+std::string const TrackerUrlCommand = "t.url=";
+std::string const TrackerIsEnabledCommand = "t.is_enabled=";
+
+// Files and trackers of this many torrents are fetched per system.multicall round trip
+std::size_t const RpcBatchSize = 1000;
+
+// Large sessions take rTorrent a while to put d.multicall2 response together, but it shouldn't take minutes
+std::chrono::milliseconds const RpcTimeout = std::chrono::seconds(60);
+
 } // namespace Detail
 } // namespace
 
+struct rTorrentSession
+{
+    struct TorrentFilePaths
+    {
+        fs::path StateFilePath;
+        fs::path TorrentFilePath;
+        fs::path LibTorrentStateFilePath;
+    };
+
+    fs::path DataDir;
+    std::vector<TorrentFilePaths> Torrents;
+    std::vector<fs::path> SkippedFilePaths;
+};
+
 namespace
 {
 
+template<typename T>
+T const& GetStateField(std::optional<T> const& value, std::string const& name)
+{
+    if (!value.has_value())
+    {
+        throw Exception(fmt::format("State field \"{}\" is missing", name));
+    }
+
+    return *value;
+}
+
+TorrentInfo LoadTorrent(IFileStreamProvider const& fileStreamProvider, fs::path const& torrentFilePath,
+    std::string_view infoHash)
+{
+    IReadStreamPtr const stream = fileStreamProvider.GetReadStream(torrentFilePath);
+    TorrentInfo result = TorrentInfo::Decode(*stream);
+
+    if (!Util::IsEqualNoCase(result.GetInfoHash(), infoHash, std::locale::classic()))
+    {
+        throw Exception(fmt::format("Info hashes don't match: {} vs. {}", result.GetInfoHash(), infoHash));
+    }
+
+    return result;
+}
+
+void FromStoreState(Detail::State const& state, Box& box)
+{
+    namespace SField = Detail::StateField;
+
+    box.AddedAt = static_cast<std::time_t>(GetStateField(state.TimestampStarted, SField::TimestampStarted));
+    box.CompletedAt = static_cast<std::time_t>(GetStateField(state.TimestampFinished, SField::TimestampFinished));
+    // Stopped torrents keep their priority (which is what import writes), while "off" priority stops transfers as well
+    box.IsPaused = GetStateField(state.Priority, SField::Priority) == 0 ||
+        (state.State.has_value() && *state.State == Detail::StoppedState);
+    box.UploadedSize = static_cast<std::uint64_t>(GetStateField(state.TotalUploaded, SField::TotalUploaded));
+    box.SavePath = Util::GetPath(GetStateField(state.Directory, SField::Directory));
+    box.BlockSize = box.Torrent.GetPieceSize();
+}
+
+Box::FileInfo FromStoreFilePriority(int filePriority)
+{
+    Box::FileInfo result;
+    result.DoNotDownload = filePriority == Detail::DoNotDownloadPriority;
+    result.Priority = result.DoNotDownload ? Box::NormalPriority : BoxHelper::Priority::FromStore(filePriority - 1,
+        Detail::MinPriority, Detail::MaxPriority);
+    return result;
+}
+
+void FromStoreBitfield(std::string_view bitfield, Box& box)
+{
+    std::uint64_t const totalSize = box.Torrent.GetTotalSize();
+    std::uint64_t const totalBlockCount = (totalSize + box.BlockSize - 1) / box.BlockSize;
+    box.ValidBlocks.reserve(totalBlockCount + 8);
+    for (unsigned char const c : bitfield)
+    {
+        for (int i = 7; i >= 0; --i)
+        {
+            bool const isPieceValid = (c & (1 << i)) != 0;
+            box.ValidBlocks.push_back(isPieceValid);
+        }
+    }
+
+    box.ValidBlocks.resize(totalBlockCount);
+}
+
+int ToStoreFilePriority(Box::FileInfo const& file)
+{
+    if (file.DoNotDownload)
+    {
+        return Detail::DoNotDownloadPriority;
+    }
+
+    // There is no low priority, and the lowest one on the scale would mean "don't download"
+    return std::max(BoxHelper::Priority::ToStore(file.Priority, Detail::MinPriority, Detail::MaxPriority), 0) + 1;
+}
+
+// Pieces are packed MSB-first, piece being valid only if all the blocks it spans are
+std::string ToStoreBitfield(Box const& box, std::uint64_t pieceCount, std::uint64_t& validPieceCount)
+{
+    std::uint64_t const totalSize = box.Torrent.GetTotalSize();
+    std::uint64_t const pieceSize = box.Torrent.GetPieceSize();
+
+    std::string result((pieceCount + 7) / 8, '\0');
+    validPieceCount = 0;
+
+    for (std::uint64_t piece = 0; piece < pieceCount; ++piece)
+    {
+        std::uint64_t const firstBlock = piece * pieceSize / box.BlockSize;
+        std::uint64_t const lastBlock = (std::min((piece + 1) * pieceSize, totalSize) - 1) / box.BlockSize;
+        if (lastBlock >= box.ValidBlocks.size() || std::find(box.ValidBlocks.begin() + firstBlock,
+            box.ValidBlocks.begin() + lastBlock + 1, false) != box.ValidBlocks.begin() + lastBlock + 1)
+        {
+            continue;
+        }
+
+        result[piece / 8] = static_cast<char>(result[piece / 8] | (0x80 >> (piece % 8)));
+        ++validPieceCount;
+    }
+
+    return result;
+}
+
+// libtorrent rechecks files whose modification time differs from the one stored in resume data
+std::optional<std::int64_t> GetFileModificationTime(fs::path const& path)
+{
+    std::error_code error;
+    fs::file_time_type const fileTime = fs::last_write_time(path, error);
+    if (error)
+    {
+        return std::nullopt;
+    }
+
+#ifdef _MSC_VER
+    auto const systemTime = std::chrono::clock_cast<std::chrono::system_clock>(fileTime);
+#else
+    auto const systemTime = std::chrono::file_clock::to_sys(fileTime);
+#endif
+
+    return std::chrono::floor<std::chrono::seconds>(systemTime).time_since_epoch().count();
+}
+
+// State files hold a few dozen fields of which only a handful is needed, pick those without decoding the rest
+class StateVisitor : public IBencodeVisitor
+{
+public:
+    explicit StateVisitor(Detail::State& state);
+
+public:
+    // IBencodeVisitor
+    void BeginDictionary() override;
+    bool Key(std::string_view key) override;
+    void BeginList() override;
+    void End() override;
+    void Integer(long long value) override;
+    void String(std::string_view value) override;
+
+private:
+    Detail::State& m_state;
+    std::size_t m_depth;
+    std::optional<long long>* m_integerField;
+    std::optional<std::string>* m_stringField;
+};
+
+StateVisitor::StateVisitor(Detail::State& state) :
+    m_state(state),
+    m_depth(0),
+    m_integerField(nullptr),
+    m_stringField(nullptr)
+{
+    //
+}
+
+void StateVisitor::BeginDictionary()
+{
+    ++m_depth;
+}
+
+bool StateVisitor::Key(std::string_view key)
+{
+    namespace SField = Detail::StateField;
+
+    m_integerField = nullptr;
+    m_stringField = nullptr;
+
+    if (m_depth != 1)
+    {
+        return false;
+    }
+
+    if (key == SField::Directory)
+    {
+        m_stringField = &m_state.Directory;
+    }
+    else if (key == SField::Priority)
+    {
+        m_integerField = &m_state.Priority;
+    }
+    else if (key == SField::State)
+    {
+        m_integerField = &m_state.State;
+    }
+    else if (key == SField::TimestampFinished)
+    {
+        m_integerField = &m_state.TimestampFinished;
+    }
+    else if (key == SField::TimestampStarted)
+    {
+        m_integerField = &m_state.TimestampStarted;
+    }
+    else if (key == SField::TotalUploaded)
+    {
+        m_integerField = &m_state.TotalUploaded;
+    }
+
+    return m_integerField != nullptr || m_stringField != nullptr;
+}
+
+void StateVisitor::BeginList()
+{
+    ++m_depth;
+}
+
+void StateVisitor::End()
+{
+    --m_depth;
+}
+
+void StateVisitor::Integer(long long value)
+{
+    if (m_depth == 1 && m_integerField != nullptr)
+    {
+        *m_integerField = value;
+    }
+}
+
+void StateVisitor::String(std::string_view value)
+{
+    if (m_depth == 1 && m_stringField != nullptr)
+    {
+        *m_stringField = value;
+    }
+}
+
 class rTorrentTorrentStateIterator : public ITorrentStateIterator
 {
 public:
-    rTorrentTorrentStateIterator(fs::path const& dataDir, IFileStreamProvider const& fileStreamProvider);
+    rTorrentTorrentStateIterator(std::shared_ptr<rTorrentSession const> session,
+        IFileStreamProvider const& fileStreamProvider);
 
 public:
     // ITorrentStateIterator
     bool GetNext(Box& nextBox) override;
 
 private:
-    bool GetNext(fs::path& stateFilePath, fs::path& torrentFilePath, fs::path& libTorrentStateFilePath);
-
-private:
-    fs::path const m_dataDir;
+    std::shared_ptr<rTorrentSession const> const m_session;
     IFileStreamProvider const& m_fileStreamProvider;
-    fs::directory_iterator m_directoryIt;
-    fs::directory_iterator const m_directoryEnd;
-    std::mutex m_directoryItMutex;
+    std::atomic<std::size_t> m_torrentIndex;
     BencodeCodec const m_bencoder;
 };
 
-
-rTorrentTorrentStateIterator::rTorrentTorrentStateIterator(fs::path const& dataDir, IFileStreamProvider const& fileStreamProvider) :
-    m_dataDir(dataDir),
+rTorrentTorrentStateIterator::rTorrentTorrentStateIterator(std::shared_ptr<rTorrentSession const> session,
+    IFileStreamProvider const& fileStreamProvider) :
+    m_session(std::move(session)),
     m_fileStreamProvider(fileStreamProvider),
-    m_directoryIt(m_dataDir),
-    m_directoryEnd(),
-    m_directoryItMutex(),
+    m_torrentIndex(0),
     m_bencoder()
 {
     //
@@ -131,142 +456,442 @@ rTorrentTorrentStateIterator::rTorrentTorrentStateIterator(fs::path const& dataD
 bool rTorrentTorrentStateIterator::GetNext(Box& nextBox)
 {
     namespace RField = Detail::ResumeField;
-    namespace SField = Detail::StateField;
 
-    fs::path stateFilePath;
-    fs::path torrentFilePath;
-    fs::path libTorrentStateFilePath;
-    if (!GetNext(stateFilePath, torrentFilePath, libTorrentStateFilePath))
+    std::size_t const torrentIndex = m_torrentIndex++;
+    if (torrentIndex >= m_session->Torrents.size())
     {
         return false;
     }
 
+    rTorrentSession::TorrentFilePaths const& paths = m_session->Torrents[torrentIndex];
+
     Box box;
+    box.Torrent = LoadTorrent(m_fileStreamProvider, paths.TorrentFilePath, paths.TorrentFilePath.stem().string());
 
+    Detail::State state;
     {
-        IReadStreamPtr const stream = m_fileStreamProvider.GetReadStream(torrentFilePath);
-        box.Torrent = TorrentInfo::Decode(*stream, m_bencoder);
+        IReadStreamPtr const stream = m_fileStreamProvider.GetReadStream(paths.StateFilePath);
+        StateVisitor visitor(state);
+        m_bencoder.Decode(Util::ReadStream(*stream), visitor);
+    }
 
-        std::string const infoHash = torrentFilePath.stem().string();
-        if (!Util::IsEqualNoCase(box.Torrent.GetInfoHash(), infoHash, std::locale::classic()))
+    std::unique_ptr<BencodeDocument const> resumeDocument;
+    {
+        IReadStreamPtr const stream = m_fileStreamProvider.GetReadStream(paths.LibTorrentStateFilePath);
+        resumeDocument = std::make_unique<BencodeDocument const>(Util::ReadStream(*stream));
+    }
+
+    BencodeValue const resume = resumeDocument->GetRoot();
+
+    FromStoreState(state, box);
+
+    BencodeValue const files = resume[RField::Files];
+    box.Files.reserve(files.GetSize());
+    for (std::size_t i = 0, count = files.GetSize(); i < count; ++i)
+    {
+        namespace ff = RField::FileField;
+
+        box.Files.push_back(FromStoreFilePriority(static_cast<int>(files[i][ff::Priority].AsInteger())));
+    }
+
+    FromStoreBitfield(resume[RField::Bitfield].AsString(), box);
+
+    BencodeValue const trackers = resume[RField::Trackers];
+    for (std::size_t i = 0, count = trackers.GetSize(); i < count; ++i)
+    {
+        namespace tf = RField::TrackerField;
+
+        std::string_view const url = trackers.GetKey(i);
+        if (url == Detail::DhtTrackerUrl)
+        {
+            continue;
+        }
+
+        BencodeValue const params = trackers.GetValue(i);
+        if (params[tf::Enabled].AsInteger() == 1)
         {
-            throw Exception(fmt::format("Info hashes don't match: {} vs. {}", box.Torrent.GetInfoHash(), infoHash));
+            box.Trackers.push_back({std::string(url)});
         }
     }
 
-    ojson state;
+    nextBox = std::move(box);
+    return true;
+}
+
+struct RpcTorrent
+{
+    std::string InfoHash;
+    fs::path TorrentFilePath;
+    Detail::State State;
+    std::string Bitfield;
+    bool IsComplete;
+    std::vector<int> FilePriorities;
+    std::vector<std::string> TrackerUrls;
+};
+
+ojson CallRpc(ScgiClient const& client, XmlRpcCodec const& codec, std::string const& methodName, ojson const& params)
+{
+    std::ostringstream request;
+    codec.EncodeCall(request, methodName, params);
+
+    std::string const response = client.Send(request.str());
+
+    ojson result;
+    codec.DecodeResponse(response, result);
+    return result;
+}
+
+ojson MakeRpcCall(std::string const& methodName, ojson&& params)
+{
+    ojson result = ojson::object();
+    result["methodName"] = methodName;
+    result["params"] = std::move(params);
+    return result;
+}
+
+// Each system.multicall result is either one-element array holding the value, or a fault struct
+ojson const& GetMulticallResult(ojson const& result, std::string const& methodName)
+{
+    if (result.is_object())
     {
-        IReadStreamPtr const stream = m_fileStreamProvider.GetReadStream(stateFilePath);
-        m_bencoder.Decode(*stream, state);
+        throw Exception(fmt::format("XML-RPC fault in {}: {}", methodName,
+            result.get_value_or<std::string>("faultString", "")));
     }
 
-    ojson resume;
+    if (!result.is_array() || result.size() != 1 || !result[0].is_array())
     {
-        IReadStreamPtr const stream = m_fileStreamProvider.GetReadStream(libTorrentStateFilePath);
-        m_bencoder.Decode(*stream, resume);
+        throw Exception(fmt::format("Unexpected XML-RPC result of {}", methodName));
     }
 
-    box.AddedAt = state[SField::TimestampStarted].as<std::time_t>();
-    box.CompletedAt = state[SField::TimestampFinished].as<std::time_t>();
-    box.IsPaused = state[SField::Priority].as<int>() == 0;
-    box.UploadedSize = state[SField::TotalUploaded].as<std::uint64_t>();
-    box.SavePath = Util::GetPath(state[SField::Directory].as<std::string>());
-    box.BlockSize = box.Torrent.GetPieceSize();
+    return result[0];
+}
 
-    box.Files.reserve(resume[RField::Files].size());
-    for (ojson const& file : resume[RField::Files].array_range())
+// rTorrent returns bitfield as uppercase hex string, or empty one if bitfield isn't allocated (e.g. download is closed)
+std::string FromRpcBitfield(std::string_view hexBitfield)
+{
+    if (hexBitfield.size() % 2 != 0)
     {
-        namespace ff = RField::FileField;
+        throw Exception(fmt::format("Invalid bitfield: {}", hexBitfield));
+    }
 
-        int const filePriority = file[ff::Priority].as<int>();
+    auto const fromHex =
+        [hexBitfield](char c)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                return c - '0';
+            }
 
-        Box::FileInfo boxFile;
-        boxFile.DoNotDownload = filePriority == Detail::DoNotDownloadPriority;
-        boxFile.Priority = boxFile.DoNotDownload ? Box::NormalPriority : BoxHelper::Priority::FromStore(filePriority - 1,
-            Detail::MinPriority, Detail::MaxPriority);
-        box.Files.push_back(std::move(boxFile));
+            if (c >= 'A' && c <= 'F')
+            {
+                return c - 'A' + 10;
+            }
+
+            if (c >= 'a' && c <= 'f')
+            {
+                return c - 'a' + 10;
+            }
+
+            throw Exception(fmt::format("Invalid bitfield: {}", hexBitfield));
+        };
+
+    std::string result;
+    result.reserve(hexBitfield.size() / 2);
+    for (std::size_t i = 0; i < hexBitfield.size(); i += 2)
+    {
+        result += static_cast<char>((fromHex(hexBitfield[i]) << 4) | fromHex(hexBitfield[i + 1]));
     }
 
-    std::uint64_t const totalSize = box.Torrent.GetTotalSize();
-    std::uint64_t const totalBlockCount = (totalSize + box.BlockSize - 1) / box.BlockSize;
-    box.ValidBlocks.reserve(totalBlockCount + 8);
-    for (unsigned char const c : resume[RField::Bitfield].as<std::string>())
+    return result;
+}
+
+// Scalar fields of all torrents come in a single d.multicall2 round trip, and files and trackers are then fetched in
+// batches of f.multicall and t.multicall wrapped into system.multicall
+std::vector<RpcTorrent> FetchRpcTorrents(ScgiClient const& client)
+{
+    XmlRpcCodec const codec;
+
+    ojson downloadParams = ojson::array();
+    downloadParams.push_back("");
+    downloadParams.push_back(Detail::RpcMainView);
+    for (std::string const& command : Detail::DownloadCommands)
     {
-        for (int i = 7; i >= 0; --i)
-        {
-            bool const isPieceValid = (c & (1 << i)) != 0;
-            box.ValidBlocks.push_back(isPieceValid);
-        }
+        downloadParams.push_back(command);
     }
 
-    box.ValidBlocks.resize(totalBlockCount);
+    ojson const downloads = CallRpc(client, codec, Detail::RpcMethod::DownloadMulticall, downloadParams);
+    if (!downloads.is_array())
+    {
+        throw Exception(fmt::format("Unexpected XML-RPC result of {}", Detail::RpcMethod::DownloadMulticall));
+    }
+
+    std::vector<RpcTorrent> result;
+    result.reserve(downloads.size());
 
-    for (auto const& tracker : resume[RField::Trackers].object_range())
+    for (ojson const& download : downloads.array_range())
     {
-        namespace tf = RField::TrackerField;
+        if (!download.is_array() || download.size() != Detail::DownloadColumnCount)
+        {
+            throw Exception(fmt::format("Unexpected XML-RPC result of {}", Detail::RpcMethod::DownloadMulticall));
+        }
 
-        std::string const url{tracker.key()};
-        if (url == "dht://")
+        RpcTorrent torrent;
+        torrent.InfoHash = download[Detail::HashColumn].as<std::string>();
+        torrent.TorrentFilePath = Util::GetPath(download[Detail::SessionFileColumn].as<std::string>());
+        torrent.State.Directory = download[Detail::DirectoryColumn].as<std::string>();
+        torrent.State.Priority = download[Detail::PriorityColumn].as<long long>();
+        torrent.State.State = download[Detail::StateColumn].as<long long>();
+        torrent.State.TimestampStarted = download[Detail::TimestampStartedColumn].as<long long>();
+        torrent.State.TimestampFinished = download[Detail::TimestampFinishedColumn].as<long long>();
+        torrent.State.TotalUploaded = download[Detail::TotalUploadedColumn].as<long long>();
+        torrent.Bitfield = FromRpcBitfield(download[Detail::BitfieldColumn].as<std::string>());
+        torrent.IsComplete = download[Detail::CompleteColumn].as<long long>() != 0;
+
+        // Without bitfield, only complete downloads and those without any chunks are known to have all or none valid
+        if (torrent.Bitfield.empty() && !torrent.IsComplete &&
+            download[Detail::CompletedChunksColumn].as<long long>() != 0)
         {
+            Logger(Logger::Warning) << "Piece bitfield of torrent " << torrent.InfoHash <<
+                " is not available, skipping";
             continue;
         }
 
-        ojson const& params = tracker.value();
-        if (params[tf::Enabled].as<int>() == 1)
+        result.push_back(std::move(torrent));
+    }
+
+    for (std::size_t batchBegin = 0; batchBegin < result.size(); batchBegin += Detail::RpcBatchSize)
+    {
+        std::size_t const batchEnd = std::min(batchBegin + Detail::RpcBatchSize, result.size());
+
+        ojson calls = ojson::array();
+        for (std::size_t i = batchBegin; i < batchEnd; ++i)
+        {
+            ojson fileParams = ojson::array();
+            fileParams.push_back(result[i].InfoHash);
+            fileParams.push_back("");
+            fileParams.push_back(Detail::FilePriorityCommand);
+            calls.push_back(MakeRpcCall(Detail::RpcMethod::FileMulticall, std::move(fileParams)));
+
+            ojson trackerParams = ojson::array();
+            trackerParams.push_back(result[i].InfoHash);
+            trackerParams.push_back("");
+            trackerParams.push_back(Detail::TrackerUrlCommand);
+            trackerParams.push_back(Detail::TrackerIsEnabledCommand);
+            calls.push_back(MakeRpcCall(Detail::RpcMethod::TrackerMulticall, std::move(trackerParams)));
+        }
+
+        ojson multicallParams = ojson::array();
+        multicallParams.push_back(std::move(calls));
+
+        ojson const results = CallRpc(client, codec, Detail::RpcMethod::SystemMulticall, multicallParams);
+        if (!results.is_array() || results.size() != (batchEnd - batchBegin) * 2)
+        {
+            throw Exception(fmt::format("Unexpected XML-RPC result of {}", Detail::RpcMethod::SystemMulticall));
+        }
+
+        for (std::size_t i = batchBegin; i < batchEnd; ++i)
         {
-            box.Trackers.push_back({url});
+            RpcTorrent& torrent = result[i];
+
+            ojson const& files = GetMulticallResult(results[(i - batchBegin) * 2], Detail::RpcMethod::FileMulticall);
+            torrent.FilePriorities.reserve(files.size());
+            for (ojson const& file : files.array_range())
+            {
+                torrent.FilePriorities.push_back(file[0].as<int>());
+            }
+
+            ojson const& trackers = GetMulticallResult(results[(i - batchBegin) * 2 + 1],
+                Detail::RpcMethod::TrackerMulticall);
+            for (ojson const& tracker : trackers.array_range())
+            {
+                std::string url = tracker[0].as<std::string>();
+                if (url != Detail::DhtTrackerUrl && tracker[1].as<long long>() == 1)
+                {
+                    torrent.TrackerUrls.push_back(std::move(url));
+                }
+            }
         }
     }
 
+    return result;
+}
+
+class rTorrentRpcTorrentStateIterator : public ITorrentStateIterator
+{
+public:
+    rTorrentRpcTorrentStateIterator(std::vector<RpcTorrent>&& torrents, IFileStreamProvider const& fileStreamProvider);
+
+public:
+    // ITorrentStateIterator
+    bool GetNext(Box& nextBox) override;
+
+private:
+    std::vector<RpcTorrent> const m_torrents;
+    IFileStreamProvider const& m_fileStreamProvider;
+    std::atomic<std::size_t> m_torrentIndex;
+};
+
+rTorrentRpcTorrentStateIterator::rTorrentRpcTorrentStateIterator(std::vector<RpcTorrent>&& torrents,
+    IFileStreamProvider const& fileStreamProvider) :
+    m_torrents(std::move(torrents)),
+    m_fileStreamProvider(fileStreamProvider),
+    m_torrentIndex(0)
+{
+    //
+}
+
+bool rTorrentRpcTorrentStateIterator::GetNext(Box& nextBox)
+{
+    std::size_t const torrentIndex = m_torrentIndex++;
+    if (torrentIndex >= m_torrents.size())
+    {
+        return false;
+    }
+
+    RpcTorrent const& torrent = m_torrents[torrentIndex];
+
+    if (torrent.TorrentFilePath.empty())
+    {
+        throw Exception(fmt::format("Session file of torrent {} is unknown, is rTorrent session directory set?",
+            torrent.InfoHash));
+    }
+
+    Box box;
+    box.Torrent = LoadTorrent(m_fileStreamProvider, torrent.TorrentFilePath, torrent.InfoHash);
+
+    FromStoreState(torrent.State, box);
+
+    box.Files.reserve(torrent.FilePriorities.size());
+    for (int const filePriority : torrent.FilePriorities)
+    {
+        box.Files.push_back(FromStoreFilePriority(filePriority));
+    }
+
+    FromStoreBitfield(torrent.Bitfield, box);
+
+    if (torrent.IsComplete)
+    {
+        box.ValidBlocks.assign(box.ValidBlocks.size(), true);
+    }
+
+    for (std::string const& url : torrent.TrackerUrls)
+    {
+        box.Trackers.push_back({url});
+    }
+
     nextBox = std::move(box);
     return true;
 }
 
-bool rTorrentTorrentStateIterator::GetNext(fs::path& stateFilePath, fs::path& torrentFilePath,
-    fs::path& libTorrentStateFilePath)
+enum SessionFileFlag
+{
+    TorrentFileFlag = 1 << 0,
+    StateFileFlag = 1 << 1,
+    LibTorrentStateFileFlag = 1 << 2
+};
+
+// Each torrent is stored as "<hash>.torrent" plus "<hash>.torrent.rtorrent" and "<hash>.torrent.libtorrent_resume"
+// next to it. Directory is listed once, relying on file types reported by the listing itself (d_type on POSIX) rather
+// than on stat'ing every file, and files are grouped into triples by the torrent file name.
+std::shared_ptr<rTorrentSession const> ScanSession(fs::path const& dataDir)
 {
-    std::lock_guard<std::mutex> lock(m_directoryItMutex);
+    auto result = std::make_shared<rTorrentSession>();
+    result->DataDir = dataDir;
 
-    for (; m_directoryIt != m_directoryEnd; ++m_directoryIt)
+    std::unordered_map<std::string, unsigned int> torrentFileFlags;
+    for (fs::directory_entry const& entry : fs::directory_iterator(dataDir))
     {
-        stateFilePath = m_directoryIt->path();
-        if (stateFilePath.extension().string() != Detail::StateFileExtension)
+        fs::path const& path = entry.path();
+        fs::path const extension = path.extension();
+
+        std::string torrentFileName;
+        unsigned int flag;
+        if (extension == Detail::StateFileExtension)
+        {
+            torrentFileName = path.stem().string();
+            flag = StateFileFlag;
+        }
+        else if (extension == Detail::LibTorrentStateFileExtension)
+        {
+            torrentFileName = path.stem().string();
+            flag = LibTorrentStateFileFlag;
+        }
+        else if (extension == Detail::TorrentFileExtension)
+        {
+            torrentFileName = path.filename().string();
+            flag = TorrentFileFlag;
+        }
+        else
         {
             continue;
         }
 
-        if (!fs::is_regular_file(*m_directoryIt))
+        if (!entry.is_regular_file())
         {
-            Logger(Logger::Warning) << "File " << stateFilePath << " is not a regular file, skipping";
+            if (flag == StateFileFlag)
+            {
+                result->SkippedFilePaths.push_back(path);
+            }
+
             continue;
         }
 
-        torrentFilePath = stateFilePath;
-        torrentFilePath.replace_extension(fs::path());
-        if (!fs::is_regular_file(torrentFilePath))
+        torrentFileFlags[std::move(torrentFileName)] |= flag;
+    }
+
+    result->Torrents.reserve(torrentFileFlags.size());
+
+    for (auto const& [torrentFileName, flags] : torrentFileFlags)
+    {
+        if ((flags & StateFileFlag) == 0)
+        {
+            continue;
+        }
+
+        fs::path torrentFilePath = dataDir / torrentFileName;
+        if ((flags & TorrentFileFlag) == 0)
         {
-            Logger(Logger::Warning) << "File " << torrentFilePath << " is not a regular file, skipping";
+            result->SkippedFilePaths.push_back(std::move(torrentFilePath));
             continue;
         }
 
-        libTorrentStateFilePath = stateFilePath;
-        libTorrentStateFilePath.replace_extension(Detail::LibTorrentStateFileExtension);
-        if (!fs::is_regular_file(libTorrentStateFilePath))
+        fs::path libTorrentStateFilePath = torrentFilePath;
+        libTorrentStateFilePath += Detail::LibTorrentStateFileExtension;
+        if ((flags & LibTorrentStateFileFlag) == 0)
         {
-            Logger(Logger::Warning) << "File " << libTorrentStateFilePath << " is not a regular file, skipping";
+            result->SkippedFilePaths.push_back(std::move(libTorrentStateFilePath));
             continue;
         }
 
-        ++m_directoryIt;
-        return true;
+        fs::path stateFilePath = torrentFilePath;
+        stateFilePath += Detail::StateFileExtension;
+
+        result->Torrents.push_back({std::move(stateFilePath), std::move(torrentFilePath),
+            std::move(libTorrentStateFilePath)});
     }
 
-    return false;
+    // Directory listing order is arbitrary
+    std::sort(result->Torrents.begin(), result->Torrents.end(),
+        [](rTorrentSession::TorrentFilePaths const& lhs, rTorrentSession::TorrentFilePaths const& rhs)
+        {
+            return lhs.TorrentFilePath < rhs.TorrentFilePath;
+        });
+    std::sort(result->SkippedFilePaths.begin(), result->SkippedFilePaths.end());
+
+    return result;
 }
 
 } // namespace
 
-rTorrentStateStore::rTorrentStateStore() = default;
+rTorrentStateStore::rTorrentStateStore(std::string const& scgiAddress) :
+    m_scgiAddress(scgiAddress),
+    m_bencoder(),
+    m_lastSession(),
+    m_lastSessionMutex()
+{
+    //
+}
+
 rTorrentStateStore::~rTorrentStateStore() = default;
 
 TorrentClient::Enum rTorrentStateStore::GetTorrentClient() const
@@ -328,37 +953,121 @@ bool rTorrentStateStore::IsValidDataDir(fs::path const& dataDir, Intention::Enum
         return fs::is_directory(dataDir);
     }
 
-    for (fs::directory_iterator it(dataDir), end; it != end; ++it)
+    return !GetSession(dataDir)->Torrents.empty();
+}
+
+ITorrentStateIteratorPtr rTorrentStateStore::Export(fs::path const& dataDir, IFileStreamProvider const& fileStreamProvider) const
+{
+    if (!m_scgiAddress.empty())
+    {
+        Logger(Logger::Info) << "[rTorrent] Fetching torrents over SCGI from " << m_scgiAddress;
+
+        ScgiClient const client(m_scgiAddress, Detail::RpcTimeout);
+        return std::make_unique<rTorrentRpcTorrentStateIterator>(FetchRpcTorrents(client), fileStreamProvider);
+    }
+
+    std::shared_ptr<rTorrentSession const> session = GetSession(dataDir);
+
+    for (fs::path const& path : session->SkippedFilePaths)
+    {
+        Logger(Logger::Warning) << "File " << path << " is not a regular file, skipping";
+    }
+
+    return std::make_unique<rTorrentTorrentStateIterator>(std::move(session), fileStreamProvider);
+}
+
+void rTorrentStateStore::Import(fs::path const& dataDir, Box const& box, IFileStreamProvider& fileStreamProvider) const
+{
+    namespace RField = Detail::ResumeField;
+    namespace SField = Detail::StateField;
+
+    for (Box::FileInfo const& file : box.Files)
     {
-        fs::path path = it->path();
-        if (path.extension() != Detail::StateFileExtension || !fs::is_regular_file(it->status()))
+        if (!file.Path.empty())
         {
-            continue;
+            throw ImportCancelledException(fmt::format("rTorrent does not support moving or renaming individual files: "
+                "{}", file.Path));
         }
+    }
+
+    TorrentInfo torrent = box.Torrent;
+    torrent.SetTrackers(box.Trackers);
+
+    // Directory holds the files of multi-file torrent, but the file itself in case of single-file one
+    fs::path const directory = torrent.IsMultiFile() ? box.SavePath : box.SavePath.parent_path();
+
+    ojson resume = ojson::object();
 
-        if (!fs::is_regular_file(path.replace_extension(Detail::LibTorrentStateFileExtension)))
+    std::uint64_t const pieceCount = (torrent.GetTotalSize() + torrent.GetPieceSize() - 1) / torrent.GetPieceSize();
+    std::uint64_t validPieceCount;
+    resume[RField::Bitfield] = ToStoreBitfield(box, pieceCount, validPieceCount);
+
+    resume[RField::Files] = ojson::array();
+    for (std::size_t i = 0; i < box.Files.size(); ++i)
+    {
+        namespace ff = RField::FileField;
+
+        ojson file = ojson::object();
+        if (std::optional<std::int64_t> const mtime = GetFileModificationTime(directory / torrent.GetFilePath(i)))
         {
-            continue;
+            file[ff::Mtime] = *mtime;
         }
+        file[ff::Priority] = ToStoreFilePriority(box.Files[i]);
+        resume[RField::Files].push_back(std::move(file));
+    }
 
-        if (!fs::is_regular_file(path.replace_extension(fs::path())))
+    resume[RField::Trackers] = ojson::object();
+    for (std::vector<std::string> const& tier : box.Trackers)
+    {
+        for (std::string const& url : tier)
         {
-            continue;
+            ojson tracker = ojson::object();
+            tracker[RField::TrackerField::Enabled] = 1;
+            resume[RField::Trackers][url] = std::move(tracker);
         }
-
-        return true;
     }
 
-    return false;
+    Util::SortJsonObjectKeys(resume[RField::Trackers]);
+
+    ojson state = ojson::object();
+    state[SField::ChunksDone] = validPieceCount;
+    state[SField::Complete] = validPieceCount == pieceCount ? 1 : 0;
+    state[SField::Directory] = directory.string();
+    state[SField::Priority] = Detail::NormalDownloadPriority;
+    state[SField::State] = static_cast<int>(box.IsPaused ? Detail::StoppedState : Detail::StartedState);
+    state[SField::StateChanged] = static_cast<std::int64_t>(std::time(nullptr));
+    state[SField::TimestampFinished] = static_cast<std::int64_t>(box.CompletedAt);
+    state[SField::TimestampStarted] = static_cast<std::int64_t>(box.AddedAt);
+    state[SField::TotalUploaded] = box.UploadedSize;
+
+    std::string infoHash = torrent.GetInfoHash();
+    std::transform(infoHash.begin(), infoHash.end(), infoHash.begin(),
+        [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+
+    fs::path const torrentFilePath = dataDir / (infoHash + Detail::TorrentFileExtension);
+    fs::path libTorrentStateFilePath = torrentFilePath;
+    libTorrentStateFilePath += Detail::LibTorrentStateFileExtension;
+    fs::path stateFilePath = torrentFilePath;
+    stateFilePath += Detail::StateFileExtension;
+
+    // rTorrent picks session entries up by .torrent file, which is therefore committed after the other two
+    std::vector<IWriteStreamPtr> const streams = fileStreamProvider.GetWriteStreams({torrentFilePath,
+        libTorrentStateFilePath, stateFilePath});
+
+    torrent.Encode(*streams[0]);
+    m_bencoder.Encode(*streams[1], resume);
+    m_bencoder.Encode(*streams[2], state);
 }
 
-ITorrentStateIteratorPtr rTorrentStateStore::Export(fs::path const& dataDir, IFileStreamProvider const& fileStreamProvider) const
+std::shared_ptr<rTorrentSession const> rTorrentStateStore::GetSession(fs::path const& dataDir) const
 {
-    return std::make_unique<rTorrentTorrentStateIterator>(dataDir, fileStreamProvider);
-}
+    // Data directory is validated before being exported, keep the listing around so that it's only done once
+    std::lock_guard<std::mutex> lock(m_lastSessionMutex);
 
-void rTorrentStateStore::Import(fs::path const& /*dataDir*/, Box const& /*box*/,
-    IFileStreamProvider& /*fileStreamProvider*/) const
-{
-    throw NotImplementedException(__func__);
+    if (m_lastSession == nullptr || m_lastSession->DataDir != dataDir)
+    {
+        m_lastSession = ScanSession(dataDir);
+    }
+
+    return m_lastSession;
 }
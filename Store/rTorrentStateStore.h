@@ -18,10 +18,20 @@
 
 #include "ITorrentStateStore.h"
 
+#include "Codec/BencodeCodec.h"
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+
+struct rTorrentSession;
+
 class rTorrentStateStore : public ITorrentStateStore
 {
 public:
-    rTorrentStateStore();
+    // Torrents are exported from running client over SCGI if address is not empty, and from session directory otherwise
+    explicit rTorrentStateStore(std::string const& scgiAddress);
     ~rTorrentStateStore() override;
 
 public:
@@ -34,4 +44,13 @@ public:
     ITorrentStateIteratorPtr Export(std::filesystem::path const& dataDir,
         IFileStreamProvider const& fileStreamProvider) const override;
     void Import(std::filesystem::path const& dataDir, Box const& box, IFileStreamProvider& fileStreamProvider) const override;
+
+private:
+    std::shared_ptr<rTorrentSession const> GetSession(std::filesystem::path const& dataDir) const;
+
+private:
+    std::string const m_scgiAddress;
+    BencodeCodec const m_bencoder;
+    std::shared_ptr<rTorrentSession const> mutable m_lastSession;
+    std::mutex mutable m_lastSessionMutex;
 };
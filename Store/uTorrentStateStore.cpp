@@ -16,20 +16,23 @@
 
 #include "uTorrentStateStore.h"
 
-#include "Codec/BencodeCodec.h"
+#include "Codec/BencodeDocument.h"
+#include "Codec/BencodeStructuralIndex.h"
 #include "Common/Exception.h"
 #include "Common/IFileStreamProvider.h"
 #include "Common/IForwardIterator.h"
 #include "Common/Logger.h"
+#include "Common/MappedFile.h"
 #include "Common/Util.h"
 #include "Torrent/Box.h"
 #include "Torrent/BoxHelper.h"
 
-#include <jsoncons/json.hpp>
-
+#include <atomic>
 #include <filesystem>
 #include <iostream>
-#include <mutex>
+#include <memory>
+#include <span>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -82,34 +85,43 @@ std::string const TorrentFileExtension = ".torrent";
 namespace
 {
 
-Box::LimitInfo FromStoreRatioLimit(ojson const& enabled, ojson const& storeLimit)
+Box::LimitInfo FromStoreRatioLimit(BencodeValue const& enabled, BencodeValue const& storeLimit)
 {
     Box::LimitInfo result;
-    result.Mode = enabled.as<int>() != 0 ? Box::LimitMode::Enabled : Box::LimitMode::Inherit;
-    result.Value = storeLimit.as<double>() / 1000.;
+    result.Mode = enabled.AsInteger() != 0 ? Box::LimitMode::Enabled : Box::LimitMode::Inherit;
+    result.Value = static_cast<double>(storeLimit.AsInteger()) / 1000.;
     return result;
 }
 
-Box::LimitInfo FromStoreSpeedLimit(ojson const& storeLimit)
+Box::LimitInfo FromStoreSpeedLimit(BencodeValue const& storeLimit)
 {
     Box::LimitInfo result;
-    result.Mode = storeLimit.as<int>() > 0 ? Box::LimitMode::Enabled : Box::LimitMode::Inherit;
-    result.Value = storeLimit.as<int>();
+    result.Mode = storeLimit.AsInteger() > 0 ? Box::LimitMode::Enabled : Box::LimitMode::Inherit;
+    result.Value = static_cast<double>(storeLimit.AsInteger());
     return result;
 }
 
-fs::path GetChangedFilePath(ojson const& targets, std::size_t index)
+// Targets are [file index, path] pairs for moved files only, look them all up in one pass instead of once per file
+std::vector<fs::path> GetChangedFilePaths(BencodeValue const& targets, std::size_t fileCount)
 {
-    fs::path result;
+    std::vector<fs::path> result(fileCount);
 
-    if (!targets.is_null())
+    if (!targets.IsNull())
     {
-        for (ojson const& target : targets.array_range())
+        for (std::size_t i = 0, count = targets.GetSize(); i < count; ++i)
         {
-            if (target[0].as<std::size_t>() == index)
+            BencodeValue const target = targets[i];
+            long long const index = target[0].AsInteger();
+            if (index < 0 || static_cast<std::size_t>(index) >= fileCount)
             {
-                result = Util::GetPath(target[1].as<std::string>());
-                break;
+                continue;
+            }
+
+            // First target wins, same as when files were looked up one by one
+            fs::path& path = result[static_cast<std::size_t>(index)];
+            if (path.empty())
+            {
+                path = Util::GetPath(target[1].AsString());
             }
         }
     }
@@ -120,34 +132,31 @@ fs::path GetChangedFilePath(ojson const& targets, std::size_t index)
 class uTorrentTorrentStateIterator : public ITorrentStateIterator
 {
 public:
-    uTorrentTorrentStateIterator(fs::path const& dataDir, ojson&& resume, IFileStreamProvider const& fileStreamProvider);
+    uTorrentTorrentStateIterator(fs::path const& dataDir, MappedFilePtr resumeFile,
+        IFileStreamProvider const& fileStreamProvider);
 
 public:
     // ITorrentStateIterator
     bool GetNext(Box& nextBox) override;
 
 private:
-    bool GetNext(fs::path& torrentFilePath, ojson& resume);
+    bool GetNext(fs::path& torrentFilePath, std::span<char const>& resumeData);
 
 private:
     fs::path const m_dataDir;
-    ojson const m_resume;
+    MappedFilePtr const m_resumeFile;
+    BencodeStructuralIndex const m_torrents;
     IFileStreamProvider const& m_fileStreamProvider;
-    ojson::const_object_iterator m_torrentIt;
-    ojson::const_object_iterator const m_torrentEnd;
-    std::mutex m_torrentItMutex;
-    BencodeCodec const m_bencoder;
+    std::atomic<std::size_t> m_torrentIndex;
 };
 
-uTorrentTorrentStateIterator::uTorrentTorrentStateIterator(fs::path const& dataDir, ojson&& resume,
+uTorrentTorrentStateIterator::uTorrentTorrentStateIterator(fs::path const& dataDir, MappedFilePtr resumeFile,
     IFileStreamProvider const& fileStreamProvider) :
     m_dataDir(dataDir),
-    m_resume(std::move(resume)),
+    m_resumeFile(std::move(resumeFile)),
+    m_torrents(m_resumeFile->GetData()),
     m_fileStreamProvider(fileStreamProvider),
-    m_torrentIt(m_resume.object_range().begin()),
-    m_torrentEnd(m_resume.object_range().end()),
-    m_torrentItMutex(),
-    m_bencoder()
+    m_torrentIndex(0)
 {
     //
 }
@@ -157,52 +166,54 @@ bool uTorrentTorrentStateIterator::GetNext(Box& nextBox)
     namespace RField = Detail::ResumeField;
 
     fs::path torrentFilePath;
-    ojson resume;
-    if (!GetNext(torrentFilePath, resume))
+    std::span<char const> resumeData;
+    if (!GetNext(torrentFilePath, resumeData))
     {
         return false;
     }
 
+    BencodeDocument const resumeDocument(resumeData);
+    BencodeValue const resume = resumeDocument.GetRoot();
+
     Box box;
 
     {
         IReadStreamPtr const stream = m_fileStreamProvider.GetReadStream(torrentFilePath);
-        box.Torrent = TorrentInfo::Decode(*stream, m_bencoder);
+        box.Torrent = TorrentInfo::Decode(*stream);
     }
 
-    box.AddedAt = resume[RField::AddedOn].as<std::time_t>();
-    box.CompletedAt = resume[RField::CompletedOn].as<std::time_t>();
-    box.IsPaused = resume[RField::Started].as<int>() == Detail::PausedState ||
-        resume[RField::Started].as<int>() == Detail::StoppedState;
-    box.DownloadedSize = resume[RField::Downloaded].as<std::uint64_t>();
-    box.UploadedSize = resume[RField::Uploaded].as<std::uint64_t>();
-    box.CorruptedSize = resume[RField::Corrupt].as<std::uint64_t>();
-    box.SavePath = Util::GetPath(resume[RField::Path].as<std::string>());
+    box.AddedAt = static_cast<std::time_t>(resume[RField::AddedOn].AsInteger());
+    box.CompletedAt = static_cast<std::time_t>(resume[RField::CompletedOn].AsInteger());
+    box.IsPaused = resume[RField::Started].AsInteger() == Detail::PausedState ||
+        resume[RField::Started].AsInteger() == Detail::StoppedState;
+    box.DownloadedSize = static_cast<std::uint64_t>(resume[RField::Downloaded].AsInteger());
+    box.UploadedSize = static_cast<std::uint64_t>(resume[RField::Uploaded].AsInteger());
+    box.CorruptedSize = static_cast<std::uint64_t>(resume[RField::Corrupt].AsInteger());
+    box.SavePath = Util::GetPath(resume[RField::Path].AsString());
     box.BlockSize = box.Torrent.GetPieceSize();
     box.RatioLimit = FromStoreRatioLimit(resume[RField::OverrideSeedSettings], resume[RField::WantedRatio]);
     box.DownloadSpeedLimit = FromStoreSpeedLimit(resume[RField::DownSpeed]);
     box.UploadSpeedLimit = FromStoreSpeedLimit(resume[RField::UpSpeed]);
 
-    std::string const filePriorities = resume[RField::Prio].as<std::string>();
-    ojson const& targets = resume.at_or_null(RField::Targets);
+    std::string_view const filePriorities = resume[RField::Prio].AsString();
+    std::vector<fs::path> changedPaths = GetChangedFilePaths(resume.Find(RField::Targets), filePriorities.size());
     box.Files.reserve(filePriorities.size());
     for (std::size_t i = 0; i < filePriorities.size(); ++i)
     {
         int const filePriority = filePriorities[i];
-        fs::path const changedPath = GetChangedFilePath(targets, i);
 
         Box::FileInfo file;
         file.DoNotDownload = filePriority == Detail::DoNotDownloadPriority;
         file.Priority = file.DoNotDownload ? Box::NormalPriority : BoxHelper::Priority::FromStore(filePriority,
             Detail::MinPriority, Detail::MaxPriority);
-        file.Path = changedPath;
+        file.Path = std::move(changedPaths[i]);
         box.Files.push_back(std::move(file));
     }
 
     std::uint64_t const totalSize = box.Torrent.GetTotalSize();
     std::uint64_t const totalBlockCount = (totalSize + box.BlockSize - 1) / box.BlockSize;
     box.ValidBlocks.reserve(totalBlockCount + 8);
-    for (unsigned char const c : resume[RField::Have].as<std::string>())
+    for (unsigned char const c : resume[RField::Have].AsString())
     {
         for (int i = 0; i < 8; ++i)
         {
@@ -213,22 +224,27 @@ bool uTorrentTorrentStateIterator::GetNext(Box& nextBox)
 
     box.ValidBlocks.resize(totalBlockCount);
 
-    for (ojson const& trackerUrl : resume[RField::Trackers].array_range())
+    BencodeValue const trackerUrls = resume[RField::Trackers];
+    for (std::size_t i = 0, count = trackerUrls.GetSize(); i < count; ++i)
     {
-        box.Trackers.push_back({trackerUrl.as<std::string>()});
+        box.Trackers.push_back({std::string(trackerUrls[i].AsString())});
     }
 
     nextBox = std::move(box);
     return true;
 }
 
-bool uTorrentTorrentStateIterator::GetNext(fs::path& torrentFilePath, ojson& resume)
+// Entries have only been located up front, so claiming one is just an index bump, and decoding it is left to the
+// claiming thread
+bool uTorrentTorrentStateIterator::GetNext(fs::path& torrentFilePath, std::span<char const>& resumeData)
 {
-    std::lock_guard<std::mutex> lock(m_torrentItMutex);
+    std::vector<BencodeStructuralIndex::Entry> const& entries = m_torrents.GetEntries();
 
-    for (; m_torrentIt != m_torrentEnd; ++m_torrentIt)
-     {
-        torrentFilePath = m_dataDir / std::string(m_torrentIt->key());
+    for (std::size_t torrentIndex = m_torrentIndex++; torrentIndex < entries.size(); torrentIndex = m_torrentIndex++)
+    {
+        BencodeStructuralIndex::Entry const& entry = entries[torrentIndex];
+
+        torrentFilePath = m_dataDir / entry.Key;
         if (torrentFilePath.extension().string() != Detail::TorrentFileExtension)
         {
             continue;
@@ -240,9 +256,7 @@ bool uTorrentTorrentStateIterator::GetNext(fs::path& torrentFilePath, ojson& res
             continue;
         }
 
-        resume = m_torrentIt->value();
-
-        ++m_torrentIt;
+        resumeData = entry.Value;
         return true;
     }
 
@@ -273,13 +287,11 @@ ITorrentStateIteratorPtr uTorrentStateStore::Export(fs::path const& dataDir, IFi
 {
     Logger(Logger::Debug) << "[uTorrent] Loading " << Detail::ResumeFilename;
 
-    ojson resume;
-    {
-        IReadStreamPtr const stream = fileStreamProvider.GetReadStream(dataDir / Detail::ResumeFilename);
-        BencodeCodec().Decode(*stream, resume);
-    }
+    // Only top-level entry boundaries are found up front, each torrent's resume data is decoded straight from the
+    // mapping by whichever thread picks the torrent up
+    MappedFilePtr resumeFile = fileStreamProvider.GetMappedFile(dataDir / Detail::ResumeFilename);
 
-    return std::make_unique<uTorrentTorrentStateIterator>(dataDir, std::move(resume), fileStreamProvider);
+    return std::make_unique<uTorrentTorrentStateIterator>(dataDir, std::move(resumeFile), fileStreamProvider);
 }
 
 void uTorrentStateStore::Import(fs::path const& /*dataDir*/, Box const& /*box*/,
@@ -16,7 +16,7 @@
 
 #include "uTorrentWebStateStore.h"
 
-#include "Codec/BencodeCodec.h"
+#include "Codec/BencodeDocument.h"
 #include "Common/Exception.h"
 #include "Common/IFileStreamProvider.h"
 #include "Common/IForwardIterator.h"
@@ -24,13 +24,12 @@
 #include "Common/Util.h"
 #include "Torrent/Box.h"
 
-#include <jsoncons/json.hpp>
-
 #include <sqlite_orm/sqlite_orm.h>
 
 #include <filesystem>
 #include <mutex>
-#include <sstream>
+#include <span>
+#include <string_view>
 
 namespace fs = std::filesystem;
 
@@ -85,6 +84,18 @@ std::string const StoreFilename = "store.dat";
 namespace
 {
 
+void AppendEncodedString(std::string& data, std::string_view value)
+{
+    data += std::to_string(value.size());
+    data += ':';
+    data += value;
+}
+
+void AppendRawData(std::string& data, std::span<char const> value)
+{
+    data.append(value.data(), value.size());
+}
+
 auto OpenResumeDatabase(fs::path const& path)
 {
     using namespace sqlite_orm;
@@ -119,7 +130,6 @@ private:
     ResumeInfoIterator m_resumeInfoIt;
     ResumeInfoIterator m_resumeInfoEnd;
     std::mutex m_resumeItMutex;
-    BencodeCodec const m_bencoder;
 };
 
 uTorrentWebTorrentStateIterator::uTorrentWebTorrentStateIterator(fs::path const& stateDir, ResumeDatabase&& resumeDb) :
@@ -144,38 +154,65 @@ bool uTorrentWebTorrentStateIterator::GetNext(Box& nextBox)
         return false;
     }
 
-    ojson resume;
-    {
-        std::string resumeData{resumeInfo.ResumeData.begin(), resumeInfo.ResumeData.end()};
-        std::istringstream stream(resumeData, std::ios_base::in | std::ios_base::binary);
-        m_bencoder.Decode(stream, resume);
-    }
+    BencodeDocument const resumeDocument(resumeInfo.ResumeData);
+    BencodeValue const resume = resumeDocument.GetRoot();
 
     Box box;
 
-    box.Torrent = ojson{ojson::object{
-        {TField::Info, resume[RField::Info]},
-        {TField::UrlList, resume.get_value_or<std::vector<std::string>>(RField::UrlList, std::vector<std::string>())}
-    }};
+    {
+        // Torrent is assembled from original bytes of resume values, keys are written in sorted order
+        BencodeValue const urlList = resume.Find(RField::UrlList);
+
+        std::string torrent = "d";
+        AppendEncodedString(torrent, TField::Info);
+        AppendRawData(torrent, resume[RField::Info].GetRawData());
+        AppendEncodedString(torrent, TField::UrlList);
+        if (urlList.IsList())
+        {
+            AppendRawData(torrent, urlList.GetRawData());
+        }
+        else
+        {
+            torrent += "le";
+        }
+        torrent += 'e';
+
+        box.Torrent = TorrentInfo::Decode(std::move(torrent));
+    }
 
-    box.AddedAt = resume[RField::AddedTime].as<std::time_t>();
-    box.CompletedAt = resume[RField::CompletedTime].as<std::time_t>();
-    box.IsPaused = resume[RField::Paused].as<bool>();
-    box.DownloadedSize = resume[RField::TotalDownloaded].as<std::uint64_t>();
-    box.UploadedSize = resume[RField::TotalUploaded].as<std::uint64_t>();
+    box.AddedAt = static_cast<std::time_t>(resume[RField::AddedTime].AsInteger());
+    box.CompletedAt = static_cast<std::time_t>(resume[RField::CompletedTime].AsInteger());
+    box.IsPaused = resume[RField::Paused].AsInteger() != 0;
+    box.DownloadedSize = static_cast<std::uint64_t>(resume[RField::TotalDownloaded].AsInteger());
+    box.UploadedSize = static_cast<std::uint64_t>(resume[RField::TotalUploaded].AsInteger());
     box.CorruptedSize = 0;
-    box.SavePath = Util::GetPath(resume[RField::SavePath].as_string()) / box.Torrent.GetName();
+    box.SavePath = Util::GetPath(resume[RField::SavePath].AsString()) / box.Torrent.GetName();
     box.BlockSize = box.Torrent.GetPieceSize();
 
     std::uint64_t const totalSize = box.Torrent.GetTotalSize();
     std::uint64_t const totalBlockCount = (totalSize + box.BlockSize - 1) / box.BlockSize;
     box.ValidBlocks.reserve(totalBlockCount);
-    for (bool const isPieceValid : resume[RField::Pieces].as<std::string>())
+    for (bool const isPieceValid : resume[RField::Pieces].AsString())
     {
         box.ValidBlocks.push_back(isPieceValid);
     }
 
-    box.Trackers = resume.get_value_or<decltype(box.Trackers)>(RField::Trackers, decltype(box.Trackers)());
+    BencodeValue const trackers = resume.Find(RField::Trackers);
+    if (!trackers.IsNull())
+    {
+        box.Trackers.reserve(trackers.GetSize());
+        for (std::size_t i = 0, tierCount = trackers.GetSize(); i < tierCount; ++i)
+        {
+            BencodeValue const tier = trackers[i];
+
+            auto& boxTier = box.Trackers.emplace_back();
+            boxTier.reserve(tier.GetSize());
+            for (std::size_t j = 0, urlCount = tier.GetSize(); j < urlCount; ++j)
+            {
+                boxTier.emplace_back(tier[j].AsString());
+            }
+        }
+    }
 
     nextBox = std::move(box);
     return true;
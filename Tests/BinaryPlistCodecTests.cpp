@@ -0,0 +1,247 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+#include "Codec/BinaryPlistCodec.h"
+#include "Common/Exception.h"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+namespace Detail
+{
+
+std::string const BinaryHeader = "bplist00";
+std::size_t const TrailerSize = 32;
+
+// "Üñï 😀" in UTF-8, spelled out to keep the source ASCII
+std::string const NonAsciiText = "\xc3\x9c\xc3\xb1\xc3\xaf \xf0\x9f\x98\x80";
+
+// 2020-01-02T03:04:05Z
+double const SampleDate = 1577934245;
+
+std::string const SampleXml =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"
+    "<plist version=\"1.0\">\n"
+    "<dict>\n"
+    "    <key>name</key><string>" + NonAsciiText + "</string>\n"
+    "    <key>negative</key><integer>-42</integer>\n"
+    "    <key>huge</key><integer>18446744073709551615</integer>\n"
+    "    <key>ratio</key><real>0.5</real>\n"
+    "    <key>paused</key><false/>\n"
+    "    <key>active</key><true/>\n"
+    "    <key>added</key><date>2020-01-02T03:04:05Z</date>\n"
+    "    <key>blob</key><data>\n"
+    "        AAEC/w==\n"
+    "    </data>\n"
+    "    <key>items</key>\n"
+    "    <array>\n"
+    "        <string>name</string>\n"
+    "        <integer>1</integer>\n"
+    "        <array/>\n"
+    "        <dict/>\n"
+    "    </array>\n"
+    "</dict>\n"
+    "</plist>\n";
+
+} // namespace Detail
+} // namespace
+
+namespace
+{
+
+ojson Decode(std::string const& data)
+{
+    ojson result;
+    BinaryPlistCodec().Decode(std::span<char const>(data), result);
+    return result;
+}
+
+std::string Encode(ojson const& root)
+{
+    std::ostringstream stream;
+    BinaryPlistCodec().Encode(stream, root);
+    return stream.str();
+}
+
+std::vector<std::uint8_t> GetBytes(ojson const& value)
+{
+    jsoncons::byte_string_view const bytes = value.as_byte_string_view();
+    return {bytes.begin(), bytes.end()};
+}
+
+std::uint64_t GetTrailerValue(std::string const& data, std::size_t offset, std::size_t size)
+{
+    std::uint64_t result = 0;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        result = (result << 8) | static_cast<std::uint8_t>(data[data.size() - Detail::TrailerSize + offset + i]);
+    }
+    return result;
+}
+
+// Lays out already encoded objects the way CoreFoundation does, with the first one being root
+std::string MakeBinaryPlist(std::vector<std::string> const& objects)
+{
+    std::string result = Detail::BinaryHeader;
+
+    std::vector<std::size_t> offsets;
+    for (std::string const& object : objects)
+    {
+        offsets.push_back(result.size());
+        result += object;
+    }
+
+    std::size_t const offsetTableOffset = result.size();
+    for (std::size_t const offset : offsets)
+    {
+        result += static_cast<char>(offset);
+    }
+
+    result.append(6, '\0');
+    result += '\x01';
+    result += '\x01';
+    result.append(7, '\0');
+    result += static_cast<char>(objects.size());
+    result.append(8, '\0');
+    result.append(7, '\0');
+    result += static_cast<char>(offsetTableOffset);
+
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("XML property list is decoded", "[plist]")
+{
+    ojson const root = Decode(Detail::SampleXml);
+
+    REQUIRE(root.is_object());
+    CHECK(root["name"].as<std::string>() == Detail::NonAsciiText);
+    CHECK(root["negative"].as<std::int64_t>() == -42);
+    CHECK(root["huge"].as<std::uint64_t>() == std::numeric_limits<std::uint64_t>::max());
+    CHECK(root["ratio"].as<double>() == 0.5);
+    CHECK(root["paused"].as<bool>() == false);
+    CHECK(root["active"].as<bool>() == true);
+    CHECK(root["added"].tag() == jsoncons::semantic_tag::epoch_second);
+    CHECK(root["added"].as<double>() == Detail::SampleDate);
+    REQUIRE(root["blob"].is_byte_string());
+    CHECK(GetBytes(root["blob"]) == std::vector<std::uint8_t>{0x00, 0x01, 0x02, 0xff});
+    REQUIRE(root["items"].is_array());
+    CHECK(root["items"].size() == 4);
+    CHECK(root["items"][2].is_array());
+    CHECK(root["items"][3].is_object());
+}
+
+TEST_CASE("XML property list survives binary round trip", "[plist]")
+{
+    ojson const root = Decode(Detail::SampleXml);
+
+    std::string const data = Encode(root);
+    REQUIRE(data.starts_with(Detail::BinaryHeader));
+
+    ojson const decodedRoot = Decode(data);
+    CHECK(decodedRoot == root);
+    CHECK(decodedRoot["added"].tag() == jsoncons::semantic_tag::epoch_second);
+    CHECK(decodedRoot["blob"].is_byte_string());
+
+    // Equal strings (here, "name" key and array item) are only stored once
+    CHECK(GetTrailerValue(data, 8, 8) == 22);
+
+    CHECK(Encode(decodedRoot) == data);
+}
+
+TEST_CASE("Binary property list fixture is decoded", "[plist]")
+{
+    std::string const data = MakeBinaryPlist({
+        // Array of the 6 objects following
+        std::string("\xa6\x01\x02\x03\x04\x05\x06", 7),
+        // "é😀" as UTF-16BE, 3 code units with surrogate pair
+        std::string("\x63\x00\xe9\xd8\x3d\xde\x00", 7),
+        // 1.0 seconds past 2001-01-01T00:00:00Z
+        std::string("\x33\x3f\xf0\x00\x00\x00\x00\x00\x00", 9),
+        // 3 bytes of data
+        std::string("\x43\x00\xff\x10", 4),
+        // 16-byte integers: 2^64 - 1 and -2
+        std::string("\x14\x00\x00\x00\x00\x00\x00\x00\x00\xff\xff\xff\xff\xff\xff\xff\xff", 17),
+        std::string("\x14\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xfe", 17),
+        // UID 0x0102
+        std::string("\x81\x01\x02", 3)});
+
+    ojson const root = Decode(data);
+
+    REQUIRE(root.is_array());
+    REQUIRE(root.size() == 6);
+    CHECK(root[0].as<std::string>() == "\xc3\xa9\xf0\x9f\x98\x80");
+    CHECK(root[1].tag() == jsoncons::semantic_tag::epoch_second);
+    CHECK(root[1].as<double>() == 978307201);
+    CHECK(GetBytes(root[2]) == std::vector<std::uint8_t>{0x00, 0xff, 0x10});
+    CHECK(root[3].as<std::uint64_t>() == std::numeric_limits<std::uint64_t>::max());
+    CHECK(root[4].as<std::int64_t>() == -2);
+    CHECK(root[5]["CF$UID"].as<std::uint64_t>() == 0x0102);
+
+    // Non-ASCII strings are written back as UTF-16, integers beyond int64 range as 16 bytes
+    std::string const encodedData = Encode(root);
+    CHECK(encodedData.find(std::string("\x63\x00\xe9\xd8\x3d\xde\x00", 7)) != std::string::npos);
+    CHECK(encodedData.find(std::string("\x14\x00\x00\x00\x00\x00\x00\x00\x00\xff\xff\xff\xff\xff\xff\xff\xff", 17)) !=
+        std::string::npos);
+    CHECK(Decode(encodedData) == root);
+}
+
+TEST_CASE("Binary property list with many objects uses wide references", "[plist]")
+{
+    ojson root = ojson::array();
+    for (std::size_t i = 0; i < 300; ++i)
+    {
+        ojson item = ojson::object();
+        item.insert_or_assign("index", i);
+        item.insert_or_assign("name", fmt::format("item-{}", i));
+        root.push_back(std::move(item));
+    }
+
+    std::string const data = Encode(root);
+
+    // Root array, "index" and "name" keys, 300 dictionaries, 300 indices and 300 names
+    REQUIRE(GetTrailerValue(data, 8, 8) == 903);
+    CHECK(GetTrailerValue(data, 7, 1) == 2);
+
+    CHECK(Decode(data) == root);
+}
+
+TEST_CASE("Malformed property lists are rejected", "[plist]")
+{
+    std::string const data = Encode(Decode(Detail::SampleXml));
+
+    CHECK_THROWS_AS(Decode(data.substr(0, data.size() - 1)), Exception);
+    CHECK_THROWS_AS(Decode(data.substr(0, Detail::TrailerSize)), Exception);
+    CHECK_THROWS_AS(Decode("bplist01"), Exception);
+    CHECK_THROWS_AS(Decode("<plist><date>2020-13-01T00:00:00Z</date></plist>"), Exception);
+    CHECK_THROWS_AS(Decode("<plist><data>AA*=</data></plist>"), Exception);
+    CHECK_THROWS_AS(Decode("<plist><dict><key>a</key></dict></plist>"), Exception);
+}
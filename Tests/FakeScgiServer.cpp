@@ -0,0 +1,353 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FakeScgiServer.h"
+
+#include "Common/Exception.h"
+
+#include <fmt/format.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <exception>
+#include <string_view>
+
+namespace
+{
+namespace Detail
+{
+
+std::string_view const ContentLengthHeader = "CONTENT_LENGTH";
+
+// How long to wait for a connection before checking whether server is being stopped
+long const AcceptTimeoutMicroseconds = 20 * 1000;
+
+std::size_t const IoChunkSize = 64 * 1024;
+
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+SocketHandle const InvalidSocket = INVALID_SOCKET;
+#else
+typedef int SocketHandle;
+SocketHandle const InvalidSocket = -1;
+#endif
+
+#if defined(MSG_NOSIGNAL)
+int const SendFlags = MSG_NOSIGNAL;
+#else
+int const SendFlags = 0;
+#endif
+
+} // namespace Detail
+} // namespace
+
+namespace
+{
+
+#ifdef _WIN32
+
+std::string GetLastSocketError()
+{
+    return fmt::format("error {}", ::WSAGetLastError());
+}
+
+void CloseSocket(Detail::SocketHandle socket)
+{
+    ::closesocket(socket);
+}
+
+void InitializeSockets()
+{
+    static int const result =
+        []
+        {
+            WSADATA data;
+            return ::WSAStartup(MAKEWORD(2, 2), &data);
+        }();
+
+    if (result != 0)
+    {
+        throw Exception(fmt::format("Unable to initialize Windows sockets (error {})", result));
+    }
+}
+
+#else
+
+std::string GetLastSocketError()
+{
+    return std::strerror(errno);
+}
+
+void CloseSocket(Detail::SocketHandle socket)
+{
+    ::close(socket);
+}
+
+void InitializeSockets()
+{
+    //
+}
+
+#endif
+
+Detail::SocketHandle ToHandle(std::intptr_t socket)
+{
+    return static_cast<Detail::SocketHandle>(socket);
+}
+
+std::intptr_t ListenTcp(std::string& address)
+{
+    InitializeSockets();
+
+    Detail::SocketHandle const result = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (result == Detail::InvalidSocket)
+    {
+        throw Exception(fmt::format("Unable to create socket ({})", GetLastSocketError()));
+    }
+
+    sockaddr_in localAddress = {};
+    localAddress.sin_family = AF_INET;
+    localAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    localAddress.sin_port = 0;
+
+    socklen_t localAddressSize = sizeof(localAddress);
+    if (::bind(result, reinterpret_cast<sockaddr const*>(&localAddress), sizeof(localAddress)) != 0 ||
+        ::listen(result, SOMAXCONN) != 0 ||
+        ::getsockname(result, reinterpret_cast<sockaddr*>(&localAddress), &localAddressSize) != 0)
+    {
+        std::string const error = GetLastSocketError();
+        CloseSocket(result);
+        throw Exception(fmt::format("Unable to listen on loopback TCP port ({})", error));
+    }
+
+    address = fmt::format("127.0.0.1:{}", ntohs(localAddress.sin_port));
+    return static_cast<std::intptr_t>(result);
+}
+
+std::intptr_t ListenLocal(std::filesystem::path const& socketPath, std::string& address)
+{
+#ifdef _WIN32
+    throw Exception(fmt::format("Unix domain sockets are not supported on this platform: {}", socketPath.string()));
+#else
+    std::string const path = socketPath.string();
+
+    sockaddr_un localAddress = {};
+    localAddress.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(localAddress.sun_path))
+    {
+        throw Exception(fmt::format("SCGI socket path is too long: {}", path));
+    }
+
+    std::copy(path.begin(), path.end(), localAddress.sun_path);
+
+    Detail::SocketHandle const result = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (result == Detail::InvalidSocket)
+    {
+        throw Exception(fmt::format("Unable to create socket ({})", GetLastSocketError()));
+    }
+
+    if (::bind(result, reinterpret_cast<sockaddr const*>(&localAddress), sizeof(localAddress)) != 0 ||
+        ::listen(result, SOMAXCONN) != 0)
+    {
+        std::string const error = GetLastSocketError();
+        CloseSocket(result);
+        throw Exception(fmt::format("Unable to listen on {} ({})", path, error));
+    }
+
+    address = path;
+    return static_cast<std::intptr_t>(result);
+#endif
+}
+
+bool WaitForConnection(Detail::SocketHandle socket)
+{
+    fd_set sockets;
+    FD_ZERO(&sockets);
+    FD_SET(socket, &sockets);
+
+    timeval timeout = {};
+    timeout.tv_usec = Detail::AcceptTimeoutMicroseconds;
+
+    return ::select(static_cast<int>(socket) + 1, &sockets, nullptr, nullptr, &timeout) > 0;
+}
+
+// Request is a netstring of NUL-separated header names and values, followed by the body of CONTENT_LENGTH bytes;
+// returns false if request is incomplete yet
+bool ParseRequest(std::string_view request, std::string& body)
+{
+    std::size_t const colonPos = request.find(':');
+    if (colonPos == std::string_view::npos)
+    {
+        return false;
+    }
+
+    std::size_t headersSize = 0;
+    if (std::from_chars(request.data(), request.data() + colonPos, headersSize).ec != std::errc())
+    {
+        throw Exception("Malformed SCGI request headers length");
+    }
+
+    std::size_t const headersBegin = colonPos + 1;
+    std::size_t const bodyBegin = headersBegin + headersSize + 1;
+    if (request.size() < bodyBegin)
+    {
+        return false;
+    }
+
+    std::string_view const headers = request.substr(headersBegin, headersSize);
+    if (!headers.starts_with(Detail::ContentLengthHeader) || headers[Detail::ContentLengthHeader.size()] != '\0')
+    {
+        throw Exception("SCGI request does not start with CONTENT_LENGTH header");
+    }
+
+    std::size_t const valueBegin = Detail::ContentLengthHeader.size() + 1;
+    std::size_t bodySize = 0;
+    if (std::from_chars(headers.data() + valueBegin, headers.data() + headers.find('\0', valueBegin), bodySize).ec !=
+        std::errc())
+    {
+        throw Exception("Malformed SCGI request body length");
+    }
+
+    if (request.size() < bodyBegin + bodySize)
+    {
+        return false;
+    }
+
+    body = request.substr(bodyBegin, bodySize);
+    return true;
+}
+
+} // namespace
+
+FakeScgiServer::FakeScgiServer(Handler handler) :
+    m_handler(std::move(handler)),
+    m_socketPath(),
+    m_address(),
+    m_listenSocket(ListenTcp(m_address)),
+    m_isStopping(false),
+    m_thread(&FakeScgiServer::Serve, this)
+{
+    //
+}
+
+FakeScgiServer::FakeScgiServer(std::filesystem::path const& socketPath, Handler handler) :
+    m_handler(std::move(handler)),
+    m_socketPath(socketPath),
+    m_address(),
+    m_listenSocket(ListenLocal(m_socketPath, m_address)),
+    m_isStopping(false),
+    m_thread(&FakeScgiServer::Serve, this)
+{
+    //
+}
+
+FakeScgiServer::~FakeScgiServer()
+{
+    m_isStopping = true;
+    m_thread.join();
+
+    CloseSocket(ToHandle(m_listenSocket));
+
+    if (!m_socketPath.empty())
+    {
+        std::error_code error;
+        std::filesystem::remove(m_socketPath, error);
+    }
+}
+
+std::string const& FakeScgiServer::GetAddress() const
+{
+    return m_address;
+}
+
+void FakeScgiServer::Serve()
+{
+    while (!m_isStopping)
+    {
+        if (!WaitForConnection(ToHandle(m_listenSocket)))
+        {
+            continue;
+        }
+
+        Detail::SocketHandle const socket = ::accept(ToHandle(m_listenSocket), nullptr, nullptr);
+        if (socket == Detail::InvalidSocket)
+        {
+            continue;
+        }
+
+        // Client sees connection closed without response if anything goes wrong
+        try
+        {
+            ServeConnection(static_cast<std::intptr_t>(socket));
+        }
+        catch (std::exception const&)
+        {
+            //
+        }
+
+        CloseSocket(socket);
+    }
+}
+
+void FakeScgiServer::ServeConnection(std::intptr_t socket) const
+{
+    std::string request;
+    std::string requestBody;
+    std::array<char, Detail::IoChunkSize> buffer;
+    while (!ParseRequest(request, requestBody))
+    {
+        auto const receivedSize = ::recv(ToHandle(socket), buffer.data(), static_cast<int>(buffer.size()), 0);
+        if (receivedSize <= 0)
+        {
+            throw Exception(fmt::format("Unable to receive SCGI request ({})", GetLastSocketError()));
+        }
+
+        request.append(buffer.data(), static_cast<std::size_t>(receivedSize));
+    }
+
+    std::string const responseBody = m_handler(requestBody);
+    std::string const response = fmt::format("Status: 200 OK\r\nContent-Type: text/xml\r\nContent-Length: {}\r\n\r\n{}",
+        responseBody.size(), responseBody);
+
+    for (std::size_t offset = 0; offset < response.size();)
+    {
+        std::size_t const chunkSize = std::min<std::size_t>(response.size() - offset, Detail::IoChunkSize);
+        auto const sentSize = ::send(ToHandle(socket), response.data() + offset, static_cast<int>(chunkSize),
+            Detail::SendFlags);
+        if (sentSize <= 0)
+        {
+            throw Exception(fmt::format("Unable to send SCGI response ({})", GetLastSocketError()));
+        }
+
+        offset += static_cast<std::size_t>(sentSize);
+    }
+}
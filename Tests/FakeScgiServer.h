@@ -0,0 +1,58 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Server side of SCGI protocol, standing in for rTorrent in tests. Connections are accepted one at a time on a
+// background thread, each request body is passed to the handler, and whatever it returns is sent back as the response
+// body before the connection is closed.
+class FakeScgiServer
+{
+public:
+    typedef std::function<std::string(std::string const& requestBody)> Handler;
+
+public:
+    // Listens on loopback TCP port chosen by the system
+    explicit FakeScgiServer(Handler handler);
+    // Listens on Unix domain socket at given path
+    FakeScgiServer(std::filesystem::path const& socketPath, Handler handler);
+    ~FakeScgiServer();
+
+    FakeScgiServer(FakeScgiServer const&) = delete;
+    FakeScgiServer& operator=(FakeScgiServer const&) = delete;
+
+    // Suitable for ScgiClient, "<host>:<port>" or socket path
+    std::string const& GetAddress() const;
+
+private:
+    void Serve();
+    void ServeConnection(std::intptr_t socket) const;
+
+private:
+    Handler const m_handler;
+    std::filesystem::path const m_socketPath;
+    std::string m_address;
+    std::intptr_t const m_listenSocket;
+    std::atomic<bool> m_isStopping;
+    std::thread m_thread;
+};
@@ -0,0 +1,309 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+#include "Codec/PickleCodec.h"
+#include "Codec/PickleOpcode.h"
+#include "Codec/PickleWriter.h"
+#include "Common/Exception.h"
+#include "Common/IForwardIterator.h"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <span>
+#include <sstream>
+#include <string>
+
+namespace
+{
+namespace Detail
+{
+
+std::initializer_list<int> const Protocols = {2, 3, 4};
+
+std::string const TorrentsKey = "torrents";
+
+} // namespace Detail
+} // namespace
+
+namespace
+{
+
+std::string Encode(ojson const& root, int protocol)
+{
+    std::ostringstream stream;
+    PickleCodec(protocol).Encode(stream, root);
+    return stream.str();
+}
+
+ojson Decode(std::string const& data)
+{
+    ojson result;
+    PickleCodec().Decode(std::span<char const>(data), result);
+    return result;
+}
+
+template<typename FuncT>
+std::string Write(int protocol, FuncT&& func)
+{
+    std::ostringstream stream;
+    PickleWriter writer(stream, protocol);
+    func(writer);
+    writer.Finish();
+    return stream.str();
+}
+
+std::string MakeOpcode(int opcode, std::string_view argument)
+{
+    return static_cast<char>(opcode) + std::string(argument);
+}
+
+} // namespace
+
+TEST_CASE("Pickled values survive round trip", "[pickle]")
+{
+    ojson root = ojson::object();
+    root.insert_or_assign("none", ojson::null());
+    root.insert_or_assign("true", true);
+    root.insert_or_assign("false", false);
+    root.insert_or_assign("double", -1.5);
+    root.insert_or_assign("empty", "");
+    // "Üñï 😀" in UTF-8, spelled out to keep the source ASCII
+    root.insert_or_assign("text", "\xc3\x9c\xc3\xb1\xc3\xaf \xf0\x9f\x98\x80");
+    // Repeated strings are memoized
+    ojson list = ojson::array();
+    list.push_back("text");
+    list.push_back("empty");
+    list.push_back(ojson::array());
+    root.insert_or_assign("list", std::move(list));
+    root.insert_or_assign("dict", ojson::object());
+
+    ojson integers = ojson::array();
+    for (std::int64_t const value : {std::int64_t{0}, std::int64_t{255}, std::int64_t{256}, std::int64_t{65535},
+        std::int64_t{65536}, std::int64_t{-1}, std::int64_t{std::numeric_limits<std::int32_t>::min()},
+        std::int64_t{std::numeric_limits<std::int32_t>::max()}, std::int64_t{1} << 31, -(std::int64_t{1} << 40),
+        std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max()})
+    {
+        integers.push_back(value);
+    }
+    integers.push_back(std::numeric_limits<std::uint64_t>::max());
+    root.insert_or_assign("integers", std::move(integers));
+
+    for (int const protocol : Detail::Protocols)
+    {
+        CAPTURE(protocol);
+
+        std::string const data = Encode(root, protocol);
+        REQUIRE(data.starts_with(MakeOpcode(PickleOpcode::PROTO, std::string(1, static_cast<char>(protocol)))));
+        CHECK(data.back() == PickleOpcode::STOP);
+
+        CHECK(Decode(data) == root);
+    }
+}
+
+TEST_CASE("Pickled integers beyond 32 bits are written as LONG1", "[pickle]")
+{
+    auto const writeInteger = [](std::int64_t value)
+    {
+        return Write(2, [value](PickleWriter& writer) { writer.WriteInteger(value); });
+    };
+
+    std::string const header = MakeOpcode(PickleOpcode::PROTO, "\x02");
+    std::string const footer(1, PickleOpcode::STOP);
+
+    CHECK(writeInteger(std::int64_t{1} << 40) ==
+        header + MakeOpcode(PickleOpcode::LONG1, std::string("\x06\x00\x00\x00\x00\x00\x01", 7)) + footer);
+    CHECK(writeInteger(-(std::int64_t{1} << 40)) ==
+        header + MakeOpcode(PickleOpcode::LONG1, std::string("\x06\x00\x00\x00\x00\x00\xff", 7)) + footer);
+    // Extra byte keeps the sign right
+    CHECK(writeInteger(std::int64_t{1} << 47) ==
+        header + MakeOpcode(PickleOpcode::LONG1, std::string("\x07\x00\x00\x00\x00\x00\x80\x00", 8)) + footer);
+    CHECK(writeInteger(std::int64_t{1} << 31) ==
+        header + MakeOpcode(PickleOpcode::LONG1, std::string("\x05\x00\x00\x00\x80\x00", 6)) + footer);
+
+    std::string const unsignedData = Write(2,
+        [](PickleWriter& writer) { writer.WriteUnsigned(std::numeric_limits<std::uint64_t>::max()); });
+    CHECK(unsignedData ==
+        header + MakeOpcode(PickleOpcode::LONG1, "\x09\xff\xff\xff\xff\xff\xff\xff\xff" + std::string(1, '\0')) +
+        footer);
+
+    for (std::int64_t const value : {std::int64_t{1} << 40, -(std::int64_t{1} << 40), std::int64_t{1} << 47,
+        std::int64_t{1} << 31})
+    {
+        CAPTURE(value);
+        CHECK(Decode(writeInteger(value)).as<std::int64_t>() == value);
+    }
+
+    CHECK(Decode(unsignedData).as<std::uint64_t>() == std::numeric_limits<std::uint64_t>::max());
+}
+
+TEST_CASE("Pickled strings past 256th are memoized with 4-byte indices", "[pickle]")
+{
+    // Every string is repeated, so the second half only consists of memo lookups
+    ojson root = ojson::array();
+    for (std::size_t i = 0; i < 600; ++i)
+    {
+        root.push_back(fmt::format("string-{}", i));
+    }
+    for (std::size_t i = 0; i < 600; ++i)
+    {
+        root.push_back(fmt::format("string-{}", i));
+    }
+
+    std::string const longIndex("\x00\x01\x00\x00", 4);
+
+    for (int const protocol : Detail::Protocols)
+    {
+        CAPTURE(protocol);
+
+        std::string const data = Encode(root, protocol);
+        CHECK(data.find(MakeOpcode(PickleOpcode::LONG_BINGET, longIndex)) != std::string::npos);
+        if (protocol < 4)
+        {
+            CHECK(data.find(MakeOpcode(PickleOpcode::LONG_BINPUT, longIndex)) != std::string::npos);
+        }
+
+        CHECK(Decode(data) == root);
+    }
+}
+
+TEST_CASE("Pickled containers larger than batch survive round trip", "[pickle]")
+{
+    ojson torrents = ojson::array();
+    for (std::size_t i = 0; i < 2500; ++i)
+    {
+        ojson torrent = ojson::object();
+        torrent.insert_or_assign("torrent_id", fmt::format("{:040x}", i));
+        torrent.insert_or_assign("paused", i % 2 == 0);
+        torrents.push_back(std::move(torrent));
+    }
+
+    ojson files = ojson::object();
+    for (std::size_t i = 0; i < 1500; ++i)
+    {
+        files.insert_or_assign(fmt::format("file-{}", i), i);
+    }
+
+    ojson root = ojson::object();
+    root.insert_or_assign("files", std::move(files));
+    root.insert_or_assign(Detail::TorrentsKey, torrents);
+
+    for (int const protocol : Detail::Protocols)
+    {
+        CAPTURE(protocol);
+
+        std::string const data = Encode(root, protocol);
+        CHECK(Decode(data) == root);
+
+        // Incremental decoder has to see items of every APPENDS batch
+        auto const iterator = PickleCodec().DecodeList(data, Detail::TorrentsKey);
+        std::size_t count = 0;
+        ojson torrent;
+        while (iterator->GetNext(torrent))
+        {
+            REQUIRE(count < torrents.size());
+            CHECK(torrent == torrents[count]);
+            ++count;
+        }
+        CHECK(count == torrents.size());
+    }
+}
+
+TEST_CASE("Pickled objects are decoded as their state", "[pickle]")
+{
+    for (int const protocol : Detail::Protocols)
+    {
+        CAPTURE(protocol);
+
+        std::string const data = Write(protocol,
+            [](PickleWriter& writer)
+            {
+                writer.BeginObject("deluge.core.torrentmanager", "TorrentManagerState");
+                writer.WriteString(Detail::TorrentsKey);
+                writer.BeginList();
+                for (std::size_t i = 0; i < 300; ++i)
+                {
+                    writer.BeginObject("deluge.core.torrentmanager", "TorrentState");
+                    writer.WriteString("torrent_id");
+                    writer.WriteString(fmt::format("{:040x}", i));
+                    writer.EndObject();
+                }
+                writer.EndList();
+                writer.EndObject();
+            });
+
+        ojson const root = Decode(data);
+        REQUIRE(root[Detail::TorrentsKey].size() == 300);
+        CHECK(root[Detail::TorrentsKey][299]["torrent_id"].as<std::string>() == fmt::format("{:040x}", 299));
+    }
+}
+
+TEST_CASE("Protocol 4 pickles are split into frames", "[pickle]")
+{
+    ojson root = ojson::array();
+    for (std::size_t i = 0; i < 5000; ++i)
+    {
+        root.push_back(fmt::format("{:064x}", i));
+    }
+
+    std::string const data = Encode(root, 4);
+
+    // Frames have to follow each other back to back, with nothing but protocol opcode before the first one
+    std::size_t frameCount = 0;
+    std::size_t offset = 2;
+    while (offset < data.size())
+    {
+        REQUIRE(data[offset] == static_cast<char>(PickleOpcode::FRAME));
+        REQUIRE(data.size() - offset > 9);
+
+        std::uint64_t frameSize = 0;
+        for (std::size_t i = 8; i > 0; --i)
+        {
+            frameSize = (frameSize << 8) | static_cast<std::uint8_t>(data[offset + i]);
+        }
+
+        offset += 9 + frameSize;
+        ++frameCount;
+    }
+
+    CHECK(offset == data.size());
+    CHECK(frameCount > 3);
+    CHECK(Decode(data) == root);
+
+    CHECK(Encode(root, 3)[2] != static_cast<char>(PickleOpcode::FRAME));
+}
+
+TEST_CASE("Pickle writer rejects unbalanced values", "[pickle]")
+{
+    std::ostringstream stream;
+
+    CHECK_THROWS_AS(PickleWriter(stream, 1), Exception);
+    CHECK_THROWS_AS(PickleWriter(stream, 5), Exception);
+
+    CHECK_THROWS_AS(Write(2, [](PickleWriter& writer) { writer.BeginList(); }), Exception);
+    CHECK_THROWS_AS(Write(2, [](PickleWriter& writer) { writer.BeginList(); writer.EndDict(); }), Exception);
+    CHECK_THROWS_AS(Write(2, [](PickleWriter& writer) { writer.BeginDict(); writer.WriteNone(); writer.EndDict(); }),
+        Exception);
+    CHECK_THROWS_AS(Write(2, [](PickleWriter& writer) { writer.WriteNone(); writer.WriteNone(); }), Exception);
+    CHECK_THROWS_AS(Write(2, [](PickleWriter&) {}), Exception);
+}
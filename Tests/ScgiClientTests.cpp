@@ -0,0 +1,118 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FakeScgiServer.h"
+
+#include "Common/Exception.h"
+#include "Common/ScgiClient.h"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+namespace Detail
+{
+
+std::chrono::milliseconds const ClientTimeout = std::chrono::milliseconds(100);
+std::chrono::milliseconds const StallDuration = std::chrono::milliseconds(1000);
+
+} // namespace Detail
+} // namespace
+
+namespace
+{
+
+std::string GetSendError(ScgiClient const& client, std::string const& body)
+{
+    try
+    {
+        client.Send(body);
+    }
+    catch (Exception const& e)
+    {
+        return e.what();
+    }
+
+    return {};
+}
+
+} // namespace
+
+TEST_CASE("SCGI client round trip", "[SCGI]")
+{
+    auto const handler = [](std::string const& requestBody) { return "echo: " + requestBody; };
+
+    // Larger than a single send/receive chunk
+    std::string const body = std::string(200 * 1024, 'x') + "end";
+
+    SECTION("over TCP")
+    {
+        FakeScgiServer const server(handler);
+        CHECK(ScgiClient(server.GetAddress(), Detail::ClientTimeout).Send(body) == "echo: " + body);
+    }
+
+#ifndef _WIN32
+    SECTION("over Unix domain socket")
+    {
+        fs::path const socketPath = fs::temp_directory_path() /
+            fmt::format("bt-migrate-test-{:08x}.socket", std::random_device()());
+        FakeScgiServer const server(socketPath, handler);
+        CHECK(ScgiClient(server.GetAddress(), Detail::ClientTimeout).Send(body) == "echo: " + body);
+    }
+#endif
+}
+
+TEST_CASE("SCGI client gives up on unresponsive server", "[SCGI]")
+{
+    FakeScgiServer const server(
+        [](std::string const& requestBody)
+        {
+            std::this_thread::sleep_for(Detail::StallDuration);
+            return requestBody;
+        });
+
+    auto const startTime = std::chrono::steady_clock::now();
+    std::string const error = GetSendError(ScgiClient(server.GetAddress(), Detail::ClientTimeout), "ping");
+    auto const duration = std::chrono::steady_clock::now() - startTime;
+
+    CHECK(error.find("did not respond within 100 ms") != std::string::npos);
+    CHECK(duration < Detail::StallDuration);
+}
+
+#ifndef _WIN32
+TEST_CASE("SCGI client fails to connect to missing server", "[SCGI]")
+{
+    fs::path const socketPath = fs::temp_directory_path() /
+        fmt::format("bt-migrate-test-{:08x}.socket", std::random_device()());
+    std::string const error = GetSendError(ScgiClient(socketPath.string(), Detail::ClientTimeout), "ping");
+
+    CHECK(error.find("Unable to connect to SCGI server") != std::string::npos);
+}
+#endif
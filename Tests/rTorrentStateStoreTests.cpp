@@ -0,0 +1,675 @@
+// bt-migrate, torrent state migration tool
+// Copyright (C) 2026 Mike Gelfand <mikedld@mikedld.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FakeScgiServer.h"
+
+#include "Common/Exception.h"
+#include "Common/IFileStreamProvider.h"
+#include "Common/IForwardIterator.h"
+#include "Common/MappedFile.h"
+#include "Store/rTorrentStateStore.h"
+#include "Torrent/Box.h"
+#include "Torrent/TorrentInfo.h"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <fmt/format.h>
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+namespace Detail
+{
+
+// Once the torrent with unknown bitfield is skipped, one more than files and trackers are fetched for in a single
+// system.multicall round trip
+std::size_t const TorrentCount = 1002;
+std::size_t const MulticallBatchSize = 1000;
+
+std::uint32_t const PieceSize = 16 * 1024;
+
+std::string const DhtTrackerUrl = "dht://";
+std::string const DisabledTrackerUrl = "http://disabled.example/announce";
+
+int const NoSuchInfoHashFaultCode = -501;
+std::string const NoSuchInfoHashFaultString = "Could not find info-hash.";
+int const NoSuchMethodFaultCode = -506;
+
+} // namespace Detail
+} // namespace
+
+namespace
+{
+
+struct FakeTorrent
+{
+    std::string InfoHash;
+    fs::path SessionFilePath;
+    std::string Directory;
+    long long Priority;
+    long long State;
+    long long TimestampStarted;
+    long long TimestampFinished;
+    long long TotalUploaded;
+    std::string Bitfield;
+    long long IsComplete;
+    long long CompletedChunks;
+    std::vector<long long> FilePriorities;
+    std::vector<std::pair<std::string, long long>> Trackers;
+    // Expected results
+    bool IsExported;
+    std::vector<bool> ValidPieces;
+};
+
+// Three pieces over two files
+std::string MakeTorrentData(std::size_t index)
+{
+    std::string const name = fmt::format("torrent-{}", index);
+    std::string const announceUrl = fmt::format("http://tracker.example/{}/announce", index);
+    return fmt::format("d8:announce{}:{}4:infod5:filesl"
+        "d6:lengthi{}e4:pathl5:a.binee"
+        "d6:lengthi{}e4:pathl3:sub5:b.binee"
+        "e4:name{}:{}12:piece lengthi{}e6:pieces60:{}ee",
+        announceUrl.size(), announceUrl, Detail::PieceSize, Detail::PieceSize * 2, name.size(), name, Detail::PieceSize,
+        std::string(60, 'x'));
+}
+
+std::vector<FakeTorrent> MakeFakeTorrents(fs::path const& sessionDir, std::size_t count)
+{
+    std::vector<FakeTorrent> result;
+    result.reserve(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::string torrentData = MakeTorrentData(i);
+
+        // rTorrent reports infohashes in upper case
+        std::string infoHash = TorrentInfo::Decode(std::string(torrentData)).GetInfoHash();
+        std::transform(infoHash.begin(), infoHash.end(), infoHash.begin(),
+            [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+
+        FakeTorrent torrent;
+        torrent.InfoHash = infoHash;
+        torrent.SessionFilePath = sessionDir / (infoHash + ".torrent");
+        torrent.Directory = fmt::format("/downloads/torrent-{}", i);
+        torrent.Priority = static_cast<long long>(i % 3);
+        torrent.State = i % 5 == 0 ? 0 : 1;
+        torrent.TimestampStarted = 1600000000 + static_cast<long long>(i);
+        torrent.TimestampFinished = i % 2 == 0 ? 0 : 1600100000 + static_cast<long long>(i);
+        // Beyond 32 bits, so only fits into <i8>
+        torrent.TotalUploaded = 5000000000LL + static_cast<long long>(i);
+        torrent.IsExported = true;
+
+        // Hex bitfield is MSB-first, one bit per piece; closed downloads have none
+        switch (i)
+        {
+        case 3:
+            torrent.Bitfield = "";
+            torrent.IsComplete = 1;
+            torrent.CompletedChunks = 3;
+            torrent.ValidPieces = {true, true, true};
+            break;
+        case 5:
+            torrent.Bitfield = "";
+            torrent.IsComplete = 0;
+            torrent.CompletedChunks = 0;
+            torrent.ValidPieces = {false, false, false};
+            break;
+        case 7:
+            torrent.Bitfield = "";
+            torrent.IsComplete = 0;
+            torrent.CompletedChunks = 1;
+            torrent.IsExported = false;
+            break;
+        default:
+            torrent.Bitfield = i % 2 == 0 ? "A0" : "e0";
+            torrent.IsComplete = i % 2 == 0 ? 0 : 1;
+            torrent.CompletedChunks = i % 2 == 0 ? 2 : 3;
+            torrent.ValidPieces = i % 2 == 0 ? std::vector<bool>{true, false, true} :
+                std::vector<bool>{true, true, true};
+            break;
+        }
+
+        torrent.FilePriorities = {static_cast<long long>(i % 3), static_cast<long long>((i + 1) % 3)};
+        torrent.Trackers = {
+            {fmt::format("http://tracker.example/{}/announce", i), 1},
+            {Detail::DisabledTrackerUrl, 0},
+            {Detail::DhtTrackerUrl, 1}
+        };
+
+        std::ofstream stream(torrent.SessionFilePath, std::ios_base::out | std::ios_base::binary);
+        stream << torrentData;
+
+        result.push_back(std::move(torrent));
+    }
+
+    return result;
+}
+
+std::string ToXmlValue(std::string_view value)
+{
+    return fmt::format("<value><string>{}</string></value>", value);
+}
+
+// rTorrent built with 64-bit integer support returns all integers this way
+std::string ToXmlValue(long long value)
+{
+    return fmt::format("<value><i8>{}</i8></value>", value);
+}
+
+std::string ToXmlArray(std::vector<std::string> const& values)
+{
+    std::string result = "<value><array><data>";
+    for (std::string const& value : values)
+    {
+        result += value;
+    }
+    result += "</data></array></value>";
+    return result;
+}
+
+std::string ToXmlFault(int code, std::string_view text)
+{
+    return fmt::format("<value><struct>"
+        "<member><name>faultCode</name><value><i4>{}</i4></value></member>"
+        "<member><name>faultString</name>{}</member>"
+        "</struct></value>", code, ToXmlValue(text));
+}
+
+std::string MakeResponse(std::string const& value)
+{
+    return fmt::format("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<methodResponse><params><param>{}</param></params></methodResponse>", value);
+}
+
+std::string MakeFaultResponse(int code, std::string_view text)
+{
+    return fmt::format("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<methodResponse><fault>{}</fault></methodResponse>", ToXmlFault(code, text));
+}
+
+std::vector<std::string> GetStringParams(pugi::xml_node const& params)
+{
+    std::vector<std::string> result;
+    for (pugi::xml_node param = params.first_child(); param; param = param.next_sibling())
+    {
+        pugi::xml_node const value = param.name() == std::string_view("param") ? param.child("value") : param;
+        result.emplace_back(value.child("string") ? value.child("string").child_value() : value.child_value());
+    }
+
+    return result;
+}
+
+pugi::xml_node GetStructMember(pugi::xml_node const& value, std::string_view name)
+{
+    for (pugi::xml_node member = value.child("struct").first_child(); member; member = member.next_sibling())
+    {
+        if (member.child_value("name") == name)
+        {
+            return member.child("value");
+        }
+    }
+
+    return {};
+}
+
+// Answers d.multicall2 and system.multicall of f.multicall and t.multicall calls from the list of torrents, with
+// columns in whatever order they are requested
+class FakeRTorrent
+{
+public:
+    explicit FakeRTorrent(std::vector<FakeTorrent> torrents) :
+        m_torrents(std::move(torrents)),
+        m_isDownloadListFaulty(false),
+        m_faultyTrackersInfoHash(),
+        m_multicallSizes(),
+        m_mutex()
+    {
+        //
+    }
+
+    std::vector<FakeTorrent> const& GetTorrents() const
+    {
+        return m_torrents;
+    }
+
+    void SetBitfield(std::string const& infoHash, std::string const& bitfield)
+    {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        for (FakeTorrent& torrent : m_torrents)
+        {
+            if (torrent.InfoHash == infoHash)
+            {
+                torrent.Bitfield = bitfield;
+            }
+        }
+    }
+
+    void SetDownloadListFaulty()
+    {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        m_isDownloadListFaulty = true;
+    }
+
+    void SetTrackersFaulty(std::string const& infoHash)
+    {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        m_faultyTrackersInfoHash = infoHash;
+    }
+
+    // Number of calls in each system.multicall request received so far
+    std::vector<std::size_t> GetMulticallSizes() const
+    {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        return m_multicallSizes;
+    }
+
+    std::string HandleRequest(std::string const& requestBody)
+    {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+
+        pugi::xml_document doc;
+        if (!doc.load_buffer(requestBody.data(), requestBody.size()))
+        {
+            throw Exception("Malformed XML-RPC request");
+        }
+
+        pugi::xml_node const call = doc.child("methodCall");
+        std::string_view const methodName = call.child_value("methodName");
+
+        if (methodName == "d.multicall2")
+        {
+            return HandleDownloadMulticall(GetStringParams(call.child("params")));
+        }
+
+        if (methodName == "system.multicall")
+        {
+            return HandleSystemMulticall(call.child("params").child("param").child("value"));
+        }
+
+        return MakeFaultResponse(Detail::NoSuchMethodFaultCode, fmt::format("Method '{}' not defined", methodName));
+    }
+
+private:
+    std::string HandleDownloadMulticall(std::vector<std::string> const& params)
+    {
+        if (m_isDownloadListFaulty || params.size() < 2 || params[1] != "main")
+        {
+            return MakeFaultResponse(Detail::NoSuchMethodFaultCode, "Method 'd.multicall2' not defined");
+        }
+
+        std::vector<std::string> rows;
+        for (FakeTorrent const& torrent : m_torrents)
+        {
+            std::vector<std::string> columns;
+            for (auto it = params.begin() + 2; it != params.end(); ++it)
+            {
+                columns.push_back(GetDownloadValue(torrent, *it));
+            }
+
+            rows.push_back(ToXmlArray(columns));
+        }
+
+        return MakeResponse(ToXmlArray(rows));
+    }
+
+    std::string HandleSystemMulticall(pugi::xml_node const& calls)
+    {
+        std::vector<std::string> results;
+        for (pugi::xml_node call = calls.child("array").child("data").first_child(); call; call = call.next_sibling())
+        {
+            std::string_view const methodName = GetStructMember(call, "methodName").child_value("string");
+            std::vector<std::string> const params = GetStringParams(GetStructMember(call, "params").child("array")
+                .child("data"));
+
+            auto const torrentIt = std::find_if(m_torrents.begin(), m_torrents.end(),
+                [&params](FakeTorrent const& torrent) { return !params.empty() && torrent.InfoHash == params[0]; });
+
+            if (torrentIt == m_torrents.end() || (methodName == "t.multicall" && params[0] == m_faultyTrackersInfoHash))
+            {
+                results.push_back(ToXmlFault(Detail::NoSuchInfoHashFaultCode, Detail::NoSuchInfoHashFaultString));
+            }
+            else if (methodName == "f.multicall")
+            {
+                results.push_back(ToXmlArray({HandleFileMulticall(*torrentIt, params)}));
+            }
+            else if (methodName == "t.multicall")
+            {
+                results.push_back(ToXmlArray({HandleTrackerMulticall(*torrentIt, params)}));
+            }
+            else
+            {
+                results.push_back(ToXmlFault(Detail::NoSuchMethodFaultCode,
+                    fmt::format("Method '{}' not defined", methodName)));
+            }
+        }
+
+        m_multicallSizes.push_back(results.size());
+        return MakeResponse(ToXmlArray(results));
+    }
+
+    static std::string HandleFileMulticall(FakeTorrent const& torrent, std::vector<std::string> const& params)
+    {
+        std::vector<std::string> rows;
+        for (long long const priority : torrent.FilePriorities)
+        {
+            std::vector<std::string> columns;
+            for (auto it = params.begin() + 2; it != params.end(); ++it)
+            {
+                columns.push_back(*it == "f.priority=" ? ToXmlValue(priority) : ToXmlValue(""));
+            }
+
+            rows.push_back(ToXmlArray(columns));
+        }
+
+        return ToXmlArray(rows);
+    }
+
+    static std::string HandleTrackerMulticall(FakeTorrent const& torrent, std::vector<std::string> const& params)
+    {
+        std::vector<std::string> rows;
+        for (auto const& [url, isEnabled] : torrent.Trackers)
+        {
+            std::vector<std::string> columns;
+            for (auto it = params.begin() + 2; it != params.end(); ++it)
+            {
+                columns.push_back(*it == "t.url=" ? ToXmlValue(url) :
+                    (*it == "t.is_enabled=" ? ToXmlValue(isEnabled) : ToXmlValue("")));
+            }
+
+            rows.push_back(ToXmlArray(columns));
+        }
+
+        return ToXmlArray(rows);
+    }
+
+    static std::string GetDownloadValue(FakeTorrent const& torrent, std::string_view command)
+    {
+        if (command == "d.hash=")
+        {
+            return ToXmlValue(torrent.InfoHash);
+        }
+
+        if (command == "d.session_file=")
+        {
+            return ToXmlValue(torrent.SessionFilePath.string());
+        }
+
+        if (command == "d.directory=")
+        {
+            return ToXmlValue(torrent.Directory);
+        }
+
+        if (command == "d.priority=")
+        {
+            return ToXmlValue(torrent.Priority);
+        }
+
+        if (command == "d.state=")
+        {
+            return ToXmlValue(torrent.State);
+        }
+
+        if (command == "d.timestamp.started=")
+        {
+            return ToXmlValue(torrent.TimestampStarted);
+        }
+
+        if (command == "d.timestamp.finished=")
+        {
+            return ToXmlValue(torrent.TimestampFinished);
+        }
+
+        if (command == "d.up.total=")
+        {
+            return ToXmlValue(torrent.TotalUploaded);
+        }
+
+        if (command == "d.bitfield=")
+        {
+            return ToXmlValue(torrent.Bitfield);
+        }
+
+        if (command == "d.complete=")
+        {
+            return ToXmlValue(torrent.IsComplete);
+        }
+
+        if (command == "d.completed_chunks=")
+        {
+            return ToXmlValue(torrent.CompletedChunks);
+        }
+
+        return ToXmlValue("");
+    }
+
+private:
+    std::vector<FakeTorrent> m_torrents;
+    bool m_isDownloadListFaulty;
+    std::string m_faultyTrackersInfoHash;
+    std::vector<std::size_t> m_multicallSizes;
+    std::mutex mutable m_mutex;
+};
+
+class TestFileStreamProvider : public IFileStreamProvider
+{
+public:
+    IReadStreamPtr GetReadStream(fs::path const& path) const override
+    {
+        auto result = std::make_unique<std::ifstream>(path, std::ios_base::in | std::ios_base::binary);
+        if (!result->is_open())
+        {
+            throw Exception(fmt::format("Unable to open file for reading: {}", path.string()));
+        }
+
+        return result;
+    }
+
+    MappedFilePtr GetMappedFile(fs::path const& path) const override
+    {
+        return std::make_unique<MappedFile const>(path);
+    }
+
+    IWriteStreamPtr GetWriteStream(fs::path const& path) override
+    {
+        throw Exception(fmt::format("Unexpected write to {}", path.string()));
+    }
+};
+
+class TemporaryDirectory
+{
+public:
+    TemporaryDirectory() :
+        m_path(fs::temp_directory_path() / fmt::format("bt-migrate-test-{:08x}", std::random_device()()))
+    {
+        fs::create_directories(m_path);
+    }
+
+    ~TemporaryDirectory()
+    {
+        std::error_code error;
+        fs::remove_all(m_path, error);
+    }
+
+    TemporaryDirectory(TemporaryDirectory const&) = delete;
+    TemporaryDirectory& operator=(TemporaryDirectory const&) = delete;
+
+    fs::path const& GetPath() const
+    {
+        return m_path;
+    }
+
+private:
+    fs::path const m_path;
+};
+
+// Keyed by infohash as reported by the torrent itself (lower case)
+std::map<std::string, Box> ExportBoxes(std::string const& scgiAddress)
+{
+    TestFileStreamProvider const fileStreamProvider;
+
+    ITorrentStateIteratorPtr const boxes = rTorrentStateStore(scgiAddress).Export({}, fileStreamProvider);
+
+    std::map<std::string, Box> result;
+    for (Box box; boxes->GetNext(box); box = Box())
+    {
+        std::string infoHash = box.Torrent.GetInfoHash();
+        result.emplace(std::move(infoHash), std::move(box));
+    }
+
+    return result;
+}
+
+std::string GetExportError(std::string const& scgiAddress)
+{
+    try
+    {
+        ExportBoxes(scgiAddress);
+    }
+    catch (Exception const& e)
+    {
+        return e.what();
+    }
+
+    return {};
+}
+
+std::string ToLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(),
+        [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    return text;
+}
+
+void CheckExportedBoxes(FakeRTorrent const& rtorrent, std::map<std::string, Box> const& boxes)
+{
+    std::size_t const exportedCount = std::count_if(rtorrent.GetTorrents().begin(), rtorrent.GetTorrents().end(),
+        [](FakeTorrent const& torrent) { return torrent.IsExported; });
+    REQUIRE(boxes.size() == exportedCount);
+
+    for (FakeTorrent const& torrent : rtorrent.GetTorrents())
+    {
+        auto const boxIt = boxes.find(ToLower(torrent.InfoHash));
+        if (!torrent.IsExported)
+        {
+            CHECK(boxIt == boxes.end());
+            continue;
+        }
+
+        REQUIRE(boxIt != boxes.end());
+
+        Box const& box = boxIt->second;
+
+        CHECK(box.SavePath == fs::path(torrent.Directory));
+        CHECK(box.IsPaused == (torrent.Priority == 0 || torrent.State == 0));
+        CHECK(box.AddedAt == torrent.TimestampStarted);
+        CHECK(box.CompletedAt == torrent.TimestampFinished);
+        CHECK(box.UploadedSize == static_cast<std::uint64_t>(torrent.TotalUploaded));
+        CHECK(box.BlockSize == Detail::PieceSize);
+
+        CHECK(box.ValidBlocks == torrent.ValidPieces);
+
+        REQUIRE(box.Files.size() == torrent.FilePriorities.size());
+        for (std::size_t i = 0; i < box.Files.size(); ++i)
+        {
+            long long const priority = torrent.FilePriorities[i];
+            CHECK(box.Files[i].DoNotDownload == (priority == 0));
+            CHECK(box.Files[i].Priority == (priority == 2 ? Box::MaxPriority : Box::NormalPriority));
+        }
+
+        // Disabled trackers and DHT pseudo-tracker are left out
+        std::vector<std::vector<std::string>> const expectedTrackers = {{torrent.Trackers.front().first}};
+        CHECK(box.Trackers == expectedTrackers);
+    }
+
+    CHECK(rtorrent.GetMulticallSizes() == std::vector<std::size_t>{Detail::MulticallBatchSize * 2, 2});
+}
+
+} // namespace
+
+TEST_CASE("rTorrent state is exported over SCGI", "[rTorrent][SCGI]")
+{
+    TemporaryDirectory const sessionDir;
+    FakeRTorrent rtorrent(MakeFakeTorrents(sessionDir.GetPath(), Detail::TorrentCount));
+    auto const handler = [&rtorrent](std::string const& requestBody) { return rtorrent.HandleRequest(requestBody); };
+
+    SECTION("over TCP")
+    {
+        FakeScgiServer const server(handler);
+        CheckExportedBoxes(rtorrent, ExportBoxes(server.GetAddress()));
+    }
+
+#ifndef _WIN32
+    SECTION("over Unix domain socket")
+    {
+        FakeScgiServer const server(sessionDir.GetPath() / "rpc.socket", handler);
+        CheckExportedBoxes(rtorrent, ExportBoxes(server.GetAddress()));
+    }
+#endif
+}
+
+TEST_CASE("rTorrent export over SCGI fails on bad responses", "[rTorrent][SCGI]")
+{
+    TemporaryDirectory const sessionDir;
+    FakeRTorrent rtorrent(MakeFakeTorrents(sessionDir.GetPath(), Detail::TorrentCount));
+    FakeScgiServer const server(
+        [&rtorrent](std::string const& requestBody) { return rtorrent.HandleRequest(requestBody); });
+
+    SECTION("XML-RPC fault of the whole call")
+    {
+        rtorrent.SetDownloadListFaulty();
+
+        std::string const error = GetExportError(server.GetAddress());
+        CHECK(error.find(fmt::format("XML-RPC fault {}", Detail::NoSuchMethodFaultCode)) != std::string::npos);
+        CHECK(rtorrent.GetMulticallSizes().empty());
+    }
+
+    SECTION("odd-length bitfield")
+    {
+        rtorrent.SetBitfield(rtorrent.GetTorrents().front().InfoHash, "A");
+
+        std::string const error = GetExportError(server.GetAddress());
+        CHECK(error.find("Invalid bitfield") != std::string::npos);
+        CHECK(rtorrent.GetMulticallSizes().empty());
+    }
+
+    SECTION("XML-RPC fault of a single call in the second batch")
+    {
+        rtorrent.SetTrackersFaulty(rtorrent.GetTorrents().back().InfoHash);
+
+        std::string const error = GetExportError(server.GetAddress());
+        CHECK(error.find("XML-RPC fault in t.multicall") != std::string::npos);
+        CHECK(error.find(Detail::NoSuchInfoHashFaultString) != std::string::npos);
+        CHECK(rtorrent.GetMulticallSizes() == std::vector<std::size_t>{Detail::MulticallBatchSize * 2, 2});
+    }
+}
@@ -17,30 +17,147 @@
 #include "TorrentInfo.h"
 
 #include "Codec/BencodeCodec.h"
-#include "Codec/IStructuredDataCodec.h"
+#include "Codec/BencodeDataCursor.h"
+#include "Codec/BencodeDocument.h"
 #include "Common/Exception.h"
 #include "Common/Util.h"
 
 #include <fmt/format.h>
 
 #include <filesystem>
-#include <sstream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <utility>
 
 namespace fs = std::filesystem;
 
 namespace
 {
+namespace Detail
+{
+
+namespace TorrentField
+{
+
+std::string const Announce = "announce";
+std::string const AnnounceList = "announce-list";
+
+} // namespace TorrentField
+
+} // namespace Detail
+} // namespace
+
+namespace
+{
+
+using Trackers = std::vector<std::vector<std::string>>;
 
-std::string CalculateInfoHash(ojson const& torrent)
+std::string CalculateInfoHash(BencodeDocument const& torrent)
 {
-    if (!torrent.contains("info"))
+    BencodeValue const info = torrent.GetRoot().Find("info");
+    if (!info.IsDictionary())
     {
         throw Exception("Torrent file is missing info dictionary");
     }
 
-    std::ostringstream infoStream;
-    BencodeCodec().Encode(infoStream, torrent["info"]);
-    return Util::CalculateSha1(infoStream.str());
+    // Hashing original bytes is both cheaper than re-encoding and correct for torrents with non-canonical encoding
+    std::span<char const> const data = info.GetRawData();
+    return Util::CalculateSha1({data.data(), data.size()});
+}
+
+std::shared_ptr<BencodeDocument const> EncodeTorrent(ojson const& torrent)
+{
+    std::string data;
+    BencodeCodec().Encode(data, torrent);
+    return std::make_shared<BencodeDocument const>(std::move(data), BencodeDocument::Mode::Lazy);
+}
+
+Trackers ReadTrackers(BencodeValue const& torrent)
+{
+    namespace TField = Detail::TorrentField;
+
+    Trackers result;
+
+    if (BencodeValue const announceList = torrent.Find(TField::AnnounceList); announceList.IsList())
+    {
+        for (std::size_t i = 0, tierCount = announceList.GetSize(); i < tierCount; ++i)
+        {
+            BencodeValue const tier = announceList[i];
+
+            auto& resultTier = result.emplace_back();
+            for (std::size_t j = 0, urlCount = tier.GetSize(); j < urlCount; ++j)
+            {
+                resultTier.emplace_back(tier[j].AsString());
+            }
+        }
+    }
+    else if (BencodeValue const announce = torrent.Find(TField::Announce); announce.IsString())
+    {
+        result.push_back({std::string(announce.AsString())});
+    }
+
+    return result;
+}
+
+// Copies top-level entries other than announce and announce-list byte for byte, inserting new ones in sorted order
+std::string SpliceTrackers(std::span<char const> torrent, Trackers const& trackers)
+{
+    namespace TField = Detail::TorrentField;
+
+    ojson announceList = ojson::array();
+    for (auto const& tier : trackers)
+    {
+        announceList.emplace_back(tier);
+    }
+
+    std::vector<std::pair<std::string_view, std::string>> newEntries;
+    newEntries.emplace_back(TField::AnnounceList, std::string());
+    BencodeCodec().Encode(newEntries.back().second, announceList);
+    if (!trackers.empty() && !trackers.front().empty())
+    {
+        newEntries.emplace(newEntries.begin(), TField::Announce, std::string());
+        BencodeCodec().Encode(newEntries.front().second, ojson(trackers.front().front()));
+    }
+
+    std::string result;
+    result.reserve(torrent.size() + newEntries.front().second.size() + newEntries.back().second.size());
+    result += 'd';
+
+    auto newEntryIt = newEntries.begin();
+    auto const appendNewEntriesBefore = [&](std::optional<std::string_view> key)
+    {
+        for (; newEntryIt != newEntries.end() && (!key.has_value() || newEntryIt->first < *key); ++newEntryIt)
+        {
+            result += std::to_string(newEntryIt->first.size());
+            result += ':';
+            result += newEntryIt->first;
+            result += newEntryIt->second;
+        }
+    };
+
+    BencodeDataCursor cursor(torrent);
+    cursor.Get();
+
+    while (cursor.Peek() != 'e')
+    {
+        char const* const entryBegin = cursor.GetPosition();
+        std::string_view const key = cursor.GetString();
+        cursor.SkipValue(BencodeCodec::DefaultMaxDepth);
+
+        if (key == TField::Announce || key == TField::AnnounceList)
+        {
+            continue;
+        }
+
+        appendNewEntriesBefore(key);
+        result.append(entryBegin, cursor.GetPosition());
+    }
+
+    appendNewEntriesBefore(std::nullopt);
+
+    result += 'e';
+    return result;
 }
 
 } // namespace
@@ -48,15 +165,27 @@ std::string CalculateInfoHash(ojson const& torrent)
 TorrentInfo::TorrentInfo() = default;
 
 TorrentInfo::TorrentInfo(ojson const& torrent) :
-    m_torrent(torrent),
-    m_infoHash(CalculateInfoHash(m_torrent))
+    TorrentInfo(EncodeTorrent(torrent))
 {
     //
 }
 
-void TorrentInfo::Encode(std::ostream& stream, IStructuredDataCodec const& codec) const
+TorrentInfo::TorrentInfo(std::shared_ptr<BencodeDocument const> torrent) :
+    m_torrent(std::move(torrent)),
+    m_infoHash(CalculateInfoHash(*m_torrent))
 {
-    codec.Encode(stream, m_torrent);
+    //
+}
+
+void TorrentInfo::Encode(std::ostream& stream) const
+{
+    if (m_torrent == nullptr)
+    {
+        throw Exception("Torrent is empty");
+    }
+
+    std::span<char const> const data = m_torrent->GetData();
+    stream.write(data.data(), static_cast<std::streamsize>(data.size()));
 }
 
 std::string const& TorrentInfo::GetInfoHash() const
@@ -68,17 +197,18 @@ std::uint64_t TorrentInfo::GetTotalSize() const
 {
     std::uint64_t result = 0;
 
-    ojson const& info = m_torrent["info"];
+    BencodeValue const info = GetInfo();
+    BencodeValue const files = info.Find("files");
 
-    if (!info.contains("files"))
+    if (files.IsNull())
     {
-        result += info["length"].as<std::uint64_t>();
+        result += info["length"].AsInteger();
     }
     else
     {
-        for (ojson const& file : info["files"].array_range())
+        for (std::size_t i = 0, count = files.GetSize(); i < count; ++i)
         {
-            result += file["length"].as<std::uint64_t>();
+            result += files[i]["length"].AsInteger();
         }
     }
 
@@ -87,25 +217,32 @@ std::uint64_t TorrentInfo::GetTotalSize() const
 
 std::uint32_t TorrentInfo::GetPieceSize() const
 {
-    ojson const& info = m_torrent["info"];
-
-    return info["piece length"].as<std::uint32_t>();
+    return static_cast<std::uint32_t>(GetInfo()["piece length"].AsInteger());
 }
 
 std::string TorrentInfo::GetName() const
 {
-    ojson const& info = m_torrent["info"];
+    return std::string(GetInfo()["name"].AsString());
+}
 
-    return info["name"].as<std::string>();
+bool TorrentInfo::IsMultiFile() const
+{
+    return !GetInfo().Find("files").IsNull();
+}
+
+std::size_t TorrentInfo::GetFileCount() const
+{
+    BencodeValue const files = GetInfo().Find("files");
+    return files.IsNull() ? 1 : files.GetSize();
 }
 
 fs::path TorrentInfo::GetFilePath(std::size_t fileIndex) const
 {
     fs::path result;
 
-    ojson const& info = m_torrent["info"];
+    BencodeValue const files = GetInfo().Find("files");
 
-    if (!info.contains("files"))
+    if (files.IsNull())
     {
         if (fileIndex != 0)
         {
@@ -116,48 +253,55 @@ fs::path TorrentInfo::GetFilePath(std::size_t fileIndex) const
     }
     else
     {
-        ojson const& files = info["files"];
-
-        if (fileIndex >= files.size())
+        if (fileIndex >= files.GetSize())
         {
             throw Exception(fmt::format("Torrent file #{} does not exist", fileIndex));
         }
 
-        for (ojson const& pathPart : files[fileIndex]["path"].array_range())
+        BencodeValue const path = files[fileIndex]["path"];
+        for (std::size_t i = 0, count = path.GetSize(); i < count; ++i)
         {
-            result /= pathPart.as<std::string>();
+            result /= path[i].AsString();
         }
     }
 
     return result;
 }
 
-void TorrentInfo::SetTrackers(std::vector<std::vector<std::string>> const& trackers)
+std::vector<std::vector<std::string>> TorrentInfo::GetTrackers() const
 {
-    ojson announceList = ojson::array();
+    return m_torrent != nullptr ? ReadTrackers(m_torrent->GetRoot()) : Trackers();
+}
 
-    for (auto const& tier : trackers)
+void TorrentInfo::SetTrackers(std::vector<std::vector<std::string>> const& trackers)
+{
+    if (m_torrent == nullptr)
     {
-        announceList.emplace_back(tier);
+        throw Exception("Torrent is empty");
     }
 
-    m_torrent["announce-list"] = announceList;
-
-    if (announceList.empty())
+    // Original bytes are kept as is unless there's something to change
+    if (GetTrackers() == trackers)
     {
-        m_torrent.erase("announce");
-    }
-    else
-    {
-        m_torrent["announce"] = announceList[0][0];
+        return;
     }
 
-    Util::SortJsonObjectKeys(m_torrent);
+    // Info dictionary is copied verbatim, so info hash stays the same
+    m_torrent = std::make_shared<BencodeDocument const>(SpliceTrackers(m_torrent->GetRoot().GetRawData(), trackers),
+        BencodeDocument::Mode::Lazy);
+}
+
+TorrentInfo TorrentInfo::Decode(std::istream& stream)
+{
+    return Decode(Util::ReadStream(stream));
+}
+
+TorrentInfo TorrentInfo::Decode(std::string&& data)
+{
+    return TorrentInfo(std::make_shared<BencodeDocument const>(std::move(data), BencodeDocument::Mode::Lazy));
 }
 
-TorrentInfo TorrentInfo::Decode(std::istream& stream, IStructuredDataCodec const& codec)
+BencodeValue TorrentInfo::GetInfo() const
 {
-    ojson torrent;
-    codec.Decode(stream, torrent);
-    return TorrentInfo(torrent);
+    return m_torrent != nullptr ? m_torrent->GetRoot()["info"] : BencodeValue();
 }
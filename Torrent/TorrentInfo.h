@@ -22,11 +22,14 @@
 #include <cstdint>
 #include <filesystem>
 #include <iosfwd>
+#include <memory>
 #include <string>
+#include <vector>
 
 using jsoncons::ojson;
 
-class IStructuredDataCodec;
+class BencodeDocument;
+class BencodeValue;
 
 class TorrentInfo
 {
@@ -34,19 +37,30 @@ public:
     TorrentInfo();
     TorrentInfo(ojson const& torrent);
 
-    void Encode(std::ostream& stream, IStructuredDataCodec const& codec) const;
+    // Writes bencoded torrent exactly as it has been decoded (or last modified)
+    void Encode(std::ostream& stream) const;
 
     std::string const& GetInfoHash() const;
     std::uint64_t GetTotalSize() const;
     std::uint32_t GetPieceSize() const;
     std::string GetName() const;
+    bool IsMultiFile() const;
+    std::size_t GetFileCount() const;
     std::filesystem::path GetFilePath(std::size_t fileIndex) const;
 
+    std::vector<std::vector<std::string>> GetTrackers() const;
     void SetTrackers(std::vector<std::vector<std::string>> const& trackers);
 
-    static TorrentInfo Decode(std::istream& stream, IStructuredDataCodec const& codec);
+    static TorrentInfo Decode(std::istream& stream);
+    static TorrentInfo Decode(std::string&& data);
 
 private:
-    ojson m_torrent;
+    explicit TorrentInfo(std::shared_ptr<BencodeDocument const> torrent);
+
+    BencodeValue GetInfo() const;
+
+private:
+    // Shared between copies, never modified after construction
+    std::shared_ptr<BencodeDocument const> m_torrent;
     std::string m_infoHash;
 };
@@ -141,6 +141,7 @@ int main(int argc, char* argv[])
         std::string targetName;
         std::string sourceDirString;
         std::string targetDirString;
+        std::string sourceScgiAddress;
         unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
         bool noBackup = false;
         bool dryRun = false;
@@ -151,6 +152,8 @@ int main(int argc, char* argv[])
         options.add_options("Main")
             ("source", "source client name", cxxopts::value<std::string>(sourceName), "name")
             ("source-dir", "source client data directory", cxxopts::value<std::string>(sourceDirString), "path")
+            ("source-scgi", "source client SCGI address to export from while it is running (rTorrent only)",
+                cxxopts::value<std::string>(sourceScgiAddress), "host:port|path")
             ("target", "target client name", cxxopts::value<std::string>(targetName), "name")
             ("target-dir", "target client data directory", cxxopts::value<std::string>(targetDirString), "path")
             ("max-threads", "maximum number of migration threads",
@@ -183,12 +186,18 @@ int main(int argc, char* argv[])
             Logger::SetMinimumLevel(Logger::Debug);
         }
 
-        TorrentStateStoreFactory const storeFactory;
-
         fs::path sourceDir = sourceDirString;
-        ITorrentStateStorePtr sourceStore = FindStateStore(storeFactory, Intention::Export, sourceName, sourceDir);
+        ITorrentStateStorePtr sourceStore = FindStateStore(TorrentStateStoreFactory(sourceScgiAddress),
+            Intention::Export, sourceName, sourceDir);
         fs::path targetDir = targetDirString;
-        ITorrentStateStorePtr targetStore = FindStateStore(storeFactory, Intention::Import, targetName, targetDir);
+        ITorrentStateStorePtr targetStore = FindStateStore(TorrentStateStoreFactory({}), Intention::Import, targetName,
+            targetDir);
+
+        if (!sourceScgiAddress.empty() && sourceStore->GetTorrentClient() != TorrentClient::rTorrent)
+        {
+            throw Exception(fmt::format("Exporting over SCGI is not supported for {} source torrent client",
+                sourceName));
+        }
 
         unsigned int const threadCount = std::max(1u, maxThreads);
 